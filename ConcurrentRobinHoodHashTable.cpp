@@ -0,0 +1,579 @@
+#include "ConcurrentRobinHoodHashTable.h"
+#include "GUI/SimpleTest.h"
+#include "RobinHoodHashTable.h"
+#include "random.h"
+#include "vector.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <shared_mutex>
+#include <thread>
+using namespace std;
+
+/* This program implements a Robin Hood hash table with lock-free lookups. */
+
+/* Epoch-based reclamation. There's one global epoch counter, and every thread that has
+ * ever looked something up gets a record of its own in which it announces the epoch it
+ * started reading in, or zero while it isn't reading at all. A string removed from a
+ * table is stamped with the epoch that began just after it was unlinked; no reader that
+ * announces that epoch or later can ever find it, so once every announced epoch is at
+ * least the stamp, nobody is looking at it any more and it can be freed.
+ */
+namespace {
+    const int kMaxThreads = 256;
+
+    struct alignas(64) ReaderRecord {
+        atomic<uint64_t> epoch{0};
+        atomic<bool> inUse{false};
+    };
+
+    ReaderRecord readerRecords[kMaxThreads];
+    atomic<uint64_t> globalEpoch{1};
+
+    /* Claims a record for the current thread the first time it reads, and hands the
+     * record back when the thread exits.
+     */
+    struct ThreadRecord {
+        ReaderRecord* record = nullptr;
+
+        ThreadRecord() {
+            for (ReaderRecord& candidate: readerRecords) {
+                if (!candidate.inUse.exchange(true)) {
+                    record = &candidate;
+                    return;
+                }
+            }
+        }
+        ~ThreadRecord() {
+            if (record != nullptr) record->inUse.store(false);
+        }
+    };
+
+    ReaderRecord& currentRecord() {
+        thread_local ThreadRecord current;
+        if (current.record == nullptr) {
+            error("More than " + to_string(kMaxThreads) + " threads are reading at once.");
+        }
+        return *current.record;
+    }
+
+    /* Announces the current epoch for as long as it's in scope. The epoch is read again
+     * after being announced, in case a writer moved on and looked at the records in
+     * between; otherwise that writer could free a string this reader is about to see.
+     */
+    class ReadGuard {
+    public:
+        ReadGuard() : record(currentRecord()) {
+            uint64_t epoch = globalEpoch.load();
+            while (true) {
+                record.epoch.store(epoch);
+                uint64_t now = globalEpoch.load();
+                if (now == epoch) break;
+                epoch = now;
+            }
+        }
+        ~ReadGuard() {
+            record.epoch.store(0, memory_order_release);
+        }
+
+    private:
+        ReaderRecord& record;
+    };
+
+    /* The oldest epoch any reader is still in, or the largest possible epoch if nobody
+     * is reading.
+     */
+    uint64_t oldestActiveEpoch() {
+        uint64_t result = numeric_limits<uint64_t>::max();
+        for (const ReaderRecord& record: readerRecords) {
+            uint64_t epoch = record.epoch.load();
+            if (epoch != 0) result = min(result, epoch);
+        }
+        return result;
+    }
+}
+
+ConcurrentRobinHoodHashTable::ConcurrentRobinHoodHashTable(HashFunction<string> hashFn) {
+    numSlots = hashFn.numSlots();
+    totalSlots = numSlots + kOverflowSlots;
+    numStripes = (totalSlots + kStripeSlots - 1) / kStripeSlots;
+    logicalSize = 0;
+    Hash = hashFn;
+
+    elems = new Slot[totalSlots];
+    for (int i = 0; i < totalSlots; i++) {
+        elems[i].element.store(nullptr, memory_order_relaxed);
+        elems[i].distance.store(EMPTY_SLOT, memory_order_relaxed);
+    }
+    stripes = new Stripe[numStripes];
+    for (int i = 0; i < numStripes; i++) {
+        stripes[i].sequence.store(0, memory_order_relaxed);
+    }
+}
+
+ConcurrentRobinHoodHashTable::~ConcurrentRobinHoodHashTable() {
+    for (int i = 0; i < totalSlots; i++) {
+        delete elems[i].element.load(memory_order_relaxed);
+    }
+    for (const auto& entry: retired) {
+        delete entry.first;
+    }
+    delete[] elems;
+    delete[] stripes;
+}
+
+int ConcurrentRobinHoodHashTable::size() const {
+    return logicalSize.load(memory_order_relaxed);
+}
+
+bool ConcurrentRobinHoodHashTable::isEmpty() const {
+    return size() == 0;
+}
+
+void ConcurrentRobinHoodHashTable::lockThrough(Locked& locked, int index) const {
+    while (locked.last < index / kStripeSlots) {
+        stripes[++locked.last].lock.lock();
+    }
+}
+
+void ConcurrentRobinHoodHashTable::unlockAll(const Locked& locked) const {
+    for (int i = locked.first; i <= locked.last; i++) {
+        stripes[i].lock.unlock();
+    }
+}
+
+/* The usual seqlock writer protocol: the fence keeps the slot stores that follow from
+ * becoming visible before the odd sequence numbers, and the release keeps them from
+ * becoming visible after the even ones.
+ */
+void ConcurrentRobinHoodHashTable::beginWrite(const Locked& locked) const {
+    for (int i = locked.first; i <= locked.last; i++) {
+        stripes[i].sequence.store(stripes[i].sequence.load(memory_order_relaxed) + 1,
+                                  memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_release);
+}
+
+void ConcurrentRobinHoodHashTable::endWrite(const Locked& locked) const {
+    for (int i = locked.first; i <= locked.last; i++) {
+        stripes[i].sequence.store(stripes[i].sequence.load(memory_order_relaxed) + 1,
+                                  memory_order_release);
+    }
+}
+
+/* Robin Hood insertion puts the new element where the first element closer to its home
+ * than the key would be now sits, and shifts the rest of the run one slot over into the
+ * next empty slot. All the locks are taken while looking for those two slots, before
+ * anything changes.
+ */
+bool ConcurrentRobinHoodHashTable::insert(const string& key) {
+    int home = Hash(key);
+    Locked locked = { home / kStripeSlots, home / kStripeSlots };
+    stripes[locked.first].lock.lock();
+
+    int index = home;
+    int distance = 0;
+    for (; index < totalSlots; index++, distance++) {
+        lockThrough(locked, index);
+        int slotDistance = elems[index].distance.load(memory_order_relaxed);
+        if (slotDistance < distance) break;
+        if (slotDistance == distance && *elems[index].element.load(memory_order_relaxed) == key) {
+            unlockAll(locked);
+            return false;
+        }
+    }
+
+    int empty = index;
+    while (empty < totalSlots) {
+        lockThrough(locked, empty);
+        if (elems[empty].distance.load(memory_order_relaxed) == EMPTY_SLOT) break;
+        empty++;
+    }
+
+    /* Claim room for the element first, so that racing insertions can't overfill it. */
+    if (empty == totalSlots || logicalSize.fetch_add(1) >= numSlots) {
+        if (empty != totalSlots) logicalSize.fetch_sub(1);
+        unlockAll(locked);
+        return false;
+    }
+
+    const string* element = new string(key);
+    beginWrite(locked);
+    for (int i = empty; i > index; i--) {
+        elems[i].element.store(elems[i - 1].element.load(memory_order_relaxed), memory_order_release);
+        elems[i].distance.store(elems[i - 1].distance.load(memory_order_relaxed) + 1, memory_order_relaxed);
+    }
+    elems[index].element.store(element, memory_order_release);
+    elems[index].distance.store(distance, memory_order_relaxed);
+    endWrite(locked);
+
+    unlockAll(locked);
+    return true;
+}
+
+/* Removal shifts everything after the element back one slot, up to the first slot that's
+ * empty or holds an element already in its home.
+ */
+bool ConcurrentRobinHoodHashTable::remove(const string& key) {
+    int home = Hash(key);
+    Locked locked = { home / kStripeSlots, home / kStripeSlots };
+    stripes[locked.first].lock.lock();
+
+    int index = home;
+    int distance = 0;
+    for (; index < totalSlots; index++, distance++) {
+        lockThrough(locked, index);
+        int slotDistance = elems[index].distance.load(memory_order_relaxed);
+        if (slotDistance < distance) {
+            unlockAll(locked);
+            return false;
+        }
+        if (slotDistance == distance && *elems[index].element.load(memory_order_relaxed) == key) break;
+    }
+    if (index == totalSlots) {
+        unlockAll(locked);
+        return false;
+    }
+
+    int end = index + 1;
+    while (end < totalSlots) {
+        lockThrough(locked, end);
+        if (elems[end].distance.load(memory_order_relaxed) <= 0) break;
+        end++;
+    }
+
+    const string* removed = elems[index].element.load(memory_order_relaxed);
+    beginWrite(locked);
+    for (int i = index; i < end - 1; i++) {
+        elems[i].element.store(elems[i + 1].element.load(memory_order_relaxed), memory_order_release);
+        elems[i].distance.store(elems[i + 1].distance.load(memory_order_relaxed) - 1, memory_order_relaxed);
+    }
+    elems[end - 1].element.store(nullptr, memory_order_relaxed);
+    elems[end - 1].distance.store(EMPTY_SLOT, memory_order_relaxed);
+    endWrite(locked);
+    unlockAll(locked);
+
+    logicalSize.fetch_sub(1);
+    retire(removed);
+    return true;
+}
+
+void ConcurrentRobinHoodHashTable::retire(const string* element) {
+    uint64_t stamp = globalEpoch.fetch_add(1) + 1;
+
+    lock_guard<mutex> guard(retiredLock);
+    retired.emplace_back(element, stamp);
+    if (retired.size() < kReclaimThreshold) return;
+
+    uint64_t oldest = oldestActiveEpoch();
+    auto stillVisible = partition(retired.begin(), retired.end(), [&](const auto& entry) {
+        return entry.second > oldest;
+    });
+    for (auto it = stillVisible; it != retired.end(); ++it) {
+        delete it->first;
+    }
+    retired.erase(stillVisible, retired.end());
+}
+
+bool ConcurrentRobinHoodHashTable::contains(const string& key) const {
+    int home = Hash(key);
+    ReadGuard guard;
+    bool found;
+    while (!tryFindWithoutLocks(key, home, found)) {
+        this_thread::yield();
+    }
+    return found;
+}
+
+/* The usual seqlock reader protocol. Every slot read is atomic, since a writer may be
+ * changing it, and may give an inconsistent picture of the table; the sequence numbers
+ * say whether it did. Strings are loaded with acquire so that a newly inserted one is
+ * always seen fully built, and the epoch announced in contains keeps removed ones alive.
+ */
+bool ConcurrentRobinHoodHashTable::tryFindWithoutLocks(const string& key, int home, bool& found) const {
+    int seenStripes[kMaxReadStripes];
+    unsigned seenSequences[kMaxReadStripes];
+    int numSeen = 0;
+
+    found = false;
+    for (int index = home, distance = 0; index < totalSlots; index++, distance++) {
+        int stripe = index / kStripeSlots;
+        if (numSeen == 0 || seenStripes[numSeen - 1] != stripe) {
+            if (numSeen == kMaxReadStripes) {
+                found = findWithLocks(key, home);
+                return true;
+            }
+            unsigned sequence = stripes[stripe].sequence.load(memory_order_acquire);
+            if (sequence % 2 != 0) return false;
+            seenStripes[numSeen] = stripe;
+            seenSequences[numSeen] = sequence;
+            numSeen++;
+        }
+
+        int slotDistance = elems[index].distance.load(memory_order_relaxed);
+        if (slotDistance < distance) break;
+        if (slotDistance == distance) {
+            const string* element = elems[index].element.load(memory_order_acquire);
+            if (element != nullptr && *element == key) {
+                found = true;
+                break;
+            }
+        }
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    for (int i = 0; i < numSeen; i++) {
+        if (stripes[seenStripes[i]].sequence.load(memory_order_relaxed) != seenSequences[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ConcurrentRobinHoodHashTable::findWithLocks(const string& key, int home) const {
+    Locked locked = { home / kStripeSlots, home / kStripeSlots };
+    stripes[locked.first].lock.lock();
+
+    bool found = false;
+    for (int index = home, distance = 0; index < totalSlots; index++, distance++) {
+        lockThrough(locked, index);
+        int slotDistance = elems[index].distance.load(memory_order_relaxed);
+        if (slotDistance < distance) break;
+        if (slotDistance == distance && *elems[index].element.load(memory_order_relaxed) == key) {
+            found = true;
+            break;
+        }
+    }
+    unlockAll(locked);
+    return found;
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("Concurrent table inserts, looks up and removes on a single thread.") {
+    /* Every element must sit at its recorded distance from home, no element may be more
+     * than one step further from home than the one before it, and the count must match.
+     */
+    auto isConsistent = [](const ConcurrentRobinHoodHashTable& table, HashFunction<string> hashFn) {
+        int count = 0;
+        for (int i = 0; i < table.totalSlots; i++) {
+            int distance = table.elems[i].distance.load();
+            const string* element = table.elems[i].element.load();
+            if (distance == ConcurrentRobinHoodHashTable::EMPTY_SLOT) {
+                if (element != nullptr) return false;
+                continue;
+            }
+            count++;
+            if (element == nullptr || i - hashFn(*element) != distance) return false;
+            if (i > 0 && distance > table.elems[i - 1].distance.load() + 1) return false;
+        }
+        return count == table.size();
+    };
+
+    HashFunction<string> hashFn = Hash::random(1000);
+    ConcurrentRobinHoodHashTable table(hashFn);
+    EXPECT(table.isEmpty());
+
+    for (int i = 0; i < 1000; i++) {
+        EXPECT(table.insert(to_string(i)));
+        EXPECT(!table.insert(to_string(i)));
+    }
+    EXPECT_EQUAL(table.size(), 1000);
+    EXPECT(isConsistent(table, hashFn));
+
+    /* The table is full. */
+    EXPECT(!table.insert("more"));
+    EXPECT_EQUAL(table.size(), 1000);
+
+    for (int i = 0; i < 1000; i++) {
+        EXPECT(table.contains(to_string(i)));
+        EXPECT(!table.contains(to_string(i + 1000)));
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        EXPECT(table.remove(to_string(i)));
+        EXPECT(!table.remove(to_string(i)));
+    }
+    EXPECT_EQUAL(table.size(), 500);
+    EXPECT(isConsistent(table, hashFn));
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), i % 2 == 1);
+    }
+
+    /* With everything landing in the last slot, every element but the first spills into
+     * the overflow slots past the end.
+     */
+    HashFunction<string> lastSlot = Hash::constant(100, 99);
+    ConcurrentRobinHoodHashTable overflowing(lastSlot);
+    for (int i = 0; i < 100; i++) {
+        EXPECT(overflowing.insert(to_string(i)));
+    }
+    EXPECT(isConsistent(overflowing, lastSlot));
+    for (int i = 0; i < 100; i += 3) {
+        EXPECT(overflowing.remove(to_string(i)));
+    }
+    EXPECT(isConsistent(overflowing, lastSlot));
+    for (int i = 0; i < 100; i++) {
+        EXPECT_EQUAL(overflowing.contains(to_string(i)), i % 3 != 0);
+    }
+}
+
+STUDENT_TEST("Concurrent table falls back to locking for a probe through many stripes.") {
+    /* One run thousands of slots long, starting at slot zero. */
+    HashFunction<string> hashFn = Hash::zero(3000);
+    ConcurrentRobinHoodHashTable table(hashFn);
+    for (int i = 0; i < 3000; i++) {
+        table.insert(to_string(i));
+    }
+    EXPECT_EQUAL(table.size(), 3000);
+    EXPECT(table.contains("2999"));
+    EXPECT(!table.contains("nope"));
+}
+
+STUDENT_TEST("Concurrent table stress test: readers never see wrong answers while writers churn.") {
+    const int kSlots = 1 << 14;
+    const int kWriters = 4;
+    const int kReaders = 4;
+    const int kKeysPerWriter = 2000;
+    const int kRounds = 50000;
+
+    /* Half the table is filled with keys that never leave, and readers make sure they're
+     * always found, however much the writers shuffle them around. Keys nobody ever
+     * inserts must never be found either.
+     */
+    HashFunction<string> hashFn = Hash::random(kSlots);
+    ConcurrentRobinHoodHashTable table(hashFn);
+    const int kPermanent = kSlots / 2;
+    for (int i = 0; i < kPermanent; i++) {
+        table.insert("permanent" + to_string(i));
+    }
+
+    atomic<bool> done{false};
+    atomic<int> readerErrors{0};
+    atomic<int> writerErrors{0};
+    vector<Vector<bool>> present(kWriters, Vector<bool>(kKeysPerWriter, false));
+
+    /* Each writer owns its own keys, so it knows exactly which of them should be there. */
+    auto writer = [&](int id) {
+        mt19937 generator(id);
+        for (int round = 0; round < kRounds; round++) {
+            int key = generator() % kKeysPerWriter;
+            string name = "writer" + to_string(id) + "-" + to_string(key);
+            if (generator() % 2 == 0) {
+                if (table.insert(name) == present[id][key]) writerErrors++;
+                present[id][key] = true;
+            } else {
+                if (table.remove(name) != present[id][key]) writerErrors++;
+                present[id][key] = false;
+            }
+            if (table.contains(name) != present[id][key]) writerErrors++;
+        }
+    };
+    auto reader = [&](int id) {
+        mt19937 generator(kWriters + id);
+        while (!done) {
+            int key = generator() % kPermanent;
+            if (!table.contains("permanent" + to_string(key))) readerErrors++;
+            if (table.contains("absent" + to_string(key))) readerErrors++;
+        }
+    };
+
+    vector<thread> writers, readers;
+    for (int i = 0; i < kReaders; i++) readers.emplace_back(reader, i);
+    for (int i = 0; i < kWriters; i++) writers.emplace_back(writer, i);
+    for (thread& t: writers) t.join();
+    done = true;
+    for (thread& t: readers) t.join();
+
+    EXPECT_EQUAL(readerErrors.load(), 0);
+    EXPECT_EQUAL(writerErrors.load(), 0);
+
+    /* Every element still sits at its recorded distance from home. */
+    for (int i = 0; i < table.totalSlots; i++) {
+        const string* element = table.elems[i].element.load();
+        if (element != nullptr) EXPECT_EQUAL(i - hashFn(*element), table.elems[i].distance.load());
+    }
+
+    int expectedSize = kPermanent;
+    for (int id = 0; id < kWriters; id++) {
+        for (int key = 0; key < kKeysPerWriter; key++) {
+            string name = "writer" + to_string(id) + "-" + to_string(key);
+            EXPECT_EQUAL(table.contains(name), bool(present[id][key]));
+            expectedSize += present[id][key];
+        }
+    }
+    EXPECT_EQUAL(table.size(), expectedSize);
+}
+
+STUDENT_TEST("Concurrent table throughput versus a RobinHoodHashTable behind a lock.") {
+    /* Each configuration does the same total number of operations, split evenly across
+     * the threads, so on a machine with enough cores the time should fall as threads are
+     * added. On a machine with fewer cores than threads, the extra threads only take turns.
+     */
+    const int kSlots = 1 << 18;
+    const int kKeys = kSlots / 2;
+    const int kOperations = 1 << 20;
+
+    Vector<string> keys;
+    for (int i = 0; i < 2 * kKeys; i++) {
+        keys += "key" + to_string(i);
+    }
+
+    /* Even-numbered keys stay put; writes insert and remove odd-numbered ones. */
+    auto run = [&](auto& table, int numThreads, int writePercent) {
+        vector<thread> threads;
+        for (int id = 0; id < numThreads; id++) {
+            threads.emplace_back([&, id] {
+                mt19937 generator(id);
+                for (int i = 0; i < kOperations / numThreads; i++) {
+                    int key = generator() % (2 * kKeys);
+                    if (int(generator() % 100) < writePercent) {
+                        if (key % 2 == 0) key++;
+                        if (generator() % 2 == 0) table.insert(keys[key]);
+                        else table.remove(keys[key]);
+                    } else {
+                        table.contains(keys[key]);
+                    }
+                }
+            });
+        }
+        for (thread& t: threads) t.join();
+    };
+
+    /* The baseline: the existing table, wrapped in a reader-writer lock. */
+    struct LockedTable {
+        RobinHoodHashTable table;
+        mutable shared_mutex lock;
+
+        LockedTable(HashFunction<string> hashFn) : table(hashFn) {}
+        bool insert(const string& key) {
+            unique_lock<shared_mutex> guard(lock);
+            return table.insert(key);
+        }
+        bool remove(const string& key) {
+            unique_lock<shared_mutex> guard(lock);
+            return table.remove(key);
+        }
+        bool contains(const string& key) const {
+            shared_lock<shared_mutex> guard(lock);
+            return table.contains(key);
+        }
+    };
+
+    for (int writePercent: { 5, 50 }) {
+        for (int numThreads: { 1, 2, 4, 8, 16, 32 }) {
+            ConcurrentRobinHoodHashTable concurrent(Hash::random(kSlots));
+            LockedTable locked(Hash::random(kSlots));
+            for (int i = 0; i < 2 * kKeys; i += 2) {
+                concurrent.insert(keys[i]);
+                locked.insert(keys[i]);
+            }
+            TIME_OPERATION(kOperations, run(concurrent, numThreads, writePercent));
+            TIME_OPERATION(kOperations, run(locked, numThreads, writePercent));
+
+            for (int i = 0; i < 2 * kKeys; i += 2) {
+                EXPECT(concurrent.contains(keys[i]));
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "HashFunction.h"
+#include "Demos/Utility.h"
+#include "GUI/SimpleTest.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A Robin Hood hash table that many threads can use at once, built for tables that are
+ * read far more often than they are written.
+ *
+ * Lookups take no locks at all. The slots are divided into stripes, each with a writer
+ * lock and a sequence number (a "seqlock"). A writer holds the locks of every stripe its
+ * change touches and bumps their sequence numbers before and after the change; a reader
+ * notes the sequence numbers of the stripes it looks at, and if any of them was odd or
+ * has moved on by the time it's done, it simply looks again. Writers in different
+ * stripes never wait for each other.
+ *
+ * Elements are immutable strings on the heap, and slots point to them, so moving an
+ * element only moves a pointer. A reader may still be comparing against a string that
+ * a writer has just removed, so removed strings are freed only once every reader that
+ * might have seen them has finished, using epoch-based reclamation.
+ *
+ * Unlike RobinHoodHashTable, probes never wrap around the end of the table; instead
+ * there are kOverflowSlots extra slots past the end for runs to spill into. That way
+ * every writer takes its stripe locks in increasing order, which rules out deadlock.
+ * The table doesn't resize. As with the original, it holds at most hashFn.numSlots()
+ * elements; in the very unlikely case that a run reaches the end of the overflow slots,
+ * insert returns false as if the table were full.
+ */
+class ConcurrentRobinHoodHashTable {
+public:
+    /**
+     * Constructs a new table using the given hash function, which must be safe to call
+     * from several threads at once.
+     */
+    ConcurrentRobinHoodHashTable(HashFunction<std::string> hashFn);
+
+    /**
+     * Frees the table and every string it still holds. No other thread may be using the
+     * table at this point.
+     */
+    ~ConcurrentRobinHoodHashTable();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Inserts, looks up and removes elements just as RobinHoodHashTable does, except
+     * that any number of threads may call these at once.
+     */
+    bool insert(const std::string& key);
+    bool contains(const std::string& key) const;
+    bool remove(const std::string& key);
+
+private:
+    /* Distance of an empty slot. */
+    static const int EMPTY_SLOT = -1;
+
+    /* Number of slots covered by each stripe's lock and sequence number. */
+    static const int kStripeSlots = 256;
+
+    /* Extra slots past the end that runs can spill into. */
+    static const int kOverflowSlots = 256;
+
+    /* Most stripes a lock-free lookup will keep track of before it gives up and takes
+     * the locks instead. A probe this long essentially never happens.
+     */
+    static const int kMaxReadStripes = 8;
+
+    /* Removed strings wait until there are this many before anything is freed. */
+    static const int kReclaimThreshold = 64;
+
+    struct Slot {
+        std::atomic<const std::string*> element;
+        std::atomic<int> distance;
+    };
+
+    /* Stripes sit on separate cache lines, so that writers in different stripes don't
+     * slow each other down, and neither do readers checking sequence numbers.
+     */
+    struct alignas(64) Stripe {
+        std::mutex lock;
+        std::atomic<unsigned> sequence;
+    };
+
+    Slot* elems = nullptr;
+    Stripe* stripes = nullptr;
+    int numSlots;      // Slots an element's home can be in.
+    int totalSlots;    // numSlots plus the overflow slots.
+    int numStripes;
+    std::atomic<int> logicalSize;
+    HashFunction<std::string> Hash;
+
+    /* Removed strings not yet freed, each with the epoch after which no new reader can
+     * reach it.
+     */
+    std::mutex retiredLock;
+    std::vector<std::pair<const std::string*, std::uint64_t>> retired;
+
+    /* The contiguous range of stripes a writer holds. */
+    struct Locked {
+        int first;
+        int last;
+    };
+
+    /* Locks every stripe up to the one holding the given slot. */
+    void lockThrough(Locked& locked, int index) const;
+    void unlockAll(const Locked& locked) const;
+
+    /* Bumps the sequence numbers of the held stripes, to odd before a change and back
+     * to even after it.
+     */
+    void beginWrite(const Locked& locked) const;
+    void endWrite(const Locked& locked) const;
+
+    /* The lookup done by contains, with and without locks. The lock-free one returns
+     * false in found's place if it ran into a writer and has to try again.
+     */
+    bool tryFindWithoutLocks(const std::string& key, int home, bool& found) const;
+    bool findWithLocks(const std::string& key, int home) const;
+
+    /* Hands a removed string over to be freed once no reader can be looking at it. */
+    void retire(const std::string* element);
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(ConcurrentRobinHoodHashTable);
+    ALLOW_TEST_ACCESS();
+};
@@ -0,0 +1,305 @@
+#include "FrozenHashSet.h"
+#include "RobinHoodHashTable.h"
+#include "GUI/SimpleTest.h"
+#include "StringHashes.h"
+#include "error.h"
+#include "random.h"
+#include "vector.h"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+using namespace std;
+
+/* This program implements a read-only set of strings with a minimal perfect hash function. */
+
+namespace {
+    int popcount(uint64_t word) {
+#if defined(__GNUC__)
+        return __builtin_popcountll(word);
+#else
+        int result = 0;
+        for (; word != 0; word &= word - 1) result++;
+        return result;
+#endif
+    }
+
+    /* The splitmix64 finalizer, to turn one hash into an independent-looking one per level. */
+    uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+        return value ^ (value >> 31);
+    }
+
+    bool testBit(const uint64_t* words, uint64_t bit) {
+        return (words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    void setBit(uint64_t* words, uint64_t bit) {
+        words[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+/* Each key is hashed once, and each level remixes that hash rather than rehashing the key.
+ * The multiply picks a bit from the high half of the product, as hashFunctionFrom does.
+ */
+uint64_t FrozenHashSet::positionIn(uint64_t hash, int level, uint64_t numBits) {
+    uint64_t levelHash = mix(hash + (level + 1) * 0x9E3779B97F4A7C15);
+#if defined(__SIZEOF_INT128__)
+    return uint64_t(((unsigned __int128) levelHash * numBits) >> 64);
+#else
+    return levelHash % numBits;
+#endif
+}
+
+FrozenHashSet::FrozenHashSet(const RobinHoodHashTable& table) {
+    numElements = table.size();
+
+    /* Midway through a resize, some elements are still in the old array. */
+    vector<const string*> elements;
+    elements.reserve(numElements);
+    for (int i = 0; i < table.allocatedSize; i++) {
+        if (table.elems[i].distance != RobinHoodHashTable::EMPTY_SLOT) elements.push_back(&table.elems[i].element);
+    }
+    if (table.oldElems != nullptr) {
+        for (int i = 0; i < table.oldAllocatedSize; i++) {
+            if (table.oldElems[i].distance != RobinHoodHashTable::EMPTY_SLOT) elements.push_back(&table.oldElems[i].element);
+        }
+    }
+
+    vector<uint64_t> hashes(numElements);
+    for (int attempt = 0; ; attempt++) {
+        seed = mix(attempt);
+        for (int i = 0; i < numElements; i++) {
+            hashes[i] = mumHash(*elements[i], seed);
+        }
+        if (tryBuildLevels(hashes.data())) break;
+    }
+
+    keys = new ArenaKey[numElements];
+    for (int i = 0; i < numElements; i++) {
+        keys[indexOf(hashes[i])] = arena.add(*elements[i]);
+    }
+}
+
+/* Every key that lands alone on a bit gets that bit; the rest go on to the next level.
+ * The bits of all the levels go in one array, one level after another.
+ */
+bool FrozenHashSet::tryBuildLevels(const uint64_t* hashes) {
+    vector<uint64_t> remaining(hashes, hashes + numElements);
+    vector<uint64_t> allBits;
+    vector<Level> allLevels;
+
+    while (!remaining.empty()) {
+        if (int(allLevels.size()) == kMaxLevels) return false;
+        int level = allLevels.size();
+        uint64_t numBits = max<uint64_t>(64, ceil(kGamma * remaining.size()));
+        numBits = (numBits + 63) / 64 * 64;
+
+        vector<uint64_t> taken(numBits / 64, 0);
+        vector<uint64_t> collided(numBits / 64, 0);
+        for (uint64_t hash: remaining) {
+            uint64_t position = positionIn(hash, level, numBits);
+            if (testBit(taken.data(), position)) {
+                setBit(collided.data(), position);
+            } else {
+                setBit(taken.data(), position);
+            }
+        }
+
+        vector<uint64_t> next;
+        for (uint64_t hash: remaining) {
+            if (testBit(collided.data(), positionIn(hash, level, numBits))) next.push_back(hash);
+        }
+        allLevels.push_back({ allBits.size() * 64, numBits });
+        for (size_t i = 0; i < taken.size(); i++) {
+            allBits.push_back(taken[i] & ~collided[i]);
+        }
+        remaining.swap(next);
+    }
+
+    numLevels = allLevels.size();
+    levels = new Level[numLevels];
+    copy(allLevels.begin(), allLevels.end(), levels);
+    numWords = allBits.size();
+    bits = new uint64_t[numWords];
+    copy(allBits.begin(), allBits.end(), bits);
+
+    ranks = new uint32_t[numWords / kWordsPerRank + 1];
+    uint32_t count = 0;
+    for (uint64_t word = 0; word < numWords; word++) {
+        if (word % kWordsPerRank == 0) ranks[word / kWordsPerRank] = count;
+        count += popcount(bits[word]);
+    }
+    return true;
+}
+
+FrozenHashSet::~FrozenHashSet() {
+    delete[] levels;
+    delete[] bits;
+    delete[] ranks;
+    delete[] keys;
+}
+
+int FrozenHashSet::size() const {
+    return numElements;
+}
+
+bool FrozenHashSet::isEmpty() const {
+    return size() == 0;
+}
+
+uint64_t FrozenHashSet::rank(uint64_t bit) const {
+    uint64_t word = bit / 64;
+    uint64_t result = ranks[word / kWordsPerRank];
+    for (uint64_t before = word / kWordsPerRank * kWordsPerRank; before < word; before++) {
+        result += popcount(bits[before]);
+    }
+    return result + popcount(bits[word] & ((uint64_t(1) << (bit % 64)) - 1));
+}
+
+int64_t FrozenHashSet::indexOf(uint64_t hash) const {
+    for (int level = 0; level < numLevels; level++) {
+        uint64_t bit = levels[level].firstBit + positionIn(hash, level, levels[level].numBits);
+        if (testBit(bits, bit)) {
+            return rank(bit);
+        }
+    }
+    return -1;
+}
+
+/* A key not in the set usually lands on a set bit belonging to some other key within a
+ * level or two, and is then told apart by the comparison.
+ */
+bool FrozenHashSet::contains(string_view key) const {
+    int64_t index = indexOf(mumHash(key, seed));
+    return index != -1 && arena.equals(keys[index], key);
+}
+
+size_t FrozenHashSet::bytesUsed() const {
+    return sizeof(*this) + numLevels * sizeof(Level) + numWords * sizeof(uint64_t) +
+           (numWords / kWordsPerRank + 1) * sizeof(uint32_t) + numElements * sizeof(ArenaKey) +
+           arena.bytesAllocated();
+}
+
+double FrozenHashSet::bitsPerKey() const {
+    if (numElements == 0) return 0;
+    double bytes = numLevels * sizeof(Level) + numWords * sizeof(uint64_t) +
+                   (numWords / kWordsPerRank + 1) * sizeof(uint32_t);
+    return 8 * bytes / numElements;
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("A frozen set holds exactly the table's elements, each at its own index.") {
+    RobinHoodHashTable table(Hash::random(20000));
+    for (int i = 0; i < 15000; i++) {
+        table.insert(to_string(i));
+    }
+    for (int i = 0; i < 15000; i += 4) {
+        table.remove(to_string(i));
+    }
+    table.insert("");
+    table.insert(string(100, 'z'));
+
+    FrozenHashSet set = table.freeze();
+    EXPECT_EQUAL(set.size(), table.size());
+    for (int i = -1000; i < 16000; i++) {
+        EXPECT_EQUAL(set.contains(to_string(i)), table.contains(to_string(i)));
+    }
+    EXPECT(set.contains(""));
+    EXPECT(set.contains(string(100, 'z')));
+    EXPECT(!set.contains(string(99, 'z')));
+
+    /* The perfect hash is minimal: the indices are exactly 0 through n - 1. */
+    Vector<bool> used(set.size(), false);
+    for (int i = 0; i < 15000; i++) {
+        if (!table.contains(to_string(i))) continue;
+        int64_t index = set.indexOf(mumHash(to_string(i), set.seed));
+        EXPECT(index >= 0 && index < set.size());
+        EXPECT(!used[index]);
+        used[index] = true;
+    }
+}
+
+STUDENT_TEST("Freezing works on empty, tiny and midway-resized tables.") {
+    RobinHoodHashTable empty(Hash::random(10));
+    FrozenHashSet emptySet = empty.freeze();
+    EXPECT(emptySet.isEmpty());
+    EXPECT(!emptySet.contains(""));
+    EXPECT(!emptySet.contains("a"));
+
+    RobinHoodHashTable single(Hash::random(10));
+    single.insert("only");
+    FrozenHashSet singleSet = single.freeze();
+    EXPECT(singleSet.contains("only"));
+    EXPECT(!singleSet.contains("other"));
+
+    RobinHoodHashTable growing([](int numSlots) { return Hash::random(numSlots); }, 64);
+    int count = 0;
+    while (growing.oldElems == nullptr || count < 1000) {
+        growing.insert(to_string(count++));
+    }
+    FrozenHashSet growingSet = growing.freeze();
+    EXPECT_EQUAL(growingSet.size(), count);
+    for (int i = 0; i < count + 100; i++) {
+        EXPECT_EQUAL(growingSet.contains(to_string(i)), i < count);
+    }
+}
+
+STUDENT_TEST("The perfect hash takes about three bits per key.") {
+    RobinHoodHashTable table(Hash::random(200000));
+    for (int i = 0; i < 150000; i++) {
+        table.insert("key" + to_string(i));
+    }
+    FrozenHashSet set = table.freeze();
+    EXPECT(set.bitsPerKey() > 2.5);
+    EXPECT(set.bitsPerKey() < 3.5);
+}
+
+STUDENT_TEST("Frozen set versus RobinHoodHashTable: lookup time and memory.") {
+    for (int keyLength: { 8, 40 }) {
+        const int kElems = 1 << 20;
+        Vector<string> present, absent;
+        for (int i = 0; i < kElems; i++) {
+            string suffix = to_string(i);
+            present += string(keyLength - suffix.size(), 'k') + suffix;
+            absent += string(keyLength - suffix.size(), 'a') + suffix;
+        }
+        RobinHoodHashTable table(Hash::random(kElems * 5 / 4));
+        for (const string& key: present) {
+            table.insert(key);
+        }
+        FrozenHashSet* set = nullptr;
+        TIME_OPERATION(kElems, set = new FrozenHashSet(table));
+
+        /* The table's slots, plus a heap block for every key too long for std::string
+         * to hold inline.
+         */
+        size_t tableBytes = table.allocatedSize * (sizeof(RobinHoodHashTable::Slot) +
+                                                   sizeof(RobinHoodHashTable::Fingerprint));
+        for (const string& key: present) {
+            if (key.size() >= sizeof(string)) tableBytes += key.size() + 1;
+        }
+        cout << "    Keys of length " << keyLength << ": table " << tableBytes / kElems
+             << " bytes per key, frozen set " << set->bytesUsed() / kElems << " bytes per key ("
+             << set->bitsPerKey() << " bits of perfect hash)" << endl;
+
+        for (int i = kElems - 1; i > 0; i--) {
+            swap(present[i], present[randomInteger(0, i)]);
+        }
+        auto findAll = [&](const auto& lookup, const Vector<string>& keys) {
+            int found = 0;
+            for (const string& key: keys) found += lookup.contains(key);
+            return found;
+        };
+        int found = 0;
+        TIME_OPERATION(kElems, found += findAll(table, present));
+        TIME_OPERATION(kElems, found += findAll(*set, present));
+        TIME_OPERATION(kElems, found += findAll(table, absent));
+        TIME_OPERATION(kElems, found += findAll(*set, absent));
+        EXPECT_EQUAL(found, 2 * kElems);
+        delete set;
+    }
+}
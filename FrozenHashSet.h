@@ -0,0 +1,109 @@
+#pragma once
+
+#include "KeyArena.h"
+#include "Demos/Utility.h"
+#include "GUI/SimpleTest.h"
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+class RobinHoodHashTable;
+
+/**
+ * A read-only set of strings built around a minimal perfect hash function: a function
+ * that sends each of the set's n keys to its own index from 0 to n - 1, with no two
+ * keys sharing one. The keys sit in an array in that order, so a lookup computes the
+ * key's index and compares against the one key stored there - there's no probing, and
+ * no empty slots.
+ *
+ * The perfect hash is built the way BBHash builds one. Level 0 is a bit array with about
+ * kGamma bits per key; each key hashes to one bit, and the keys that land on a bit no
+ * other key landed on get that bit set. The keys that collided move on to level 1, a
+ * smaller bit array built the same way, and so on until every key has a bit to itself.
+ * A key's index is then the number of set bits before its own, which a table of running
+ * counts every 512 bits makes quick to find. Altogether this takes about three bits per
+ * key, and most lookups only look at the first level or two.
+ *
+ * Keys are stored as ArenaKeys, so keys of up to twelve characters take a single memory
+ * access to compare, and longer ones are packed into a KeyArena.
+ */
+class FrozenHashSet {
+public:
+    /**
+     * Builds a set holding exactly the elements of the given table. The table itself is
+     * left alone.
+     */
+    explicit FrozenHashSet(const RobinHoodHashTable& table);
+
+    /**
+     * Cleans up all memory allocated by this set.
+     */
+    ~FrozenHashSet();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Returns whether the key is in the set.
+     */
+    bool contains(std::string_view key) const;
+
+    /**
+     * Returns how many bytes the set takes up altogether, including its keys.
+     */
+    std::size_t bytesUsed() const;
+
+    /**
+     * Returns how many bits per key the perfect hash function alone takes up.
+     */
+    double bitsPerKey() const;
+
+private:
+    /* Bits per key in each level's bit array. Larger values make more keys land alone
+     * in the early levels, so lookups visit fewer levels, at the cost of more bits.
+     */
+    static constexpr double kGamma = 1.5;
+
+    /* Number of 64-bit words each running count covers. */
+    static const int kWordsPerRank = 8;
+
+    /* Levels to try before concluding that two keys have the same 64-bit hash, which no
+     * number of levels can separate, and starting over with another seed.
+     */
+    static const int kMaxLevels = 64;
+
+    struct Level {
+        std::uint64_t firstBit; // Where the level starts in bits; always a multiple of 64.
+        std::uint64_t numBits;  // Always a multiple of 64.
+    };
+
+    int numElements = 0;
+    std::uint64_t seed = 0;
+
+    int numLevels = 0;
+    Level* levels = nullptr;
+    std::uint64_t* bits = nullptr;
+    std::uint64_t numWords = 0;
+    std::uint32_t* ranks = nullptr;   // Set bits in all the words before each group.
+
+    ArenaKey* keys = nullptr;
+    KeyArena arena;
+
+    /* The bit a key with the given hash lands on within a level of the given size. */
+    static std::uint64_t positionIn(std::uint64_t hash, int level, std::uint64_t numBits);
+
+    /* The index given to a key with this hash, or -1 if no level has a bit for it. */
+    std::int64_t indexOf(std::uint64_t hash) const;
+
+    /* Number of set bits before the given one. */
+    std::uint64_t rank(std::uint64_t bit) const;
+
+    /* Tries to build the levels with the current seed, failing if two keys can't be
+     * told apart.
+     */
+    bool tryBuildLevels(const std::uint64_t* hashes);
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(FrozenHashSet);
+    ALLOW_TEST_ACCESS();
+};
@@ -0,0 +1,188 @@
+#include "HashTableStats.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+    double average(long long total, long long count) {
+        return count == 0 ? 0 : double(total) / count;
+    }
+}
+
+double ProbeCounters::probesPerLookup() const {
+    return average(lookupProbes, lookups);
+}
+
+double ProbeCounters::probesPerInsertion() const {
+    return average(insertionProbes, insertions);
+}
+
+double ProbeCounters::probesPerRemoval() const {
+    return average(removalProbes, removals);
+}
+
+HashTableStats makeHashTableStats(int numSlots, int numTombstones,
+                                  const Vector<int>& probeHistogram,
+                                  const function<bool(int)>& isOccupied) {
+    HashTableStats stats;
+    stats.numSlots = numSlots;
+    stats.numTombstones = numTombstones;
+    stats.probeHistogram = probeHistogram;
+
+    long long totalDistance = 0;
+    for (int distance = 0; distance < probeHistogram.size(); distance++) {
+        stats.numElements += probeHistogram[distance];
+        totalDistance += (long long) distance * probeHistogram[distance];
+        if (probeHistogram[distance] > 0) stats.maxProbeDistance = distance;
+    }
+    stats.loadFactor = average(stats.numElements, numSlots);
+    stats.averageProbeDistance = average(totalDistance, stats.numElements);
+
+    /* Start counting just after an empty slot, so that no cluster is split in two by the
+     * end of the table. If there isn't one, the whole table is a single cluster.
+     */
+    int start = -1;
+    for (int i = 0; i < numSlots; i++) {
+        if (!isOccupied(i)) {
+            start = i;
+            break;
+        }
+    }
+    if (start == -1) {
+        if (numSlots > 0) {
+            stats.numClusters = 1;
+            stats.averageClusterLength = stats.maxClusterLength = numSlots;
+            stats.averageMissProbes = numSlots;
+        }
+        return stats;
+    }
+
+    /* A miss whose home is k slots from the end of a cluster of length L looks at those
+     * k slots and then the empty one, so a cluster adds up L(L + 1)/2 + L probes over
+     * its homes, and each empty slot one more.
+     */
+    long long totalClusterLength = 0;
+    long long totalMissProbes = 0;
+    int length = 0;
+    for (int step = 1; step <= numSlots; step++) {
+        int index = (start + step) % numSlots;
+        if (isOccupied(index)) {
+            length++;
+            continue;
+        }
+        if (length > 0) {
+            stats.numClusters++;
+            totalClusterLength += length;
+            stats.maxClusterLength = max(stats.maxClusterLength, length);
+            totalMissProbes += (long long) length * (length + 1) / 2 + length;
+            length = 0;
+        }
+        totalMissProbes++;
+    }
+    stats.averageClusterLength = average(totalClusterLength, stats.numClusters);
+    stats.averageMissProbes = average(totalMissProbes, numSlots);
+    return stats;
+}
+
+/* Slots are numbered without wrapping, so a search from home h can run up to slot
+ * h + numSlots - 1, and the element in slot j has its home at j minus its distance. A slot
+ * that doesn't stop a search from h doesn't stop one from h + 1 either, so the stopping
+ * slot only ever moves forward and one pass finds them all.
+ */
+double robinHoodMissProbes(int numSlots, const function<int(int)>& distanceAt) {
+    long long totalProbes = 0;
+    int stop = 0;
+    for (int home = 0; home < numSlots; home++) {
+        stop = max(stop, home);
+        while (stop < home + numSlots - 1) {
+            int distance = distanceAt(stop % numSlots);
+            if (distance < 0 || stop - distance > home) break;
+            stop++;
+        }
+        totalProbes += stop - home + 1;
+    }
+    return average(totalProbes, numSlots);
+}
+
+ostream& operator<< (ostream& out, const HashTableStats& stats) {
+    out << stats.numElements << " elements and " << stats.numTombstones << " tombstones in "
+        << stats.numSlots << " slots (load factor " << stats.loadFactor << ")" << endl;
+    out << "Probe distance: average " << stats.averageProbeDistance
+        << ", max " << stats.maxProbeDistance << endl;
+    out << "Clusters: " << stats.numClusters << ", average length " << stats.averageClusterLength
+        << ", max " << stats.maxClusterLength << ", " << stats.averageMissProbes
+        << " probes per miss" << endl;
+    const ProbeCounters& counters = stats.counters;
+    if (counters.lookups + counters.insertions + counters.removals > 0) {
+        out << "Probes per lookup " << counters.probesPerLookup()
+            << ", insertion " << counters.probesPerInsertion()
+            << ", removal " << counters.probesPerRemoval() << endl;
+    }
+    return out;
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("Stats add up distances and measure clusters, including one across the end.") {
+    /* Slots: X X . X X X . . X X, where the last two and the first two are one cluster. */
+    Vector<bool> occupied = { true, true, false, true, true, true, false, false, true, true };
+    Vector<int> histogram = { 4, 2, 0, 1 };
+    HashTableStats stats = makeHashTableStats(10, 0, histogram, [&](int i) {
+        return occupied[i];
+    });
+
+    EXPECT_EQUAL(stats.numElements, 7);
+    EXPECT_EQUAL(stats.loadFactor, 0.7);
+    EXPECT_EQUAL(stats.maxProbeDistance, 3);
+    EXPECT_EQUAL(stats.averageProbeDistance, 5.0 / 7);
+
+    EXPECT_EQUAL(stats.numClusters, 2);
+    EXPECT_EQUAL(stats.maxClusterLength, 4);
+    EXPECT_EQUAL(stats.averageClusterLength, 3.5);
+
+    /* Starting from each slot in turn: 3 2 1 4 3 2 1 1 5 4. */
+    EXPECT_EQUAL(stats.averageMissProbes, 2.6);
+}
+
+STUDENT_TEST("Robin Hood misses stop at the first element whose home is further along.") {
+    /* The homes of the elements in each slot are 8 1 . 3 3 . . . 8 8, so the element in
+     * slot 0 has wrapped around the end. Walking to the end of the cluster, as in linear
+     * probing, would average 2.3 probes.
+     */
+    Vector<int> distances = { 2, 0, -1, 0, 1, -1, -1, -1, 0, 1 };
+    auto distanceAt = [&](int i) {
+        return distances[i];
+    };
+    /* Starting from each slot in turn: 2 2 1 3 2 1 1 1 4 3. */
+    EXPECT_EQUAL(robinHoodMissProbes(10, distanceAt), 2.0);
+
+    /* A full table with every element at home: each miss looks at two slots. */
+    distances = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    EXPECT_EQUAL(robinHoodMissProbes(8, distanceAt), 2.0);
+    distances = { 0, 0, 0, -1 };
+    EXPECT_EQUAL(robinHoodMissProbes(4, distanceAt), 1.75);
+    EXPECT_EQUAL(robinHoodMissProbes(0, distanceAt), 0);
+}
+
+STUDENT_TEST("Stats handle empty and completely full tables.") {
+    HashTableStats empty = makeHashTableStats(8, 0, {}, [](int) {
+        return false;
+    });
+    EXPECT_EQUAL(empty.numElements, 0);
+    EXPECT_EQUAL(empty.averageProbeDistance, 0);
+    EXPECT_EQUAL(empty.numClusters, 0);
+    EXPECT_EQUAL(empty.averageMissProbes, 1);
+
+    HashTableStats full = makeHashTableStats(8, 2, { 6 }, [](int) {
+        return true;
+    });
+    EXPECT_EQUAL(full.numTombstones, 2);
+    EXPECT_EQUAL(full.numClusters, 1);
+    EXPECT_EQUAL(full.maxClusterLength, 8);
+
+    ProbeCounters counters;
+    EXPECT_EQUAL(counters.probesPerLookup(), 0);
+    counters.lookups = 4;
+    counters.lookupProbes = 10;
+    EXPECT_EQUAL(counters.probesPerLookup(), 2.5);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "GUI/SimpleTest.h"
+#include "vector.h"
+#include <functional>
+#include <ostream>
+
+/**
+ * Running totals of how many slots a table's operations have looked at. Each operation
+ * counts the slots its search for the key examines, including the one that ended the
+ * search, so a key found in its home slot costs one probe.
+ */
+struct ProbeCounters {
+    long long lookups = 0;
+    long long lookupProbes = 0;
+    long long insertions = 0;
+    long long insertionProbes = 0;
+    long long removals = 0;
+    long long removalProbes = 0;
+
+    /* Averages over the operations counted so far, or 0 if there were none. */
+    double probesPerLookup() const;
+    double probesPerInsertion() const;
+    double probesPerRemoval() const;
+};
+
+/**
+ * A summary of the shape of a hash table, cheap enough to take on a table of any size:
+ * it is one pass over the slots and keeps nothing per slot.
+ */
+struct HashTableStats {
+    int numSlots = 0;
+    int numElements = 0;
+    int numTombstones = 0;
+    double loadFactor = 0;
+
+    /* How many slots past its home slot each element sits. probeHistogram[d] is the
+     * number of elements d slots from home, so finding that element takes d + 1 probes.
+     */
+    double averageProbeDistance = 0;
+    int maxProbeDistance = 0;
+    Vector<int> probeHistogram;
+
+    /* Clusters are maximal runs of slots that aren't empty (tombstones count, since
+     * probes have to walk past them), wrapping around the end of the table. An unlucky
+     * miss has to walk to the end of one, and averageMissProbes is how many slots that
+     * takes on average, over every possible home slot. Tables whose misses can stop
+     * sooner than that replace it with their own figure.
+     */
+    int numClusters = 0;
+    double averageClusterLength = 0;
+    int maxClusterLength = 0;
+    double averageMissProbes = 0;
+
+    /* All zero unless the table has probe counting turned on. */
+    ProbeCounters counters;
+};
+
+/**
+ * Works out everything but the counters, given the distances from home of every
+ * element and which slots aren't empty. Tables call this from their stats() functions.
+ */
+HashTableStats makeHashTableStats(int numSlots, int numTombstones,
+                                  const Vector<int>& probeHistogram,
+                                  const std::function<bool(int)>& isOccupied);
+
+/**
+ * Works out averageMissProbes for a Robin Hood table, given the distance from home of
+ * the element in each slot, or a negative number for an empty slot. A Robin Hood miss
+ * stops at the first slot that is empty or holds an element whose home is further along
+ * than the key's, which usually comes well before the end of the cluster.
+ */
+double robinHoodMissProbes(int numSlots, const std::function<int(int)>& distanceAt);
+
+/**
+ * Prints the summary on a few lines, leaving out the histogram.
+ */
+std::ostream& operator<< (std::ostream& out, const HashTableStats& stats);
@@ -1,100 +1,12 @@
 #include "HeapPQueue.h"
+#include "strlib.h"
 #include "vector.h"
+#include <memory>
+#include <queue>
 
 using namespace std;
 
-/* Constant controlling the default size of the priority queue. */
-const int initialSize = 5;
-
-HeapPQueue::HeapPQueue() {
-    allocatedSize = initialSize;
-    logicalSize = 0;
-    elems = new DataPoint[allocatedSize];
-}
-
-HeapPQueue::~HeapPQueue() {
-    delete[] elems;
-}
-
-void HeapPQueue::enqueue(const DataPoint& data) {
-    if (allocatedSize == logicalSize) {
-        grow();
-    }
-    int index = logicalSize; //index refers to the position of the added element.
-    elems[index] = data;
-    if (index != 0) {
-        while(data.weight < elems[(index - 1) / 2].weight) {
-            swap(elems[index],elems[(index - 1) / 2]);
-            index = (index - 1) / 2;
-            if (index == 0) {
-                break;
-            }
-        }
-    }
-    logicalSize++;
-}
-
-int HeapPQueue::size() const {
-    return logicalSize;
-}
-
-DataPoint HeapPQueue::peek() const {
-    if (isEmpty()) {
-        error("You need to have at least one element in the heap!");
-    }
-    return elems[0];
-}
-
-
-DataPoint HeapPQueue::dequeue() {
-    DataPoint result = peek();
-    swap(elems[logicalSize - 1], elems[0]);
-    logicalSize --;
-    /* i refers to the position of the element that needs to swap with its lower-weight child. */
-    int i = 0;
-    /* case 1: the element has two children. */
-    if (2 * i + 2 < logicalSize) {
-        while (elems[i].weight > elems [2 * i + 1].weight ||
-               elems[i].weight > elems [2 * i + 2].weight) {
-            int curIndex = i;
-            elems [2 * i + 1].weight <= elems [2 * i + 2].weight ? i = 2 * i + 1 : i = 2 * i + 2;
-            swap(elems[curIndex],elems[i]);
-            if (2 * i + 2 >= logicalSize) {
-                break;
-            }
-        }
-    }
-    /* case 2: the element has one child. */
-    if ((2 * i + 1 < logicalSize) && elems[i].weight > elems[2 * i + 1].weight){
-        swap(elems[i], elems[2 * i + 1]);
-    }
-    return result;
-}
-
-bool HeapPQueue::isEmpty() const {
-    return size() == 0;
-}
-
-void HeapPQueue::grow() {
-    allocatedSize *= 2;
-    DataPoint* helper = new DataPoint[allocatedSize];
-    for (int i = 0; i < logicalSize; i++) {
-        helper[i] = elems[i];
-    }
-    delete[] elems;
-    elems = helper;
-}
-
-/*
- *This function prints out each element in the the array.
- */
-void HeapPQueue::printDebugInfo() {
-    int i = 0;
-    while (i < logicalSize) {
-        cout<< elems[i] <<endl;
-        i++;
-    }
-}
+/* HeapPQueue is a class template, so its implementation lives in HeapPQueue.h. */
 
 
 /* * * * * * Test Cases Below This Point * * * * * */
@@ -155,6 +67,385 @@ STUDENT_TEST("Insert random permutation.") {
     EXPECT_EQUAL(pq.isEmpty(), true);
 }
 
+STUDENT_TEST("4-ary and 8-ary heaps dequeue in sorted order.") {
+    HeapPQueue<DataPoint, less<>, 4> four;
+    HeapPQueue<DataPoint, less<>, 8> eight;
+    Vector<int> weights;
+    for (int i = 0; i < 5000; i++) {
+        int weight = randomInteger(-1000, 1000);
+        weights += weight;
+        four.enqueue({ "a" + to_string(i), weight });
+        eight.enqueue({ "b" + to_string(i), weight });
+    }
+    sort(weights.begin(), weights.end());
+
+    for (int i = 0; i < weights.size(); i++) {
+        EXPECT_EQUAL(four.dequeue().weight, weights[i]);
+        EXPECT_EQUAL(eight.dequeue().weight, weights[i]);
+    }
+    EXPECT(four.isEmpty());
+    EXPECT(eight.isEmpty());
+}
+
+STUDENT_TEST("Works with custom comparators and move-only types.") {
+    HeapPQueue<int, greater<int>> maxHeap;
+    for (int i = 0; i < 100; i++) {
+        maxHeap.enqueue(i);
+    }
+    for (int i = 99; i >= 0; i--) {
+        EXPECT_EQUAL(maxHeap.dequeue(), i);
+    }
+
+    auto byValue = [](const unique_ptr<int>& elem) {
+        return *elem;
+    };
+    HeapPQueue<unique_ptr<int>, less<>, 4, decltype(byValue)> pointers(less<>(), byValue);
+    for (int i = 10; i > 0; i--) {
+        pointers.enqueue(make_unique<int>(i));
+    }
+    for (int i = 1; i <= 10; i++) {
+        unique_ptr<int> removed = pointers.dequeue();
+        EXPECT_EQUAL(*removed, i);
+    }
+}
+
+STUDENT_TEST("Bulk construction and enqueueAll produce valid heaps.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 10000; i++) {
+        points += { "elem" + to_string(i), randomInteger(-5000, 5000) };
+    }
+    Vector<DataPoint> few = { { "few", 3 }, { "few", -6000 }, { "few", 6000 } };
+
+    /* Build from scratch, then add a small batch, which sifts each element up. */
+    HeapPQueue pq(points.begin(), points.end());
+    EXPECT_EQUAL(pq.size(), points.size());
+    pq.enqueueAll(few);
+
+    /* Add a large batch to a small heap, which rebuilds the whole thing. */
+    HeapPQueue<DataPoint, less<>, 4> four;
+    four.enqueue({ "one", 0 });
+    four.enqueueAll(points);
+
+    Vector<int> weights;
+    for (const DataPoint& point: points) {
+        weights += point.weight;
+    }
+    Vector<int> first = weights;
+    Vector<int> second = weights;
+    for (const DataPoint& point: few) {
+        first += point.weight;
+    }
+    second += 0;
+    sort(first.begin(), first.end());
+    sort(second.begin(), second.end());
+
+    EXPECT_EQUAL(pq.size(), first.size());
+    for (int weight: first) {
+        EXPECT_EQUAL(pq.dequeue().weight, weight);
+    }
+    EXPECT_EQUAL(four.size(), second.size());
+    for (int weight: second) {
+        EXPECT_EQUAL(four.dequeue().weight, weight);
+    }
+}
+
+STUDENT_TEST("Bulk construction handles empty and tiny ranges.") {
+    Vector<DataPoint> none;
+    HeapPQueue empty(none.begin(), none.end());
+    EXPECT(empty.isEmpty());
+    empty.enqueueAll(none);
+    EXPECT(empty.isEmpty());
+
+    Vector<DataPoint> one = { { "A", 1 } };
+    HeapPQueue single(one.begin(), one.end());
+    EXPECT_EQUAL(single.dequeue(), { "A", 1 });
+}
+
+namespace {
+    /* Loads n random data points into a heap, either one at a time or all at once. */
+    void loadOneAtATime(const Vector<DataPoint>& points) {
+        HeapPQueue pq;
+        for (const DataPoint& point: points) {
+            pq.enqueue(point);
+        }
+    }
+    void loadInBulk(const Vector<DataPoint>& points) {
+        HeapPQueue pq(points.begin(), points.end());
+    }
+}
+
+STUDENT_TEST("Stress test: bulk heapify versus repeated enqueue.") {
+    for (int n = 250000; n <= 1000000; n *= 4) {
+        Vector<DataPoint> points;
+        for (int i = 0; i < n; i++) {
+            points += { "", randomInteger(0, 100000) };
+        }
+        TIME_OPERATION(n, loadOneAtATime(points));
+        TIME_OPERATION(n, loadInBulk(points));
+    }
+}
+
+STUDENT_TEST("Heap entries mirror the weights of the payloads they point at.") {
+    HeapPQueue pq;
+    for (int i = 0; i < 1000; i++) {
+        pq.enqueue({ "elem" + to_string(i), randomInteger(0, 100) });
+        if (i % 3 == 0) {
+            pq.dequeue();
+        }
+    }
+
+    Vector<bool> used(pq.allocatedSize, false);
+    for (int i = 0; i < pq.logicalSize; i++) {
+        int handle = pq.heap[i].handle;
+        EXPECT_EQUAL(pq.heap[i].key, pq.payloads[handle].weight);
+        EXPECT_EQUAL(pq.positions[handle], i);
+        EXPECT(!used[handle]);
+        used[handle] = true;
+        if (i > 0) {
+            EXPECT(pq.heap[(i - 1) / 2].key <= pq.heap[i].key);
+        }
+    }
+
+    /* Every handle not in the heap must be on the free stack. */
+    for (int i = 0; i < pq.allocatedSize - pq.logicalSize; i++) {
+        EXPECT(!used[pq.freeHandles[i]]);
+        used[pq.freeHandles[i]] = true;
+    }
+    for (bool handleSeen: used) {
+        EXPECT(handleSeen);
+    }
+}
+
+STUDENT_TEST("Elements that are their own keys are not copied into the heap array.") {
+    HeapPQueue<string> pq;
+    EXPECT_EQUAL(sizeof(pq.heap[0]), sizeof(int));
+
+    Vector<HeapPQueue<string>::Handle> handles;
+    for (int i = 0; i < 1000; i++) {
+        handles += pq.enqueue("a string long enough to allocate, #" + to_string(1000 + i));
+    }
+    /* Move elements both ways, which compares the new key against the one it replaces. */
+    pq.updatePriority(handles[500], "a");
+    pq.updatePriority(handles[0], "z");
+    pq.updatePriority(handles[1], "b");
+    EXPECT_EQUAL(pq.dequeue(), "a");
+    EXPECT_EQUAL(pq.dequeue(), "a string long enough to allocate, #1002");
+
+    string last = pq.dequeue();
+    while (!pq.isEmpty()) {
+        string next = pq.dequeue();
+        EXPECT(last <= next);
+        last = next;
+    }
+    EXPECT_EQUAL(last, "z");
+}
+
+STUDENT_TEST("updatePriority and erase move elements by handle.") {
+    HeapPQueue pq;
+    auto a = pq.enqueue({ "a", 10 });
+    pq.enqueue({ "b", 20 });
+    auto c = pq.enqueue({ "c", 30 });
+    auto d = pq.enqueue({ "d", 40 });
+
+    /* Raise d to the front, and push a to the back. */
+    pq.updatePriority(d, 5);
+    pq.updatePriority(a, 50);
+    EXPECT_EQUAL(pq.peek(), { "d", 5 });
+    EXPECT_EQUAL(pq.get(a), { "a", 50 });
+
+    /* Erase something from the middle. */
+    pq.erase(c);
+    EXPECT(!pq.contains(c));
+    EXPECT_EQUAL(pq.size(), 3);
+
+    EXPECT_EQUAL(pq.dequeue(), { "d", 5 });
+    EXPECT_EQUAL(pq.dequeue(), { "b", 20 });
+    EXPECT_EQUAL(pq.dequeue(), { "a", 50 });
+    EXPECT(pq.isEmpty());
+}
+
+STUDENT_TEST("Stale or bogus handles are reported as errors.") {
+    HeapPQueue pq;
+    auto handle = pq.enqueue({ "a", 1 });
+    EXPECT(pq.contains(handle));
+    pq.dequeue();
+
+    EXPECT(!pq.contains(handle));
+    EXPECT_ERROR(pq.erase(handle));
+    EXPECT_ERROR(pq.updatePriority(handle, 3));
+    EXPECT_ERROR(pq.get(handle));
+    EXPECT_ERROR(pq.erase(-1));
+    EXPECT_ERROR(pq.erase(137137));
+}
+
+STUDENT_TEST("Stress test: random updates and erases match a sorted reference.") {
+    HeapPQueue<DataPoint, less<>, 4> pq;
+    Vector<HeapPQueue<DataPoint, less<>, 4>::Handle> handles;
+    Vector<int> weights;
+    for (int i = 0; i < 20000; i++) {
+        int weight = randomInteger(0, 100000);
+        handles += pq.enqueue({ to_string(i), weight });
+        weights += weight;
+    }
+
+    /* Reprioritize or erase random elements, tracking what should be left. */
+    for (int round = 0; round < 20000; round++) {
+        int i = randomInteger(0, handles.size() - 1);
+        if (weights[i] == -1) {
+            continue;
+        }
+        if (randomInteger(0, 3) == 0) {
+            pq.erase(handles[i]);
+            weights[i] = -1;
+        } else {
+            weights[i] = randomInteger(0, 100000);
+            pq.updatePriority(handles[i], weights[i]);
+        }
+    }
+
+    Vector<int> expected;
+    for (int weight: weights) {
+        if (weight != -1) {
+            expected += weight;
+        }
+    }
+    sort(expected.begin(), expected.end());
+
+    EXPECT_EQUAL(pq.size(), expected.size());
+    for (int weight: expected) {
+        DataPoint removed = pq.dequeue();
+        EXPECT_EQUAL(removed.weight, weight);
+        EXPECT_EQUAL(weights[stringToInteger(removed.name)], weight);
+    }
+}
+
+STUDENT_TEST("pushPop and replaceTop do an enqueue and dequeue in one step.") {
+    HeapPQueue pq;
+    EXPECT_EQUAL(pq.pushPop({ "alone", 1 }), { "alone", 1 });
+    EXPECT(pq.isEmpty());
+    EXPECT_ERROR(pq.replaceTop({ "nothing", 0 }));
+
+    pq.enqueue({ "b", 20 });
+    pq.enqueue({ "c", 30 });
+
+    /* Something that would come out first anyway is handed straight back. */
+    EXPECT_EQUAL(pq.pushPop({ "a", 10 }), { "a", 10 });
+    EXPECT_EQUAL(pq.pushPop({ "tie", 20 }), { "tie", 20 });
+    EXPECT_EQUAL(pq.size(), 2);
+
+    /* Otherwise the front comes out and the new element goes in. */
+    EXPECT_EQUAL(pq.pushPop({ "d", 40 }), { "b", 20 });
+    EXPECT_EQUAL(pq.replaceTop({ "e", 5 }), { "c", 30 });
+    EXPECT_EQUAL(pq.dequeue(), { "e", 5 });
+    EXPECT_EQUAL(pq.dequeue(), { "d", 40 });
+}
+
+STUDENT_TEST("offer keeps the largest elements within the size limit.") {
+    HeapPQueue pq;
+    EXPECT(!pq.offer({ "zero", 5 }, 0));
+    for (int i = 0; i < 100; i++) {
+        pq.offer({ "", (i * 37) % 100 }, 10);
+        EXPECT(pq.size() <= 10);
+    }
+    for (int i = 90; i < 100; i++) {
+        EXPECT_EQUAL(pq.dequeue().weight, i);
+    }
+    EXPECT(pq.isEmpty());
+}
+
+namespace {
+    /* Keeps the k largest of n random weights, either with an enqueue and dequeue per
+     * element or with offer.
+     */
+    void keepLargestTwoSifts(int n, int k) {
+        HeapPQueue<int> pq;
+        for (int i = 0; i < n; i++) {
+            pq.enqueue(randomInteger(0, 1000000000));
+            if (pq.size() > k) {
+                pq.dequeue();
+            }
+        }
+    }
+    void keepLargestWithOffer(int n, int k) {
+        HeapPQueue<int> pq;
+        for (int i = 0; i < n; i++) {
+            pq.offer(randomInteger(0, 1000000000), k);
+        }
+    }
+}
+
+STUDENT_TEST("Stress test: bounded top-k with offer versus enqueue and dequeue.") {
+    const int k = 100;
+    for (int n = 1000000; n <= 4000000; n *= 2) {
+        TIME_OPERATION(n, keepLargestTwoSifts(n, k));
+        TIME_OPERATION(n, keepLargestWithOffer(n, k));
+    }
+}
+
+namespace {
+    /* Fills a priority queue with n data points and drains it. The data points have names
+     * long enough to live on the heap, as they would in real data.
+     */
+    template <typename PQueue> void fillAndDrain(int n) {
+        PQueue pq;
+        for (int i = 0; i < n; i++) {
+            pq.push({ "datapoint-number-" + to_string(i), randomInteger(0, 100000) });
+        }
+        while (!pq.empty()) {
+            pq.pop();
+        }
+    }
+
+    /* Adapter giving HeapPQueue the push/pop/empty names of std::priority_queue. */
+    struct SplitLayout {
+        HeapPQueue<DataPoint, less<>, 4> pq;
+        void push(DataPoint&& point) { pq.enqueue(std::move(point)); }
+        void pop() { pq.dequeue(); }
+        bool empty() const { return pq.isEmpty(); }
+    };
+
+    /* Stand-in for the old layout, which sifted whole DataPoints around. */
+    struct HeavierWeight {
+        bool operator() (const DataPoint& lhs, const DataPoint& rhs) const {
+            return lhs.weight > rhs.weight;
+        }
+    };
+    using WholeElementLayout = priority_queue<DataPoint, vector<DataPoint>, HeavierWeight>;
+}
+
+STUDENT_TEST("Stress test: split key/payload layout versus sifting whole DataPoints.") {
+    for (int n = 250000; n <= 4000000; n *= 4) {
+        TIME_OPERATION(n, fillAndDrain<WholeElementLayout>(n));
+        TIME_OPERATION(n, fillAndDrain<SplitLayout>(n));
+    }
+}
+
+namespace {
+    /* Runs the 250,000-element cycle from the provided stress test on a heap of the
+     * given arity, so the different layouts can be timed against one another.
+     */
+    template <int Arity> void cycleElems(int n) {
+        HeapPQueue<DataPoint, less<>, Arity> pq;
+        for (int i = 0; i < n; i++) {
+            pq.enqueue({ "", randomInteger(0, 100000) });
+        }
+        for (int i = 0; i < n; i++) {
+            pq.dequeue();
+        }
+        for (int i = 0; i < n; i++) {
+            pq.enqueue({ "", randomInteger(0, 100000) });
+        }
+    }
+}
+
+STUDENT_TEST("Stress test: cycle 250,000 elems through binary, 4-ary and 8-ary heaps.") {
+    for (int n = 250000; n <= 1000000; n *= 4) {
+        TIME_OPERATION(n, cycleElems<2>(n));
+        TIME_OPERATION(n, cycleElems<4>(n));
+        TIME_OPERATION(n, cycleElems<8>(n));
+    }
+}
+
 
 /* * * * * Provided Tests Below This Point * * * * */
 
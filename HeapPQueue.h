@@ -3,20 +3,98 @@
 #include "Demos/DataPoint.h"
 #include "Demos/Utility.h"
 #include "GUI/SimpleTest.h"
+#include "error.h"
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <type_traits>
+#include <utility>
 
 /**
- * Priority queue type implemented using a binary heap. Refer back to the assignment handout
- * for details about how binary heaps work.
+ * Function object that extracts the priority key of an element stored in a HeapPQueue.
+ * The heap only ever compares keys, and keeps them in their own dense array apart from
+ * the elements themselves.
+ *
+ * The set function writes a new key back into an element. It is only needed by
+ * HeapPQueue::updatePriority, so custom key extractors can leave it out.
+ *
+ * By default an element is its own key. DataPoints are keyed by their weight, which
+ * gives the lowest-weight-first behavior the priority queue has always had.
+ *
+ * An extractor that returns a reference, like the default one, says that the key already
+ * lives inside the element. The heap then doesn't keep a copy of it and compares the
+ * elements in place instead.
+ */
+template <typename T> struct HeapKey {
+    const T& operator() (const T& elem) const {
+        return elem;
+    }
+    void set(T& elem, const T& key) const {
+        elem = key;
+    }
+};
+
+template <> struct HeapKey<DataPoint> {
+    auto operator() (const DataPoint& elem) const {
+        return elem.weight;
+    }
+    void set(DataPoint& elem, decltype(DataPoint::weight) key) const {
+        elem.weight = key;
+    }
+};
+
+/**
+ * Priority queue type implemented using a d-ary heap. Refer back to the assignment handout
+ * for details about how binary heaps work; a d-ary heap is the same idea, except that each
+ * node has Arity children instead of two. The children of the node at index i live at
+ * indices Arity * i + 1 through Arity * i + Arity, so with Arity = 4 or 8 all the children
+ * of a node usually sit in the same cache line, and the heap is shallower.
+ *
+ * The heap array itself holds only small (key, handle) entries. The elements live in a
+ * separate payload array indexed by handle and never move once enqueued, so sifting a
+ * DataPoint shuffles 8-byte entries rather than dragging its name string through the
+ * cache. When the key extractor returns a reference into the element, the entries are
+ * just handles and comparisons look at the payloads, so a HeapPQueue<std::string> holds
+ * each string once. Both sifts carry a "hole" along the path and only write the entry
+ * being placed once, at the end.
+ *
+ * Keys are compared with Compare; an element a has higher priority than an element b if
+ * compare(keyOf(a), keyOf(b)) returns true, so with std::less the smallest key comes out
+ * first. The template arguments all have defaults, so plain HeapPQueue is still the binary
+ * heap of DataPoints ordered by weight that the rest of the assignment uses.
  *
  * As a reminder, you are required to do all your own memory management using new[] and
  * delete[].
  */
+template <typename T = DataPoint, typename Compare = std::less<>, int Arity = 2,
+          typename KeyOf = HeapKey<T>>
 class HeapPQueue {
 public:
+    static_assert(Arity >= 2, "A heap needs at least two children per node.");
+
+    /* Type of the priority keys of the elements. */
+    using Key = std::decay_t<decltype(std::declval<KeyOf>()(std::declval<const T&>()))>;
+
+    /* Type of the handles returned by enqueue. A handle names one element for as long
+     * as that element is in the queue; once it is dequeued or erased, the handle may be
+     * given to a later element.
+     */
+    using Handle = int;
+
     /**
      * Creates a new, empty priority queue.
      */
-    HeapPQueue();
+    HeapPQueue(const Compare& compare = Compare(), const KeyOf& keyOf = KeyOf());
+
+    /**
+     * Creates a new priority queue holding the elements in the range [first, last).
+     * The storage is allocated once and the heap is built bottom-up, so this runs in
+     * time O(n) rather than the O(n log n) of enqueueing the elements one at a time.
+     */
+    template <typename ForwardIterator>
+    HeapPQueue(ForwardIterator first, ForwardIterator last,
+               const Compare& compare = Compare(), const KeyOf& keyOf = KeyOf());
 
     /**
      * Cleans up all memory allocated by this priorty queue. Remember, you're responsible
@@ -29,8 +107,128 @@ public:
      * where n is the number of elements in the queue.
      *
      * @param data The data point to add.
+     * @return A handle that can be passed to updatePriority and erase.
+     */
+    Handle enqueue(const T& data);
+    Handle enqueue(T&& data);
+
+    /**
+     * Changes the priority of the element with the given handle, moving it up or down
+     * the heap as needed. The key is also written back into the element itself, so for
+     * DataPoints this sets the weight.
+     *
+     * If the handle does not name an element in the queue, this function calls error()
+     * to report an error.
+     *
+     * This operation runs in time O(log n).
+     *
+     * @param handle The handle returned when the element was enqueued.
+     * @param key The new priority of the element.
+     */
+    void updatePriority(Handle handle, const Key& key);
+
+    /**
+     * Removes the element with the given handle from the queue, wherever it is.
+     *
+     * If the handle does not name an element in the queue, this function calls error()
+     * to report an error.
+     *
+     * This operation runs in time O(log n).
+     *
+     * @param handle The handle returned when the element was enqueued.
+     */
+    void erase(Handle handle);
+
+    /**
+     * Returns whether the given handle names an element currently in the queue.
+     *
+     * This operation runs in time O(1).
+     */
+    bool contains(Handle handle) const;
+
+    /**
+     * Returns the element with the given handle.
+     *
+     * If the handle does not name an element in the queue, this function calls error()
+     * to report an error.
+     *
+     * This operation runs in time O(1).
+     */
+    const T& get(Handle handle) const;
+
+    /**
+     * Calls the given function on each element in the queue, in no particular order,
+     * without changing the queue.
+     *
+     * This operation runs in time O(n).
+     *
+     * @param function A function taking a const T&.
+     */
+    template <typename Function> void forEach(Function function) const;
+
+    /**
+     * Adds every element of the given range (a Vector, std::vector, etc.) into the
+     * queue, reserving space for all of them up front.
+     *
+     * If the range is at least as large as the queue, the whole heap is rebuilt
+     * bottom-up in time O(n + k), where k is the size of the range. Otherwise each new
+     * element is sifted up on its own, which takes time O(k log n).
+     *
+     * @param range The elements to add.
+     */
+    template <typename Range> void enqueueAll(const Range& range);
+
+    /**
+     * Adds data to the queue without letting the queue grow past maxSize elements. This
+     * is the building block for keeping the k largest elements of a stream in a min-heap
+     * of size k.
+     *
+     * If the queue is not yet full, data is simply enqueued. Otherwise data is compared
+     * once against the front of the queue: if it would come out first (or tie), it is
+     * rejected on the spot, and if not, it replaces the front element with a single
+     * sift-down instead of a separate enqueue and dequeue.
+     *
+     * This operation runs in time O(1) for rejected elements and O(log n) otherwise.
+     *
+     * @param data The data point to offer.
+     * @param maxSize The most elements the queue may hold.
+     * @return Whether data was kept.
+     */
+    bool offer(const T& data, int maxSize);
+    bool offer(T&& data, int maxSize);
+
+    /**
+     * Equivalent to an enqueue followed by a dequeue, but with at most one sift. If data
+     * would come out of the queue first anyway (or the queue is empty), it is handed
+     * straight back after a single comparison and the queue is unchanged.
+     *
+     * This operation runs in time O(log n).
+     *
+     * @param data The data point to add.
+     * @return The data point removed from the queue, which may be data itself.
+     */
+    T pushPop(T data);
+
+    /**
+     * Equivalent to a dequeue followed by an enqueue, but done with a single sift-down.
+     * The new element reuses the handle of the element it replaces.
+     *
+     * If the priority queue is empty, this function calls error() to report an error.
+     *
+     * This operation runs in time O(log n).
+     *
+     * @param data The data point to add.
+     * @return The data point that was at the front of the queue.
+     */
+    T replaceTop(T data);
+
+    /**
+     * Ensures the queue has room for at least the given number of elements, so that
+     * no further allocations happen until the queue grows beyond that size.
+     *
+     * @param capacity The number of elements to make room for.
      */
-    void enqueue(const DataPoint& data);
+    void reserve(int capacity);
 
     /**
      * Removes and returns the lowest-weight data point in the priority queue. If multiple
@@ -43,7 +241,7 @@ public:
      *
      * @return The lowest-weight data point in the queue.
      */
-    DataPoint dequeue();
+    T dequeue();
 
     /**
      * Returns, but does not remove, the element that would next be removed via a call to
@@ -55,7 +253,7 @@ public:
      *
      * @return
      */
-    DataPoint peek() const;
+    const T& peek() const;
 
     /**
      * Returns whether the priority queue is empty.
@@ -83,13 +281,97 @@ public:
     void printDebugInfo();
 
 private:
-    DataPoint* elems;
+    /* Constant controlling the default size of the priority queue. */
+    static const int initialSize = 5;
+
+    /* Whether the heap keeps its own copy of each key. It doesn't when the key extractor
+     * returns a reference, since then the key is already stored in the payload.
+     */
+    static constexpr bool keysInHeap =
+        !std::is_reference_v<decltype(std::declval<KeyOf>()(std::declval<const T&>()))>;
+
+    /* Type representing one node of the heap: the priority of an element, and the
+     * handle of the payload slot holding the element itself. Entries without a copy of
+     * the key are just the handle.
+     */
+    struct KeyedEntry {
+        Key key;
+        int handle;
+    };
+    struct HandleEntry {
+        int handle;
+    };
+    using Entry = std::conditional_t<keysInHeap, KeyedEntry, HandleEntry>;
+
+    /* The heap, in the usual implicit array layout. Only the first logicalSize
+     * entries are in use.
+     */
+    Entry* heap;
+
+    /* The elements, indexed by handle. Slots whose handles are free hold moved-from
+     * objects.
+     */
+    T* payloads;
+
+    /* Stack of the handles not currently in use. Since every handle is either in the
+     * heap or on this stack, the stack always holds allocatedSize - logicalSize handles.
+     */
+    int* freeHandles;
+
+    /* Index in the heap array of the entry for each handle, or NOT_IN_HEAP for handles
+     * that are free. Every write into the heap array goes through place, which keeps
+     * this in sync.
+     */
+    int* positions;
+
+    /* Constant marking a handle that has no entry in the heap. */
+    static const int NOT_IN_HEAP = -1;
+
     int allocatedSize;
     int logicalSize;
+    Compare compare;
+    KeyOf keyOf;
     void grow();
 
+    /* Index of the parent of the node at the given index, and of its first child. */
+    static int parentOf(int index);
+    static int firstChildOf(int index);
+
+    /* Hints to the processor that the given address will be read soon. */
+    static void prefetch(const void* address);
+
+    /* Returns the priority of the element the entry describes. */
+    const Key& keyIn(const Entry& entry) const;
+
+    /* Returns whether the first entry should come out of the queue before the second. */
+    bool before(const Entry& lhs, const Entry& rhs) const;
+
+    /* Returns the entry describing the element in the given payload slot. */
+    Entry entryFor(int handle) const;
 
+    /* Stores an element in a free payload slot and returns the entry describing it. */
+    Entry store(T&& data);
 
+    /* Puts the entry at the given index of the heap array and records its position. */
+    void place(int index, const Entry& entry);
+
+    /* Returns a handle to the free stack once its element has left the heap. */
+    void release(Handle handle);
+
+    /* Reports an error if the handle does not name an element in the queue. */
+    void checkHandle(Handle handle) const;
+
+    /* Moves the hole at the given index up or down until entry can be dropped into it
+     * without breaking the heap property, then places entry there.
+     */
+    void siftUp(int index, Entry entry);
+    void siftDown(int index, Entry entry);
+
+    /* Restores the heap property over the whole array using Floyd's bottom-up algorithm. */
+    void heapify();
+
+    /* Appends the elements of [first, last) to the end of the array without sifting them. */
+    template <typename ForwardIterator> int append(ForwardIterator first, ForwardIterator last);
 
     /* By default, C++ will let you copy objects. The problem is that the default copy
      * just does an element-by-element copy, which with pointers will give invalid results.
@@ -105,3 +387,410 @@ private:
     ALLOW_TEST_ACCESS();
 };
 
+
+/* * * * * * Implementation Below This Point * * * * * */
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+HeapPQueue<T, Compare, Arity, KeyOf>::HeapPQueue(const Compare& compare, const KeyOf& keyOf)
+    : compare(compare), keyOf(keyOf) {
+    allocatedSize = 0;
+    logicalSize = 0;
+    heap = nullptr;
+    payloads = nullptr;
+    freeHandles = nullptr;
+    positions = nullptr;
+    reserve(initialSize);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+template <typename ForwardIterator>
+HeapPQueue<T, Compare, Arity, KeyOf>::HeapPQueue(ForwardIterator first, ForwardIterator last,
+                                                 const Compare& compare, const KeyOf& keyOf)
+    : HeapPQueue(compare, keyOf) {
+    append(first, last);
+    heapify();
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+HeapPQueue<T, Compare, Arity, KeyOf>::~HeapPQueue() {
+    delete[] heap;
+    delete[] payloads;
+    delete[] freeHandles;
+    delete[] positions;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+int HeapPQueue<T, Compare, Arity, KeyOf>::parentOf(int index) {
+    return (index - 1) / Arity;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+int HeapPQueue<T, Compare, Arity, KeyOf>::firstChildOf(int index) {
+    return Arity * index + 1;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void) address;
+#endif
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+const typename HeapPQueue<T, Compare, Arity, KeyOf>::Key&
+HeapPQueue<T, Compare, Arity, KeyOf>::keyIn(const Entry& entry) const {
+    if constexpr (keysInHeap) {
+        return entry.key;
+    } else {
+        return keyOf(payloads[entry.handle]);
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+bool HeapPQueue<T, Compare, Arity, KeyOf>::before(const Entry& lhs, const Entry& rhs) const {
+    return compare(keyIn(lhs), keyIn(rhs));
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+typename HeapPQueue<T, Compare, Arity, KeyOf>::Entry
+HeapPQueue<T, Compare, Arity, KeyOf>::entryFor(int handle) const {
+    if constexpr (keysInHeap) {
+        return { keyOf(payloads[handle]), handle };
+    } else {
+        return { handle };
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+typename HeapPQueue<T, Compare, Arity, KeyOf>::Entry
+HeapPQueue<T, Compare, Arity, KeyOf>::store(T&& data) {
+    /* Every handle above the free stack's top is in use, so the top is at this index. */
+    int handle = freeHandles[allocatedSize - logicalSize - 1];
+    payloads[handle] = std::move(data);
+    return entryFor(handle);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::place(int index, const Entry& entry) {
+    heap[index] = entry;
+    positions[entry.handle] = index;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::release(Handle handle) {
+    positions[handle] = NOT_IN_HEAP;
+    /* logicalSize has already dropped, so this is the slot just above the stack's top. */
+    freeHandles[allocatedSize - logicalSize - 1] = handle;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::checkHandle(Handle handle) const {
+    if (!contains(handle)) {
+        error("That handle does not refer to an element in the heap!");
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+typename HeapPQueue<T, Compare, Arity, KeyOf>::Handle
+HeapPQueue<T, Compare, Arity, KeyOf>::enqueue(const T& data) {
+    return enqueue(T(data));
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+typename HeapPQueue<T, Compare, Arity, KeyOf>::Handle
+HeapPQueue<T, Compare, Arity, KeyOf>::enqueue(T&& data) {
+    if (allocatedSize == logicalSize) {
+        grow();
+    }
+    Entry entry = store(std::move(data));
+    /* The new entry starts out as a hole at the end of the array. */
+    logicalSize++;
+    siftUp(logicalSize - 1, entry);
+    return entry.handle;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+bool HeapPQueue<T, Compare, Arity, KeyOf>::offer(const T& data, int maxSize) {
+    if (logicalSize >= maxSize && (isEmpty() || !compare(keyIn(heap[0]), keyOf(data)))) {
+        return false;
+    }
+    return offer(T(data), maxSize);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+bool HeapPQueue<T, Compare, Arity, KeyOf>::offer(T&& data, int maxSize) {
+    if (logicalSize < maxSize) {
+        enqueue(std::move(data));
+        return true;
+    }
+    /* Full: only something that outranks the current front earns a place. */
+    if (isEmpty() || !compare(keyIn(heap[0]), keyOf(data))) {
+        return false;
+    }
+    replaceTop(std::move(data));
+    return true;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+T HeapPQueue<T, Compare, Arity, KeyOf>::pushPop(T data) {
+    if (isEmpty() || !compare(keyIn(heap[0]), keyOf(data))) {
+        return data;
+    }
+    return replaceTop(std::move(data));
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+T HeapPQueue<T, Compare, Arity, KeyOf>::replaceTop(T data) {
+    if (isEmpty()) {
+        error("You need to have at least one element in the heap!");
+    }
+    int handle = heap[0].handle;
+    T result = std::move(payloads[handle]);
+    payloads[handle] = std::move(data);
+    siftDown(0, entryFor(handle));
+    return result;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::updatePriority(Handle handle, const Key& key) {
+    checkHandle(handle);
+    int index = positions[handle];
+    /* A higher priority can only move the entry up; a lower one can only move it down.
+     * This has to be decided before the key is written, since the entry in the heap may
+     * read its key out of the payload.
+     */
+    bool raised = compare(key, keyIn(heap[index]));
+    keyOf.set(payloads[handle], key);
+
+    if (raised) {
+        siftUp(index, entryFor(handle));
+    } else {
+        siftDown(index, entryFor(handle));
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::erase(Handle handle) {
+    checkHandle(handle);
+    int index = positions[handle];
+    logicalSize--;
+
+    /* Fill the hole with the last entry. It came from a different subtree, so it may
+     * need to go either up or down from here.
+     */
+    if (index != logicalSize) {
+        Entry last = heap[logicalSize];
+        if (index > 0 && before(last, heap[parentOf(index)])) {
+            siftUp(index, last);
+        } else {
+            siftDown(index, last);
+        }
+    }
+    release(handle);
+    /* Destroy the element now rather than whenever its slot gets reused. */
+    payloads[handle] = T();
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+bool HeapPQueue<T, Compare, Arity, KeyOf>::contains(Handle handle) const {
+    return handle >= 0 && handle < allocatedSize && positions[handle] != NOT_IN_HEAP;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+const T& HeapPQueue<T, Compare, Arity, KeyOf>::get(Handle handle) const {
+    checkHandle(handle);
+    return payloads[handle];
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+template <typename Function>
+void HeapPQueue<T, Compare, Arity, KeyOf>::forEach(Function function) const {
+    for (int i = 0; i < logicalSize; i++) {
+        function(payloads[heap[i].handle]);
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+template <typename Range>
+void HeapPQueue<T, Compare, Arity, KeyOf>::enqueueAll(const Range& range) {
+    int oldSize = logicalSize;
+    int added = append(std::begin(range), std::end(range));
+    if (added >= oldSize) {
+        heapify();
+    } else {
+        for (int i = oldSize; i < logicalSize; i++) {
+            siftUp(i, heap[i]);
+        }
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+template <typename ForwardIterator>
+int HeapPQueue<T, Compare, Arity, KeyOf>::append(ForwardIterator first, ForwardIterator last) {
+    int added = int(std::distance(first, last));
+    reserve(logicalSize + added);
+    for (; first != last; ++first) {
+        place(logicalSize, store(T(*first)));
+        logicalSize++;
+    }
+    return added;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::heapify() {
+    /* Leaves are already heaps, so start from the last internal node and work backward. */
+    for (int i = parentOf(logicalSize - 1); i >= 0 && logicalSize > 1; i--) {
+        siftDown(i, heap[i]);
+    }
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+int HeapPQueue<T, Compare, Arity, KeyOf>::size() const {
+    return logicalSize;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+const T& HeapPQueue<T, Compare, Arity, KeyOf>::peek() const {
+    if (isEmpty()) {
+        error("You need to have at least one element in the heap!");
+    }
+    return payloads[heap[0].handle];
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+T HeapPQueue<T, Compare, Arity, KeyOf>::dequeue() {
+    if (isEmpty()) {
+        error("You need to have at least one element in the heap!");
+    }
+    int handle = heap[0].handle;
+    logicalSize--;
+    /* The payload is the one part of the queue we touch that isn't in the heap array,
+     * so start pulling it into the cache now and let the sift below hide the miss.
+     */
+    prefetch(&payloads[handle]);
+    /* The root is now a hole. Rather than comparing the last entry against the children
+     * at every level, walk the hole all the way down to a leaf along the path of
+     * highest-priority children, then drop the last entry in there and sift it back up.
+     * The last entry almost always belongs near the bottom, so this saves about half the
+     * comparisons, and the ones left over are much easier to predict.
+     */
+    if (logicalSize > 0) {
+        int hole = 0;
+        while (firstChildOf(hole) < logicalSize) {
+            int first = firstChildOf(hole);
+            int last  = std::min(first + Arity, logicalSize);
+            int best  = first;
+            for (int child = first + 1; child < last; child++) {
+                if (before(heap[child], heap[best])) {
+                    best = child;
+                }
+            }
+            place(hole, heap[best]);
+            hole = best;
+        }
+        siftUp(hole, heap[logicalSize]);
+    }
+    release(handle);
+    return std::move(payloads[handle]);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::siftUp(int index, Entry entry) {
+    while (index > 0 && before(entry, heap[parentOf(index)])) {
+        place(index, heap[parentOf(index)]);
+        index = parentOf(index);
+    }
+    place(index, entry);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::siftDown(int index, Entry entry) {
+    while (firstChildOf(index) < logicalSize) {
+        /* Find the highest-priority child. Ties go to the leftmost child. */
+        int first = firstChildOf(index);
+        int last  = std::min(first + Arity, logicalSize);
+        int best  = first;
+        for (int child = first + 1; child < last; child++) {
+            if (before(heap[child], heap[best])) {
+                best = child;
+            }
+        }
+        if (!before(heap[best], entry)) {
+            break;
+        }
+        place(index, heap[best]);
+        index = best;
+    }
+    place(index, entry);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+bool HeapPQueue<T, Compare, Arity, KeyOf>::isEmpty() const {
+    return size() == 0;
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::grow() {
+    reserve(allocatedSize * 2);
+}
+
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::reserve(int capacity) {
+    if (capacity <= allocatedSize) {
+        return;
+    }
+    Entry* newHeap = new Entry[capacity];
+    T* newPayloads = new T[capacity];
+    int* newFree = new int[capacity];
+    int* newPositions = new int[capacity];
+
+    /* Entries and payloads keep their positions and handles. */
+    for (int i = 0; i < logicalSize; i++) {
+        newHeap[i] = heap[i];
+    }
+    for (int i = 0; i < allocatedSize; i++) {
+        newPayloads[i] = std::move(payloads[i]);
+        newPositions[i] = positions[i];
+    }
+    for (int i = allocatedSize; i < capacity; i++) {
+        newPositions[i] = NOT_IN_HEAP;
+    }
+
+    /* The brand-new handles go at the bottom of the free stack, and the old free
+     * handles stay on top of them so they get reused first.
+     */
+    int numFree = 0;
+    for (int handle = capacity - 1; handle >= allocatedSize; handle--) {
+        newFree[numFree] = handle;
+        numFree++;
+    }
+    for (int i = 0; i < allocatedSize - logicalSize; i++) {
+        newFree[numFree] = freeHandles[i];
+        numFree++;
+    }
+
+    delete[] heap;
+    delete[] payloads;
+    delete[] freeHandles;
+    delete[] positions;
+    heap = newHeap;
+    payloads = newPayloads;
+    freeHandles = newFree;
+    positions = newPositions;
+    allocatedSize = capacity;
+}
+
+/*
+ *This function prints out each element in the the array.
+ */
+template <typename T, typename Compare, int Arity, typename KeyOf>
+void HeapPQueue<T, Compare, Arity, KeyOf>::printDebugInfo() {
+    int i = 0;
+    while (i < logicalSize) {
+        std::cout<< keyIn(heap[i]) << " (handle " << heap[i].handle << "): "
+                 << payloads[heap[i].handle] <<std::endl;
+        i++;
+    }
+}
@@ -0,0 +1,127 @@
+#include "KeyArena.h"
+#include "vector.h"
+#include <algorithm>
+#include <cstring>
+#include <utility>
+using namespace std;
+
+/* This program implements the arena that the compact hash tables keep their keys in. */
+
+KeyArena::~KeyArena() {
+    delete[] buffer;
+}
+
+ArenaKey KeyArena::add(string_view key) {
+    ArenaKey result;
+    result.length = key.size();
+    if (result.isInline()) {
+        memcpy(result.bytes, key.data(), key.size());
+        return result;
+    }
+
+    /* Double the buffer whenever it runs out, so appends take amortized O(1) copies. */
+    if (logicalSize + key.size() > allocatedSize) {
+        size_t newSize = max(2 * allocatedSize, logicalSize + key.size());
+        char* newBuffer = new char[newSize];
+        if (logicalSize > 0) {
+            memcpy(newBuffer, buffer, logicalSize);
+        }
+        delete[] buffer;
+        buffer = newBuffer;
+        allocatedSize = newSize;
+    }
+    memcpy(buffer + logicalSize, key.data(), key.size());
+    uint64_t offset = logicalSize;
+    memcpy(result.bytes, &offset, sizeof(offset));
+    logicalSize += key.size();
+    return result;
+}
+
+string_view KeyArena::view(const ArenaKey& key) const {
+    if (key.isInline()) {
+        return string_view(key.bytes, key.length);
+    }
+    uint64_t offset;
+    memcpy(&offset, key.bytes, sizeof(offset));
+    return string_view(buffer + offset, key.length);
+}
+
+bool KeyArena::equals(const ArenaKey& key, string_view other) const {
+    /* Lengths are right there in the slot, so most mismatches never touch the arena. */
+    return key.length == other.size() && view(key) == other;
+}
+
+void KeyArena::release(const ArenaKey& key) {
+    if (!key.isInline()) {
+        garbage += key.length;
+    }
+}
+
+size_t KeyArena::bytesAllocated() const {
+    return allocatedSize;
+}
+
+size_t KeyArena::bytesUsed() const {
+    return logicalSize;
+}
+
+size_t KeyArena::garbageBytes() const {
+    return garbage;
+}
+
+void KeyArena::swap(KeyArena& other) {
+    std::swap(buffer, other.buffer);
+    std::swap(allocatedSize, other.allocatedSize);
+    std::swap(logicalSize, other.logicalSize);
+    std::swap(garbage, other.garbage);
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("Arena keys are sixteen bytes, with short keys stored inline.") {
+    EXPECT_EQUAL(sizeof(ArenaKey), 16);
+
+    KeyArena arena;
+    ArenaKey empty = arena.add("");
+    ArenaKey shortKey = arena.add("twelve chars");
+    EXPECT(empty.isInline());
+    EXPECT(shortKey.isInline());
+    EXPECT_EQUAL(arena.view(empty), "");
+    EXPECT_EQUAL(arena.view(shortKey), "twelve chars");
+    EXPECT_EQUAL(arena.bytesAllocated(), 0);
+}
+
+STUDENT_TEST("Long keys are appended to the arena and survive it growing.") {
+    KeyArena arena;
+    Vector<ArenaKey> keys;
+    Vector<string> expected;
+    for (int i = 0; i < 1000; i++) {
+        string key = "https://example.com/" + to_string(i);
+        keys += arena.add(key);
+        expected += key;
+    }
+    for (int i = 0; i < keys.size(); i++) {
+        EXPECT(!keys[i].isInline());
+        EXPECT_EQUAL(arena.view(keys[i]), expected[i]);
+        EXPECT(arena.equals(keys[i], expected[i]));
+        EXPECT(!arena.equals(keys[i], expected[i] + "/"));
+    }
+    EXPECT(arena.bytesAllocated() >= arena.bytesUsed());
+}
+
+STUDENT_TEST("Released keys are counted as garbage, and swapping moves everything.") {
+    KeyArena arena;
+    ArenaKey kept = arena.add("a key that is long enough");
+    ArenaKey dropped = arena.add("another key that is long");
+    arena.release(dropped);
+    arena.release(arena.add("short"));
+    EXPECT_EQUAL(arena.garbageBytes(), string("another key that is long").size());
+
+    KeyArena fresh;
+    ArenaKey moved = fresh.add(arena.view(kept));
+    fresh.swap(arena);
+    EXPECT_EQUAL(arena.view(moved), "a key that is long enough");
+    EXPECT_EQUAL(arena.garbageBytes(), 0);
+    EXPECT_EQUAL(fresh.view(kept), "a key that is long enough");
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "GUI/SimpleTest.h"
+#include "Demos/Utility.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * A key as stored in a hash table slot, in a fixed sixteen bytes. Keys of up to
+ * kInlineLength characters are kept right inside it; longer keys live in a KeyArena,
+ * and this holds their offset there instead.
+ *
+ * Compare this to a std::string, which takes 32 bytes in a slot and puts anything past
+ * fifteen characters in its own heap allocation.
+ */
+struct ArenaKey {
+    static const int kInlineLength = 12;
+
+    std::uint32_t length;
+    char bytes[kInlineLength];
+
+    /* Whether the characters are in bytes rather than in an arena. */
+    bool isInline() const {
+        return length <= kInlineLength;
+    }
+};
+
+/**
+ * Contiguous storage for the characters of long keys. Keys are only ever appended, so
+ * adding one is a copy onto the end of a buffer that grows by doubling. Released keys
+ * leave garbage behind, which the owner reclaims by copying the live keys into a fresh
+ * arena once there's enough of it.
+ *
+ * Since slots only hold offsets, moving slots around - during a rehash, say - never
+ * touches the characters themselves.
+ */
+class KeyArena {
+public:
+    /**
+     * Creates an empty arena. Nothing is allocated until the first long key arrives.
+     */
+    KeyArena() = default;
+
+    /**
+     * Frees the arena's buffer.
+     */
+    ~KeyArena();
+
+    /**
+     * Stores a key, copying it into the arena if it's too long to be inline.
+     */
+    ArenaKey add(std::string_view key);
+
+    /**
+     * Returns the characters of a key. The view points into the arena, or into the
+     * ArenaKey itself for inline keys, so it's only good until either one changes.
+     */
+    std::string_view view(const ArenaKey& key) const;
+
+    /**
+     * Returns whether a stored key has the given characters.
+     */
+    bool equals(const ArenaKey& key, std::string_view other) const;
+
+    /**
+     * Notes that a key is no longer in use. Its characters stay where they are, as
+     * garbage, until the arena is compacted.
+     */
+    void release(const ArenaKey& key);
+
+    /**
+     * Bytes in the buffer, bytes of it holding keys (live or not), and bytes holding
+     * released keys.
+     */
+    std::size_t bytesAllocated() const;
+    std::size_t bytesUsed() const;
+    std::size_t garbageBytes() const;
+
+    /**
+     * Exchanges contents with another arena. Compaction is done by adding every live
+     * key to a fresh arena, then swapping it in.
+     */
+    void swap(KeyArena& other);
+
+private:
+    char* buffer = nullptr;
+    std::size_t allocatedSize = 0;
+    std::size_t logicalSize = 0;
+    std::size_t garbage = 0;
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(KeyArena);
+    ALLOW_TEST_ACCESS();
+};
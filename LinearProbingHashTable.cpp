@@ -1,5 +1,8 @@
 #include "LinearProbingHashTable.h"
 #include "GUI/SimpleTest.h"
+#include "error.h"
+#include "vector.h"
+#include <algorithm>
 using namespace std;
 /* This program implements the linear probing hash table with given hash functions. */
 
@@ -14,6 +17,16 @@ LinearProbingHashTable::LinearProbingHashTable(HashFunction<std::string> hashFn)
     }
 }
 
+LinearProbingHashTable::LinearProbingHashTable(HashFunction<std::string> hashFn, Deletion deletion,
+                                               double maxTombstoneLoad)
+    : LinearProbingHashTable(hashFn) {
+    if (!(0 < maxTombstoneLoad && maxTombstoneLoad <= 1)) {
+        error("The tombstone load must be above 0 and at most 1.");
+    }
+    this->deletion = deletion;
+    this->maxTombstoneLoad = maxTombstoneLoad;
+}
+
 LinearProbingHashTable::~LinearProbingHashTable() {
     delete[] elems;
 }
@@ -34,7 +47,10 @@ int LinearProbingHashTable::findElement (const string& elem) const {
     if (isEmpty()) {
         return -1;
     }
-    int code = Hash(elem);
+    return findElement(elem, Hash(elem));
+}
+
+int LinearProbingHashTable::findElement (const string& elem, int code) const {
     for (int i = 0; i < allocatedSize; i++ ) {
         //Only looks at an item's value if its type is FILLED.
         if (elems[(code+i) % allocatedSize].type == SlotType::FILLED) {
@@ -51,19 +67,58 @@ int LinearProbingHashTable::findElement (const string& elem) const {
 
 
 bool LinearProbingHashTable::contains(const string& elem) const {
+    if (probeCounting) {
+        probeCounters.lookups ++;
+        probeCounters.lookupProbes += probesFor(elem);
+    }
     return findElement(elem) != -1 ? true : false;
 }
 
+/* Asks the processor to start loading the given address into the cache. */
+static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void) address;
+#endif
+}
+
+Vector<bool> LinearProbingHashTable::containsBatch(const Vector<string>& keys) const {
+    Vector<bool> result(keys.size());
+    if (isEmpty()) {
+        return result;
+    }
+    int codes[kBatchSize];
+    for (int start = 0; start < keys.size(); start += kBatchSize) {
+        int end = min(start + kBatchSize, keys.size());
+        for (int i = start; i < end; i++) {
+            codes[i - start] = Hash(keys[i]);
+            prefetch(&elems[codes[i - start]]);
+        }
+        for (int i = start; i < end; i++) {
+            result[i] = findElement(keys[i], codes[i - start]) != -1;
+        }
+    }
+    return result;
+}
+
 
 bool LinearProbingHashTable::insert(const string& elem) {
+    if (probeCounting) {
+        probeCounters.insertions ++;
+        probeCounters.insertionProbes += probesFor(elem);
+    }
     /* Checks in case that the table is full or already contains the element to be inserted. */
-    if (logicalSize == allocatedSize || contains(elem)) {
+    if (logicalSize == allocatedSize || findElement(elem) != -1) {
         return false;
     }
     int code = Hash(elem);
     for (int i = 0; i < allocatedSize; i++ ) {
         /* Adds the element to this slot if it's empty or a tombstone. */
         if (elems[(code+i) % allocatedSize].type != SlotType::FILLED) {
+            if (elems[(code+i) % allocatedSize].type == SlotType::TOMBSTONE) {
+                tombstones --;
+            }
             elems[(code+i) % allocatedSize].value = elem;
             elems[(code+i) % allocatedSize].type = SlotType::FILLED;
             logicalSize ++;
@@ -75,16 +130,116 @@ bool LinearProbingHashTable::insert(const string& elem) {
 
 
 bool LinearProbingHashTable::remove(const string& elem) {
+    if (probeCounting) {
+        probeCounters.removals ++;
+        probeCounters.removalProbes += probesFor(elem);
+    }
     int index = findElement(elem);
     /* If the hash table contains this element, it accesses it by its index position and marks it as a tombstone. */
     if (index != -1) {
-        elems[index].type = SlotType::TOMBSTONE;
+        if (deletion == Deletion::BACKWARD_SHIFT) {
+            shiftBackInto(index);
+        } else {
+            elems[index].type = SlotType::TOMBSTONE;
+            tombstones ++;
+        }
         logicalSize --;
+        if (deletion == Deletion::COMPACTING && tombstones > maxTombstoneLoad * allocatedSize) {
+            compact();
+        }
         return true;
     }
     return false;
 }
 
+int LinearProbingHashTable::numTombstones() const {
+    return tombstones;
+}
+
+int LinearProbingHashTable::nextSlot(int index) const {
+    return index + 1 == allocatedSize ? 0 : index + 1;
+}
+
+void LinearProbingHashTable::place(string&& value) {
+    int index = Hash(value);
+    while (elems[index].type != SlotType::EMPTY) {
+        index = nextSlot(index);
+    }
+    elems[index].value = std::move(value);
+    elems[index].type = SlotType::FILLED;
+}
+
+/* Walks the run after the hole. An element can move back into the hole if the hole lies
+ * between its home slot and where it is now, since then it would have been placed there
+ * had the slot been free; the hole then moves to where that element was. The run ends at
+ * the first empty slot, or after one lap of a table with none.
+ */
+void LinearProbingHashTable::shiftBackInto(int index) {
+    int hole = index;
+    int next = nextSlot(hole);
+    for (int steps = 1; steps < allocatedSize && elems[next].type != SlotType::EMPTY; steps++) {
+        int home = Hash(elems[next].value);
+        int fromHome = (next - home + allocatedSize) % allocatedSize;
+        int fromHole = (next - hole + allocatedSize) % allocatedSize;
+        if (fromHome >= fromHole) {
+            elems[hole].value = std::move(elems[next].value);
+            elems[hole].type = SlotType::FILLED;
+            hole = next;
+        }
+        next = nextSlot(next);
+    }
+    elems[hole].value.clear();
+    elems[hole].type = SlotType::EMPTY;
+}
+
+/* Reinserting elements in order, starting just past a slot that was empty all along,
+ * keeps the table valid throughout. Each element's probe sequence used to run from its
+ * home slot to where it sat without crossing that empty slot, so the element can only
+ * move back toward its home, into a slot it has already passed over, and never past an
+ * element that was put back before it. With no such empty slot to start from, the
+ * elements are all taken out first and then put back.
+ */
+void LinearProbingHashTable::compact() {
+    if (tombstones == 0) {
+        return;
+    }
+    int start = -1;
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].type == SlotType::EMPTY && start == -1) {
+            start = i;
+        }
+        if (elems[i].type == SlotType::TOMBSTONE) {
+            elems[i].value.clear();
+            elems[i].type = SlotType::EMPTY;
+        }
+    }
+    tombstones = 0;
+
+    if (start != -1) {
+        for (int step = 1; step < allocatedSize; step++) {
+            int index = (start + step) % allocatedSize;
+            if (elems[index].type == SlotType::FILLED) {
+                string value = std::move(elems[index].value);
+                elems[index].type = SlotType::EMPTY;
+                place(std::move(value));
+            }
+        }
+    } else {
+        string* values = new string[logicalSize];
+        int numValues = 0;
+        for (int i = 0; i < allocatedSize; i++) {
+            if (elems[i].type == SlotType::FILLED) {
+                values[numValues++] = std::move(elems[i].value);
+                elems[i].type = SlotType::EMPTY;
+            }
+        }
+        for (int i = 0; i < numValues; i++) {
+            place(std::move(values[i]));
+        }
+        delete[] values;
+    }
+}
+
 /* Prints out the content of the hash table. */
 void LinearProbingHashTable::printDebugInfo() const {
     for (int i = 0; i < allocatedSize; i++) {
@@ -92,23 +247,572 @@ void LinearProbingHashTable::printDebugInfo() const {
     }
 }
 
+/* Walks the same slots findElement would, counting them. */
+int LinearProbingHashTable::probesFor(const string& elem) const {
+    int code = Hash(elem);
+    for (int i = 0; i < allocatedSize; i++) {
+        const Slot& slot = elems[(code + i) % allocatedSize];
+        if (slot.type == SlotType::EMPTY || (slot.type == SlotType::FILLED && slot.value == elem)) {
+            return i + 1;
+        }
+    }
+    return allocatedSize;
+}
+
+void LinearProbingHashTable::setProbeCounting(bool enabled) {
+    probeCounting = enabled;
+    probeCounters = ProbeCounters();
+}
+
+/* An element's distance from home is how far past its hash code it sits. Tombstones
+ * count toward clusters, since probes walk past them just like elements.
+ */
+HashTableStats LinearProbingHashTable::stats() const {
+    Vector<int> histogram;
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].type == SlotType::FILLED) {
+            int distance = (i - Hash(elems[i].value) + allocatedSize) % allocatedSize;
+            while (histogram.size() <= distance) histogram.add(0);
+            histogram[distance] ++;
+        }
+    }
+    HashTableStats result = makeHashTableStats(allocatedSize, tombstones, histogram, [&](int i) {
+        return elems[i].type != SlotType::EMPTY;
+    });
+    result.counters = probeCounters;
+    return result;
+}
+
+
+/* * * * * * Arena-Backed Table * * * * * */
+
+ArenaLinearProbingHashTable::ArenaLinearProbingHashTable(HashFunction<string> hashFn) {
+    logicalSize = 0;
+    allocatedSize = hashFn.numSlots();
+    Hash = hashFn;
+    elems = new Slot[allocatedSize];
+    for (int i = 0; i < allocatedSize; i++) {
+        elems[i].type = SlotType::EMPTY;
+    }
+}
+
+ArenaLinearProbingHashTable::~ArenaLinearProbingHashTable() {
+    delete[] elems;
+}
+
+bool ArenaLinearProbingHashTable::isEmpty() const {
+    return size() == 0;
+}
+
+int ArenaLinearProbingHashTable::size() const {
+    return logicalSize;
+}
+
+int ArenaLinearProbingHashTable::nextSlot(int index) const {
+    return index + 1 == allocatedSize ? 0 : index + 1;
+}
+
+int ArenaLinearProbingHashTable::findElement(const string& key) const {
+    if (isEmpty()) {
+        return -1;
+    }
+    int index = Hash(key);
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[index].type == SlotType::EMPTY) {
+            return -1;
+        }
+        if (elems[index].type == SlotType::FILLED && arena.equals(elems[index].key, key)) {
+            return index;
+        }
+        index = nextSlot(index);
+    }
+    return -1;
+}
+
+bool ArenaLinearProbingHashTable::contains(const string& key) const {
+    return findElement(key) != -1;
+}
+
+bool ArenaLinearProbingHashTable::insert(const string& key) {
+    if (logicalSize == allocatedSize || contains(key)) {
+        return false;
+    }
+    /* Take the first slot that's empty or a tombstone. */
+    int index = Hash(key);
+    while (elems[index].type == SlotType::FILLED) {
+        index = nextSlot(index);
+    }
+    elems[index] = { arena.add(key), SlotType::FILLED };
+    logicalSize++;
+    return true;
+}
+
+bool ArenaLinearProbingHashTable::remove(const string& key) {
+    int index = findElement(key);
+    if (index == -1) {
+        return false;
+    }
+    arena.release(elems[index].key);
+    elems[index].type = SlotType::TOMBSTONE;
+    logicalSize--;
+
+    compactArena();
+    return true;
+}
+
+void ArenaLinearProbingHashTable::compactArena() {
+    /* Waiting until garbage is most of the arena keeps the copying amortized O(1). */
+    if (arena.garbageBytes() <= arena.bytesUsed() / 2) {
+        return;
+    }
+    KeyArena fresh;
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].type == SlotType::FILLED) {
+            elems[i].key = fresh.add(arena.view(elems[i].key));
+        }
+    }
+    arena.swap(fresh);
+}
+
+void ArenaLinearProbingHashTable::rehash(HashFunction<string> hashFn) {
+    if (hashFn.numSlots() < logicalSize) {
+        error("The new hash function doesn't have room for every element.");
+    }
+    Slot* oldElems = elems;
+    int oldSize = allocatedSize;
+
+    allocatedSize = hashFn.numSlots();
+    Hash = hashFn;
+    elems = new Slot[allocatedSize];
+    for (int i = 0; i < allocatedSize; i++) {
+        elems[i].type = SlotType::EMPTY;
+    }
+
+    /* The hash function takes a std::string, so reuse one buffer for every key rather
+     * than allocating a string apiece.
+     */
+    string scratch;
+    for (int i = 0; i < oldSize; i++) {
+        if (oldElems[i].type != SlotType::FILLED) continue;
+        scratch.assign(arena.view(oldElems[i].key));
+        int index = Hash(scratch);
+        while (elems[index].type == SlotType::FILLED) {
+            index = nextSlot(index);
+        }
+        elems[index] = oldElems[i];
+    }
+    delete[] oldElems;
+}
+
+size_t ArenaLinearProbingHashTable::bytesUsed() const {
+    return allocatedSize * sizeof(Slot) + arena.bytesAllocated();
+}
+
+void ArenaLinearProbingHashTable::printDebugInfo() const {
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].type == SlotType::FILLED) {
+            cout << arena.view(elems[i].key) << endl;
+        } else {
+            cout << (elems[i].type == SlotType::EMPTY ? "(empty)" : "(tombstone)") << endl;
+        }
+    }
+}
+
 
 /* * * * * * Test Cases Below This Point * * * * * */
 
 /* Optional: Add your own custom tests here! */
 
+STUDENT_TEST("Arena table agrees with a reference set, for short and long keys.") {
+    ArenaLinearProbingHashTable table(Hash::random(500));
+    Vector<bool> present(400);
+    auto keyFor = [](int i) {
+        /* Every other key is too long to store inline. */
+        return i % 2 == 0 ? to_string(i) : "a much longer key, number " + to_string(i);
+    };
+    for (int round = 0; round < 20000; round++) {
+        int i = randomInteger(0, present.size() - 1);
+        if (randomInteger(0, 1) == 0) {
+            EXPECT_EQUAL(table.insert(keyFor(i)), !present[i]);
+            present[i] = true;
+        } else {
+            EXPECT_EQUAL(table.remove(keyFor(i)), bool(present[i]));
+            present[i] = false;
+        }
+        EXPECT_EQUAL(table.contains(keyFor(i)), bool(present[i]));
+    }
+    /* All that churn must not let the arena fill up with dead keys. */
+    EXPECT(table.arena.garbageBytes() <= table.arena.bytesUsed() / 2);
 
+    /* Rehashing clears out the tombstones. */
+    table.rehash(Hash::random(1000));
+    for (int i = 0; i < table.allocatedSize; i++) {
+        EXPECT(table.elems[i].type != ArenaLinearProbingHashTable::SlotType::TOMBSTONE);
+    }
+    for (int i = 0; i < present.size(); i++) {
+        EXPECT_EQUAL(table.contains(keyFor(i)), bool(present[i]));
+    }
+}
 
+STUDENT_TEST("Arena table fills up like the original, and won't rehash into too little room.") {
+    ArenaLinearProbingHashTable table(Hash::constant(10, 7));
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT(!table.insert("10"));
+    EXPECT(!table.insert("0"));
+    EXPECT_ERROR(table.rehash(Hash::random(9)));
+    EXPECT(table.remove("0"));
+    EXPECT_EQUAL(table.elems[7].type, ArenaLinearProbingHashTable::SlotType::TOMBSTONE);
+    EXPECT(table.insert("10"));
+    EXPECT_EQUAL(table.elems[7].type, ArenaLinearProbingHashTable::SlotType::FILLED);
+}
 
+STUDENT_TEST("Memory per key: std::string slots versus arena slots.") {
+    /* Bytes the original table uses: its slots, plus a heap block for every string too
+     * long to keep inside itself.
+     */
+    auto stringTableBytes = [](const LinearProbingHashTable& table) {
+        size_t bytes = table.allocatedSize * sizeof(LinearProbingHashTable::Slot);
+        for (int i = 0; i < table.allocatedSize; i++) {
+            const string& key = table.elems[i].value;
+            if (table.elems[i].type == LinearProbingHashTable::SlotType::FILLED &&
+                key.capacity() > string().capacity()) {
+                bytes += key.capacity() + 1;
+            }
+        }
+        return bytes;
+    };
 
+    cout << "    Slot size: " << sizeof(LinearProbingHashTable::Slot) << " bytes with std::string, "
+         << sizeof(ArenaLinearProbingHashTable::Slot) << " bytes with ArenaKey" << endl;
 
+    const int kElems = 100000;
+    for (string prefix: { "", "https://www.example.com/items/" }) {
+        LinearProbingHashTable strings(Hash::random(kElems / 0.8));
+        ArenaLinearProbingHashTable arenas(Hash::random(kElems / 0.8));
+        for (int i = 0; i < kElems; i++) {
+            strings.insert(prefix + to_string(i));
+            arenas.insert(prefix + to_string(i));
+        }
+        cout << "    " << (prefix.empty() ? "Short" : "Long") << " keys: "
+             << double(stringTableBytes(strings)) / kElems << " bytes/key with std::string, "
+             << double(arenas.bytesUsed()) / kElems << " bytes/key with the arena" << endl;
+        EXPECT(arenas.bytesUsed() < stringTableBytes(strings));
+
+        auto findAll = [&](const auto& table) {
+            int found = 0;
+            for (int i = 0; i < kElems; i++) found += table.contains(prefix + to_string(i));
+            return found;
+        };
+        TIME_OPERATION(kElems, findAll(strings));
+        TIME_OPERATION(kElems, findAll(arenas));
+        EXPECT_EQUAL(findAll(arenas), kElems);
+    }
+}
 
+STUDENT_TEST("Tombstones are counted, and the default table keeps them.") {
+    LinearProbingHashTable table(Hash::zero(10));
+    for (int i = 0; i < 6; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    for (int i = 0; i < 3; i++) {
+        EXPECT(table.remove(to_string(i)));
+    }
+    EXPECT_EQUAL(table.numTombstones(), 3);
+    EXPECT(!table.remove("0"));
+    EXPECT_EQUAL(table.numTombstones(), 3);
 
+    /* Inserting over a tombstone uses it up. */
+    EXPECT(table.insert("6"));
+    EXPECT_EQUAL(table.numTombstones(), 2);
+    EXPECT_EQUAL(table.elems[0], { "6", LinearProbingHashTable::SlotType::FILLED });
+}
 
+STUDENT_TEST("compact() moves elements back over tombstones, in place.") {
+    /* Everything wants slot zero. Form this pattern:
+     *
+     *    T  T  T  3  4  5  .  .  .  .
+     */
+    LinearProbingHashTable table(Hash::zero(10));
+    for (int i = 0; i < 6; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    for (int i = 0; i < 3; i++) {
+        EXPECT(table.remove(to_string(i)));
+    }
 
+    /* That should become
+     *
+     *    3  4  5  .  .  .  .  .  .  .
+     */
+    LinearProbingHashTable::Slot* before = table.elems;
+    table.compact();
+    EXPECT_EQUAL(table.elems, before);
+    EXPECT_EQUAL(table.numTombstones(), 0);
+    for (int i = 0; i < 10; i++) {
+        if (i < 3) {
+            EXPECT_EQUAL(table.elems[i], { to_string(i + 3), LinearProbingHashTable::SlotType::FILLED });
+        } else {
+            EXPECT_EQUAL(table.elems[i].type, LinearProbingHashTable::SlotType::EMPTY);
+        }
+    }
+    EXPECT_EQUAL(table.size(), 3);
+}
 
+STUDENT_TEST("compact() works when no slot was ever left empty.") {
+    /* Everything wants slot 7, and the table wraps around: 3 4 5 6 7 8 9 0 1 2 */
+    LinearProbingHashTable table(Hash::constant(10, 7));
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT(table.remove("1"));
+    EXPECT(table.remove("8"));
+    table.compact();
+    EXPECT_EQUAL(table.numTombstones(), 0);
+    for (int i = 0; i < 10; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), i != 1 && i != 8);
+    }
+    EXPECT_EQUAL(table.elems[5].type, LinearProbingHashTable::SlotType::EMPTY);
+    EXPECT_EQUAL(table.elems[6].type, LinearProbingHashTable::SlotType::EMPTY);
+}
 
+STUDENT_TEST("Backward-shift deletion pulls elements back without tombstones.") {
+    /* Lay out the table as
+     *
+     *    .  1  2  3 13  5  .  .  .  .
+     */
+    LinearProbingHashTable table(Hash::identity(10), LinearProbingHashTable::Deletion::BACKWARD_SHIFT);
+    for (string key: { "1", "2", "3", "13", "5" }) {
+        EXPECT(table.insert(key));
+    }
 
+    /* Removing 2 moves nothing: 3 and 5 sit at home, and 13 can't go back past its
+     * home in slot 3.
+     *
+     *    .  1  .  3 13  5  .  .  .  .
+     */
+    EXPECT(table.remove("2"));
+    EXPECT_EQUAL(table.numTombstones(), 0);
+    EXPECT_EQUAL(table.elems[2].type, LinearProbingHashTable::SlotType::EMPTY);
+    EXPECT_EQUAL(table.elems[4], { "13", LinearProbingHashTable::SlotType::FILLED });
+
+    /* Removing 3 does let 13 move back, past its home:
+     *
+     *    .  1  . 13  .  5  .  .  .  .
+     */
+    EXPECT(table.remove("3"));
+    EXPECT_EQUAL(table.elems[3], { "13", LinearProbingHashTable::SlotType::FILLED });
+    EXPECT_EQUAL(table.elems[4].type, LinearProbingHashTable::SlotType::EMPTY);
+    EXPECT_EQUAL(table.elems[5], {  "5", LinearProbingHashTable::SlotType::FILLED });
+    EXPECT(table.contains("13"));
+    EXPECT(table.contains("5"));
+    EXPECT(!table.contains("3"));
+
+    /* It also works on a full table that wraps around. */
+    LinearProbingHashTable full(Hash::constant(10, 7), LinearProbingHashTable::Deletion::BACKWARD_SHIFT);
+    for (int i = 0; i < 10; i++) {
+        EXPECT(full.insert(to_string(i)));
+    }
+    EXPECT(full.remove("0"));
+    EXPECT(!full.remove("0"));
+    for (int i = 1; i < 10; i++) {
+        EXPECT_EQUAL(full.elems[(i + 6) % 10], { to_string(i), LinearProbingHashTable::SlotType::FILLED });
+    }
+    EXPECT_EQUAL(full.elems[6].type, LinearProbingHashTable::SlotType::EMPTY);
+}
+
+STUDENT_TEST("Every deletion policy agrees with a reference set under churn.") {
+    using Deletion = LinearProbingHashTable::Deletion;
+    for (Deletion deletion: { Deletion::TOMBSTONES, Deletion::COMPACTING, Deletion::BACKWARD_SHIFT }) {
+        for (int numSlots: { 1, 10, 97 }) {
+            for (auto hashFn: { Hash::random(numSlots), Hash::zero(numSlots) }) {
+                LinearProbingHashTable table(hashFn, deletion, 0.2);
+                Vector<bool> present(numSlots + 5);
+                int size = 0;
+                for (int round = 0; round < 5000; round++) {
+                    int i = randomInteger(0, present.size() - 1);
+                    if (randomInteger(0, 1) == 0) {
+                        bool fits = !present[i] && size < numSlots;
+                        EXPECT_EQUAL(table.insert(to_string(i)), fits);
+                        if (fits) {
+                            present[i] = true;
+                            size++;
+                        }
+                    } else {
+                        EXPECT_EQUAL(table.remove(to_string(i)), bool(present[i]));
+                        if (present[i]) size--;
+                        present[i] = false;
+                    }
+                    if (deletion == Deletion::COMPACTING) {
+                        EXPECT(table.numTombstones() <= 0.2 * numSlots);
+                    } else if (deletion == Deletion::BACKWARD_SHIFT) {
+                        EXPECT_EQUAL(table.numTombstones(), 0);
+                    }
+                }
+                EXPECT_EQUAL(table.size(), size);
+                for (int i = 0; i < present.size(); i++) {
+                    EXPECT_EQUAL(table.contains(to_string(i)), bool(present[i]));
+                }
+            }
+        }
+    }
+    EXPECT_ERROR(LinearProbingHashTable(Hash::random(10), Deletion::COMPACTING, 0));
+    EXPECT_ERROR(LinearProbingHashTable(Hash::random(10), Deletion::COMPACTING, 1.5));
+}
+
+STUDENT_TEST("Miss cost after long insert/remove churn, per deletion policy.") {
+    /* A cache at load factor 0.5 that keeps replacing its oldest entry with a new one. */
+    using Deletion = LinearProbingHashTable::Deletion;
+    const int kNumSlots = 1 << 15;
+    const int kLive = kNumSlots / 2;
+    const int kChurn = 4 * kNumSlots;
+    for (Deletion deletion: { Deletion::TOMBSTONES, Deletion::COMPACTING, Deletion::BACKWARD_SHIFT }) {
+        LinearProbingHashTable table(Hash::random(kNumSlots), deletion);
+        for (int i = 0; i < kLive; i++) {
+            table.insert(to_string(i));
+        }
+        auto churn = [&] {
+            for (int i = 0; i < kChurn; i++) {
+                table.remove(to_string(i));
+                table.insert(to_string(i + kLive));
+            }
+        };
+        auto missAll = [&] {
+            int found = 0;
+            for (int i = 0; i < kLive; i++) found += table.contains("missing" + to_string(i));
+            return found;
+        };
+        cout << "    Policy " << int(deletion) << ", tombstones before churn: " << table.numTombstones() << endl;
+        TIME_OPERATION(kChurn, churn());
+        cout << "    Tombstones after churn: " << table.numTombstones() << endl;
+        TIME_OPERATION(kLive, missAll());
+        EXPECT_EQUAL(table.size(), kLive);
+        EXPECT(table.contains(to_string(kChurn)));
+    }
+}
+
+STUDENT_TEST("containsBatch agrees with contains, for batches of any length.") {
+    LinearProbingHashTable table(Hash::random(1000));
+    for (int i = 0; i < 600; i += 2) {
+        table.insert(to_string(i));
+    }
+    table.insert("a key long enough to need its own heap allocation");
+    EXPECT(table.remove("10"));
+
+    Vector<string> keys;
+    EXPECT(table.containsBatch(keys).isEmpty());
+    for (int length: { 1, 15, 16, 17, 600 }) {
+        keys.clear();
+        for (int i = 0; i < length; i++) {
+            keys += to_string(i);
+        }
+        keys += "a key long enough to need its own heap allocation";
+        Vector<bool> found = table.containsBatch(keys);
+        EXPECT_EQUAL(found.size(), keys.size());
+        for (int i = 0; i < keys.size(); i++) {
+            EXPECT_EQUAL(found[i], table.contains(keys[i]));
+        }
+    }
+
+    LinearProbingHashTable empty(Hash::random(10));
+    EXPECT_EQUAL(empty.containsBatch({ "a", "b" }), { false, false });
+}
+
+STUDENT_TEST("containsBatch versus one contains at a time, in a table far larger than the cache.") {
+    /* 4M slots of 40 bytes each: 160MB, beyond a typical L3 cache. */
+    const int kNumSlots = 1 << 22;
+    const int kElems = kNumSlots / 2;
+    LinearProbingHashTable table(Hash::random(kNumSlots));
+    Vector<string> keys;
+    for (int i = 0; i < kElems; i++) {
+        table.insert(to_string(i));
+        keys += to_string(randomInteger(0, 2 * kElems));
+    }
+
+    auto oneAtATime = [&] {
+        int found = 0;
+        for (const string& key: keys) found += table.contains(key);
+        return found;
+    };
+    auto batched = [&] {
+        int found = 0;
+        for (bool isThere: table.containsBatch(keys)) found += isThere;
+        return found;
+    };
+    int found = 0;
+    TIME_OPERATION(kElems, found += oneAtATime());
+    TIME_OPERATION(kElems, found -= batched());
+    EXPECT_EQUAL(found, 0);
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+STUDENT_TEST("stats reports distances, tombstones and clusters of a small table.") {
+    LinearProbingHashTable table(Hash::identity(10));
+    for (string key: { "0", "10", "20", "5" }) {
+        table.insert(key);
+    }
+    table.remove("10");
+
+    /* Slots: 0 (home), tombstone, 20 (two from home), and 5 (home). */
+    HashTableStats stats = table.stats();
+    EXPECT_EQUAL(stats.numSlots, 10);
+    EXPECT_EQUAL(stats.numElements, 3);
+    EXPECT_EQUAL(stats.numTombstones, 1);
+    EXPECT_EQUAL(stats.probeHistogram, { 2, 0, 1 });
+    EXPECT_EQUAL(stats.maxProbeDistance, 2);
+    EXPECT_EQUAL(stats.numClusters, 2);
+    EXPECT_EQUAL(stats.maxClusterLength, 3);
+
+    /* Nothing is counted until counting is turned on. */
+    EXPECT_EQUAL(stats.counters.lookups, 0);
+    table.setProbeCounting(true);
+    EXPECT(table.contains("20"));   // Three probes, walking past the tombstone.
+    EXPECT(!table.contains("30"));  // Four, ending at the empty slot 3.
+    EXPECT(table.insert("7"));      // One.
+    EXPECT(table.remove("5"));      // One.
+    stats = table.stats();
+    EXPECT_EQUAL(stats.counters.lookups, 2);
+    EXPECT_EQUAL(stats.counters.lookupProbes, 7);
+    EXPECT_EQUAL(stats.counters.insertionProbes, 1);
+    EXPECT_EQUAL(stats.counters.removalProbes, 1);
+    EXPECT_EQUAL(stats.counters.probesPerLookup(), 3.5);
+
+    table.setProbeCounting(false);
+    table.contains("20");
+    EXPECT_EQUAL(table.stats().counters.lookups, 0);
+}
+
+STUDENT_TEST("stats shows a bad hash function at a glance.") {
+    const int kSlots = 1 << 12;
+    LinearProbingHashTable good(Hash::random(kSlots));
+    LinearProbingHashTable bad(Hash::zero(kSlots));
+    for (int i = 0; i < kSlots / 2; i++) {
+        good.insert(to_string(i));
+        bad.insert(to_string(i));
+    }
+    HashTableStats goodStats = good.stats();
+    HashTableStats badStats = bad.stats();
+    cout << goodStats << badStats;
+
+    EXPECT_EQUAL(goodStats.loadFactor, 0.5);
+    EXPECT_EQUAL(badStats.numClusters, 1);
+    EXPECT_EQUAL(badStats.maxProbeDistance, kSlots / 2 - 1);
+    EXPECT(goodStats.averageMissProbes < 5);
+    EXPECT(badStats.averageMissProbes > 100);
+}
 
 /* * * * * Provided Tests Below This Point * * * * */
 #include "vector.h"
@@ -4,6 +4,9 @@
 #include "Demos/Utility.h"
 #include "GUI/SimpleTest.h"
 #include "GUI/MemoryDiagnostics.h"
+#include "HashTableStats.h"
+#include "KeyArena.h"
+#include "vector.h"
 #include <string>
 
 class LinearProbingHashTable {
@@ -15,6 +18,24 @@ public:
      */
     LinearProbingHashTable(HashFunction<std::string> hashFn);
 
+    /* Ways remove can deal with the hole an element leaves behind. */
+    enum class Deletion {
+        TOMBSTONES,    // Leave a tombstone, and never clean up. This is the default.
+        COMPACTING,    // Leave a tombstone, and rehash in place once there are too many.
+        BACKWARD_SHIFT // Pull later elements of the run back into the hole. No tombstones.
+    };
+
+    /**
+     * Constructs a new linear probing table that uses the given hash function and removes
+     * elements the given way. With COMPACTING, the table rehashes itself in place whenever
+     * tombstones take up more than maxTombstoneLoad of the slots.
+     *
+     * If maxTombstoneLoad isn't between 0 (exclusive) and 1 (inclusive), this function
+     * calls error() to report an error.
+     */
+    LinearProbingHashTable(HashFunction<std::string> hashFn, Deletion deletion,
+                           double maxTombstoneLoad = 0.25);
+
     /**
      * Cleans up all memory allocated by this hash table.
      */
@@ -47,6 +68,14 @@ public:
      */
     bool contains(const std::string& key) const;
 
+    /**
+     * Looks up many keys at once, returning whether each one is in the table. The keys
+     * are taken kBatchSize at a time: all of them are hashed and their home slots
+     * prefetched before any is looked up, so that in a table too large for the cache,
+     * the memory accesses overlap rather than each waiting on the last.
+     */
+    Vector<bool> containsBatch(const Vector<std::string>& keys) const;
+
     /**
      * Removes the specified element from this hash table. If the element is not
      * present in the hash table, this operation is a no-op.
@@ -58,6 +87,35 @@ public:
      */
     bool remove(const std::string& key);
 
+    /**
+     * Returns how many slots currently hold tombstones.
+     */
+    int numTombstones() const;
+
+    /**
+     * Rehashes the table in place, turning every tombstone back into an empty slot and
+     * moving each element to the earliest slot it can have along its probe sequence. No
+     * second array of slots is needed.
+     *
+     * This runs in time O(n), where n is the number of slots.
+     */
+    void compact();
+
+    /**
+     * Returns a summary of the table's shape: its load factor, how far elements sit from
+     * their home slots, how long its clusters are, and so on (see HashTableStats). This
+     * takes one pass over the slots.
+     */
+    HashTableStats stats() const;
+
+    /**
+     * Turns counting of the probes each contains, insert and remove makes on or off,
+     * starting the counts over from zero. The counts show up in stats(). Counting has
+     * each operation walk its probe sequence a second time, so it's for measuring, not
+     * for leaving on.
+     */
+    void setProbeCounting(bool enabled);
+
     /**
      * Prints out relevant information to assist with debugging.
      */
@@ -93,12 +151,38 @@ private:
     int logicalSize;
     HashFunction<std::string> Hash;
 
-    /* Finds the index of the element if the element is in the hashtable. */
+    /* Finds the index of the element if the element is in the hashtable. The second
+     * version takes the element's hash code, for callers that already have it.
+     */
     int findElement (const std::string& key) const;
+    int findElement (const std::string& key, int code) const;
+
+    /* How many keys containsBatch has in flight at once. */
+    static const int kBatchSize = 16;
+
+    Deletion deletion = Deletion::TOMBSTONES;
+    double maxTombstoneLoad = 1;
+    int tombstones = 0;
 
+    /* Index of the slot after the given one, wrapping around the end of the table. */
+    int nextSlot(int index) const;
 
+    /* Puts an element known not to be in the table into the first empty slot along its
+     * probe sequence, ignoring tombstones.
+     */
+    void place(std::string&& value);
+
+    /* Empties the slot at the given index, moving later elements of its run back to
+     * keep every element reachable.
+     */
+    void shiftBackInto(int index);
 
+    /* Probe counting, for stats(). */
+    bool probeCounting = false;
+    mutable ProbeCounters probeCounters;
 
+    /* Number of slots a search for the key looks at, including the one that ends it. */
+    int probesFor(const std::string& key) const;
 
     /* Internal shenanigans to make this play well with C++. */
     DISALLOW_COPYING_OF(LinearProbingHashTable);
@@ -107,3 +191,82 @@ private:
     MAKE_PRINTERS_FOR(Slot);
     MAKE_COMPARATORS_FOR(Slot);
 };
+
+/**
+ * A fixed-size linear probing table with the same interface as LinearProbingHashTable,
+ * but whose slots hold ArenaKeys instead of std::strings. Each slot takes 20 bytes rather
+ * than 40; keys of up to twelve characters sit inside their slots, and longer keys are
+ * packed end to end in one KeyArena instead of each getting its own heap allocation.
+ */
+class ArenaLinearProbingHashTable {
+public:
+    /**
+     * Constructs a new table using the given hash function, with hashFn.numSlots() slots.
+     */
+    ArenaLinearProbingHashTable(HashFunction<std::string> hashFn);
+
+    /**
+     * Cleans up all memory allocated by this hash table.
+     */
+    ~ArenaLinearProbingHashTable();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Inserts, looks up and removes elements exactly as LinearProbingHashTable does,
+     * including leaving tombstones behind on removal.
+     */
+    bool insert(const std::string& key);
+    bool contains(const std::string& key) const;
+    bool remove(const std::string& key);
+
+    /**
+     * Moves every element into a new slot array sized and placed by the given hash
+     * function, leaving the tombstones behind. Only the 20-byte slots move; the
+     * characters of long keys stay put in the arena. If the new function has fewer
+     * slots than there are elements, this calls error().
+     */
+    void rehash(HashFunction<std::string> hashFn);
+
+    /**
+     * Returns how many bytes the slot array and the arena take up together.
+     */
+    std::size_t bytesUsed() const;
+
+    /**
+     * Prints out relevant information to assist with debugging.
+     */
+    void printDebugInfo() const;
+
+private:
+    enum class SlotType {
+        EMPTY, FILLED, TOMBSTONE
+    };
+
+    struct Slot {
+        ArenaKey key;
+        SlotType type;
+
+        TRACK_ALLOCATIONS_OF(Slot);
+    };
+
+    Slot* elems = nullptr;
+    int allocatedSize;
+    int logicalSize;
+    HashFunction<std::string> Hash;
+    KeyArena arena;
+
+    /* Finds the index of the element if the element is in the hashtable, or -1. */
+    int findElement(const std::string& key) const;
+
+    /* Index of the slot after the given one, wrapping around the end of the table. */
+    int nextSlot(int index) const;
+
+    /* Drops the characters of removed keys once they make up most of the arena. */
+    void compactArena();
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(ArenaLinearProbingHashTable);
+    ALLOW_TEST_ACCESS();
+};
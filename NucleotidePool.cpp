@@ -0,0 +1,305 @@
+#include "NucleotidePool.h"
+#include "SplicingAndDicing.h"
+#include "GUI/MemoryDiagnostics.h"
+#include "GUI/SimpleTest.h"
+#include "error.h"
+#include "vector.h"
+#include <string>
+using namespace std;
+
+/* This program implements a slab allocator for Nucleotides. */
+
+namespace {
+    const int kNucleotidesPerSlab = 4096;
+
+    struct Slab {
+        Slab* next;
+        Nucleotide nucleotides[kNucleotidesPerSlab];
+
+        /* For testing. */
+        TRACK_ALLOCATIONS_OF(Slab);
+    };
+
+    Slab* slabs = nullptr;
+    int usedInSlab = kNucleotidesPerSlab;   // Of the most recent slab.
+    int numSlabs = 0;
+    Nucleotide* freeList = nullptr;         // Linked through next pointers.
+    int numInstances = 0;
+
+#ifndef NDEBUG
+    /* In debug builds, a freed Nucleotide has its prev pointer aimed at freedTag, where no
+     * live Nucleotide's can point, so freeing it again is caught however many others are
+     * still live.
+     */
+    char freedTag;
+    Nucleotide* const kFreed = reinterpret_cast<Nucleotide*>(&freedTag);
+#endif
+
+    void markLive(Nucleotide* nucleotide) {
+#ifndef NDEBUG
+        nucleotide->prev = nullptr;
+#endif
+    }
+
+    void checkLive(const Nucleotide* nucleotide) {
+#ifndef NDEBUG
+        if (nucleotide->prev == kFreed) {
+            error("A Nucleotide was freed twice.");
+        }
+#endif
+    }
+
+    void markFreed(Nucleotide* nucleotide) {
+#ifndef NDEBUG
+        nucleotide->prev = kFreed;
+#endif
+    }
+
+    /* Once nothing is allocated, nothing on the free list needs to be kept either. */
+    void releaseSlabs() {
+        while (slabs != nullptr) {
+            Slab* next = slabs->next;
+            delete slabs;
+            slabs = next;
+        }
+        usedInSlab = kNucleotidesPerSlab;
+        numSlabs = 0;
+        freeList = nullptr;
+    }
+}
+
+void* NucleotidePool::allocate() {
+    numInstances++;
+    Nucleotide* result;
+    if (freeList != nullptr) {
+        result = freeList;
+        freeList = result->next;
+    } else {
+        if (usedInSlab == kNucleotidesPerSlab) {
+            Slab* slab = new Slab;
+            slab->next = slabs;
+            slabs = slab;
+            usedInSlab = 0;
+            numSlabs++;
+        }
+        result = &slabs->nucleotides[usedInSlab++];
+    }
+    /* Even fresh slab memory may hold an old mark, from a slab since given back. */
+    markLive(result);
+    return result;
+}
+
+void NucleotidePool::deallocate(void* memory) {
+    if (memory == nullptr) return;
+    if (numInstances == 0) {
+        error("More Nucleotides freed than were allocated.");
+    }
+
+    Nucleotide* nucleotide = static_cast<Nucleotide*>(memory);
+    checkLive(nucleotide);
+    markFreed(nucleotide);
+    nucleotide->next = freeList;
+    freeList = nucleotide;
+    if (--numInstances == 0) releaseSlabs();
+}
+
+/* The strand is already a list through its next pointers, so it only needs to be walked
+ * to find its end and count it.
+ */
+void NucleotidePool::deallocateStrand(Nucleotide* dna) {
+    if (dna == nullptr) return;
+
+    Nucleotide* last = dna;
+    int count = 1;
+    checkLive(dna);
+    while (last->next != nullptr) {
+        last = last->next;
+        checkLive(last);
+        count++;
+    }
+    /* Checked before anything changes, so a double free leaves the pool as it was. */
+    if (count > numInstances) {
+        error("More Nucleotides freed than were allocated.");
+    }
+#ifndef NDEBUG
+    for (Nucleotide* curr = dna; curr != nullptr; curr = curr->next) {
+        markFreed(curr);
+    }
+#endif
+    last->next = freeList;
+    freeList = dna;
+
+    numInstances -= count;
+    if (numInstances == 0) releaseSlabs();
+}
+
+int NucleotidePool::instances() {
+    return numInstances;
+}
+
+size_t NucleotidePool::bytesReserved() {
+    return numSlabs * sizeof(Slab);
+}
+
+#ifdef USE_NUCLEOTIDE_POOL
+void* Nucleotide::operator new(size_t bytes) {
+    if (bytes != sizeof(Nucleotide)) {
+        error("Nucleotide pool can't allocate objects of another size.");
+    }
+    return NucleotidePool::allocate();
+}
+
+void Nucleotide::operator delete(void* memory) {
+    NucleotidePool::deallocate(memory);
+}
+#endif
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+/* From SplicingAndDicing.cpp, to compare against. */
+Nucleotide* toStrand(const string& str);
+string fromDNA(Nucleotide* dna);
+void deleteNucleotides(Nucleotide* dna);
+const string& eColiGenome();
+
+namespace {
+    /* toStrand, but with every Nucleotide from the pool whatever the build. */
+    Nucleotide* pooledStrand(const string& str) {
+        Nucleotide* head = nullptr;
+        Nucleotide* tail = nullptr;
+        for (char ch: str) {
+            Nucleotide* curr = static_cast<Nucleotide*>(NucleotidePool::allocate());
+            curr->value = ch;
+            curr->next = nullptr;
+            curr->prev = tail;
+            if (tail != nullptr) {
+                tail->next = curr;
+            } else {
+                head = curr;
+            }
+            tail = curr;
+        }
+        return head;
+    }
+}
+
+STUDENT_TEST("NucleotidePool reuses freed Nucleotides and lets go of its slabs when empty.") {
+    int before = NucleotidePool::instances();
+
+    void* first = NucleotidePool::allocate();
+    void* second = NucleotidePool::allocate();
+    EXPECT_NOT_EQUAL(first, second);
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 2);
+    EXPECT(NucleotidePool::bytesReserved() > 0);
+
+    NucleotidePool::deallocate(first);
+    EXPECT_EQUAL(NucleotidePool::allocate(), first);
+
+    NucleotidePool::deallocate(nullptr);
+    NucleotidePool::deallocate(first);
+    NucleotidePool::deallocate(second);
+    EXPECT_EQUAL(NucleotidePool::instances(), before);
+    if (before == 0) {
+        EXPECT_EQUAL(NucleotidePool::bytesReserved(), 0);
+
+        /* Freeing more than is allocated is a double free, and changes nothing. */
+        void* only = NucleotidePool::allocate();
+        NucleotidePool::deallocate(only);
+        EXPECT_ERROR(NucleotidePool::deallocate(only));
+
+        Nucleotide* strand = static_cast<Nucleotide*>(NucleotidePool::allocate());
+        Nucleotide spare;
+        strand->next = &spare;
+        spare.next = nullptr;
+        EXPECT_ERROR(NucleotidePool::deallocateStrand(strand));
+        EXPECT_EQUAL(NucleotidePool::instances(), 1);
+        NucleotidePool::deallocate(strand);
+        EXPECT_EQUAL(NucleotidePool::instances(), 0);
+    }
+}
+
+STUDENT_TEST("NucleotidePool frees whole strands at once.") {
+    int before = NucleotidePool::instances();
+
+    string bases;
+    for (int i = 0; i < 3 * kNucleotidesPerSlab + 17; i++) {
+        bases += "ACGT"[i % 4];
+    }
+    Nucleotide* one = pooledStrand(bases);
+    Nucleotide* two = pooledStrand(bases.substr(0, 100));
+    EXPECT_EQUAL(fromDNA(one), bases);
+    EXPECT_EQUAL(fromDNA(two), bases.substr(0, 100));
+    EXPECT_EQUAL(NucleotidePool::instances(), before + int(bases.size()) + 100);
+
+    NucleotidePool::deallocateStrand(one);
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 100);
+    EXPECT_EQUAL(fromDNA(two), bases.substr(0, 100));
+
+    /* The freed strand is handed back out before any new slab is made. */
+    size_t reserved = NucleotidePool::bytesReserved();
+    one = pooledStrand(bases);
+    EXPECT_EQUAL(NucleotidePool::bytesReserved(), reserved);
+    EXPECT_EQUAL(fromDNA(one), bases);
+
+    NucleotidePool::deallocateStrand(one);
+    NucleotidePool::deallocateStrand(two);
+    NucleotidePool::deallocateStrand(nullptr);
+    EXPECT_EQUAL(NucleotidePool::instances(), before);
+}
+
+#ifndef NDEBUG
+STUDENT_TEST("In debug builds, NucleotidePool catches double frees while others are live.") {
+    int before = NucleotidePool::instances();
+
+    void* kept = NucleotidePool::allocate();
+    void* freed = NucleotidePool::allocate();
+    NucleotidePool::deallocate(freed);
+    EXPECT_ERROR(NucleotidePool::deallocate(freed));
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 1);
+
+    /* Handed out again, the same memory can be freed once more. */
+    EXPECT_EQUAL(NucleotidePool::allocate(), freed);
+    NucleotidePool::deallocate(freed);
+
+    /* Part of a strand freed already fails the whole strand, which is left as it was. */
+    Nucleotide* strand = pooledStrand("GATTACA");
+    Nucleotide* rest = strand->next->next->next;
+    NucleotidePool::deallocateStrand(rest);
+    EXPECT_ERROR(NucleotidePool::deallocateStrand(strand));
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 4);
+    strand->next->next->next = nullptr;
+    NucleotidePool::deallocateStrand(strand);
+
+    NucleotidePool::deallocate(kept);
+    EXPECT_EQUAL(NucleotidePool::instances(), before);
+}
+#endif
+
+#ifdef USE_NUCLEOTIDE_POOL
+STUDENT_TEST("With USE_NUCLEOTIDE_POOL, new and delete of Nucleotides go through the pool.") {
+    int before = NucleotidePool::instances();
+    Nucleotide* dna = toStrand("GATTACA");
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 7);
+
+    Nucleotide* extra = new Nucleotide;
+    EXPECT_EQUAL(NucleotidePool::instances(), before + 8);
+    delete extra;
+
+    deleteNucleotides(dna);
+    EXPECT_EQUAL(NucleotidePool::instances(), before);
+}
+#endif
+
+STUDENT_TEST("Stress Test: loading and freeing E.Coli with new and delete versus the pool.") {
+    const string& genome = eColiGenome();
+    for (int round = 0; round < 2; round++) {
+        Nucleotide* dna = nullptr;
+        TIME_OPERATION(genome.size(), dna = toStrand(genome));
+        TIME_OPERATION(genome.size(), deleteNucleotides(dna));
+
+        TIME_OPERATION(genome.size(), dna = pooledStrand(genome));
+        EXPECT(fromDNA(dna) == genome);
+        TIME_OPERATION(genome.size(), NucleotidePool::deallocateStrand(dna));
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+
+struct Nucleotide;
+
+/**
+ * A slab allocator for Nucleotides. Memory is taken from the system a slab of many
+ * Nucleotides at a time, and a freed Nucleotide goes on a free list, linked through its
+ * own next pointer, to be handed out again by the next allocation. Since a strand is
+ * already linked through its next pointers, a whole strand can be freed at once by
+ * hooking its last Nucleotide onto the front of the free list.
+ *
+ * When the last Nucleotide handed out is freed, the slabs are returned to the system.
+ * The slabs are tracked with TRACK_ALLOCATIONS_OF, so Nucleotides that are never freed
+ * still show up as leaks.
+ *
+ * Freeing more Nucleotides than are live is always reported as an error. In debug builds
+ * (without NDEBUG), freed Nucleotides are also marked through their prev pointers, so
+ * freeing one twice is reported even while others are live. Release builds don't mark
+ * them, and so only catch a double free once nothing else is live.
+ *
+ * Building with USE_NUCLEOTIDE_POOL defined makes Nucleotide's operator new and delete
+ * use this pool in place of TRACK_ALLOCATIONS_OF's one allocation per Nucleotide, and
+ * makes deleteNucleotides free the whole strand at once. NucleotideAlloc::instances()
+ * then no longer sees Nucleotides; NucleotidePool::instances() counts them instead.
+ *
+ * The pool is not safe to use from more than one thread at once.
+ */
+namespace NucleotidePool {
+    /**
+     * Returns uninitialized memory for one Nucleotide.
+     */
+    void* allocate();
+
+    /**
+     * Returns memory from allocate() to the pool. Passing nullptr has no effect.
+     */
+    void deallocate(void* memory);
+
+    /**
+     * Returns every Nucleotide of the strand starting at dna to the pool, following next
+     * pointers, in one pass and without freeing them one at a time. All of them must
+     * have come from allocate(). Passing nullptr has no effect.
+     */
+    void deallocateStrand(Nucleotide* dna);
+
+    /**
+     * Returns how many Nucleotides have been allocated and not yet deallocated.
+     */
+    int instances();
+
+    /**
+     * Returns how many bytes of slabs the pool is holding on to.
+     */
+    std::size_t bytesReserved();
+}
@@ -0,0 +1,252 @@
+#include "ProbingHashMap.h"
+#include "GUI/SimpleTest.h"
+#include "random.h"
+#include "vector.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+namespace {
+    /* A terrible hash function, for piling every key into the same home slot. */
+    struct ConstantHash {
+        size_t operator() (int) const {
+            return 137;
+        }
+    };
+
+    template <typename Map> void checkBasics() {
+        Map map;
+        EXPECT(map.isEmpty());
+        EXPECT(!map.contains("a"));
+        EXPECT_ERROR(map.at("a"));
+
+        EXPECT(map.try_emplace("a", 1).second);
+        EXPECT(map.emplace("b", 2).second);
+        EXPECT(map.insert({ "c", 3 }).second);
+        map["d"] = 4;
+        EXPECT_EQUAL(map.size(), 4);
+
+        /* Existing keys are left alone. */
+        EXPECT(!map.try_emplace("a", 100).second);
+        EXPECT(!map.emplace("b", 200).second);
+        EXPECT(!map.insert({ "c", 300 }).second);
+        EXPECT_EQUAL(map.at("a"), 1);
+        EXPECT_EQUAL(map.at("b"), 2);
+        EXPECT_EQUAL(map.at("c"), 3);
+        EXPECT_EQUAL(map["d"], 4);
+        EXPECT_EQUAL(map.size(), 4);
+
+        /* Lookups by string_view and C string, without building a std::string. */
+        string_view view = "abc";
+        EXPECT(map.contains(view.substr(0, 1)));
+        EXPECT_EQUAL(map.find(view.substr(1, 1))->second, 2);
+        EXPECT_EQUAL(map.at(view.substr(2, 1)), 3);
+        EXPECT(map.find(string_view("e")) == map.end());
+        map.find("d")->second = 40;
+        EXPECT_EQUAL(map.at(string("d")), 40);
+
+        EXPECT(map.erase("a"));
+        EXPECT(!map.erase(string_view("a")));
+        EXPECT(!map.contains("a"));
+        EXPECT_EQUAL(map.size(), 3);
+
+        map.clear();
+        EXPECT(map.isEmpty());
+        EXPECT(map.begin() == map.end());
+        EXPECT(map.try_emplace("a", 5).second);
+        EXPECT_EQUAL(map.at("a"), 5);
+    }
+
+    template <typename Map> Map fromRandomOperations(int numKeys) {
+        Map map;
+        unordered_map<int, int> reference;
+        for (int round = 0; round < 20000; round++) {
+            int key = randomInteger(0, numKeys - 1);
+            int choice = randomInteger(0, 2);
+            if (choice == 0) {
+                EXPECT_EQUAL(map.try_emplace(key, round).second, reference.emplace(key, round).second);
+            } else if (choice == 1) {
+                EXPECT_EQUAL(map.erase(key), reference.erase(key) == 1);
+            } else {
+                map[key] = round;
+                reference[key] = round;
+            }
+        }
+        EXPECT_EQUAL(map.size(), int(reference.size()));
+        for (const auto& [key, value]: reference) {
+            EXPECT_EQUAL(map.at(key), value);
+        }
+        int visited = 0;
+        for (const auto& [key, value]: map) {
+            EXPECT_EQUAL(reference.at(key), value);
+            visited++;
+        }
+        EXPECT_EQUAL(visited, map.size());
+        return map;
+    }
+}
+
+STUDENT_TEST("Both maps insert, look up and erase, by string and by string_view.") {
+    checkBasics<RobinHoodHashMap<string, int>>();
+    checkBasics<LinearProbingHashMap<string, int>>();
+}
+
+STUDENT_TEST("Both maps agree with unordered_map under random operations.") {
+    /* Every pair must sit at its recorded distance from home, and in a Robin Hood map
+     * no element may be more than one step further from home than the one before it.
+     */
+    auto isConsistent = [](const auto& map, bool robinHood) {
+        int count = 0;
+        int mask = map.allocatedSize - 1;
+        for (int i = 0; i < map.allocatedSize; i++) {
+            int distance = map.slots[i].distance;
+            if (distance == -1) continue;
+            count++;
+            if (((i - map.homeOf(map.slots[i].entry.first)) & mask) != distance) return false;
+            if (robinHood && distance > map.slots[(i - 1) & mask].distance + 1) return false;
+        }
+        return count == map.size();
+    };
+    for (int numKeys: { 1, 10, 1000 }) {
+        EXPECT(isConsistent(fromRandomOperations<RobinHoodHashMap<int, int>>(numKeys), true));
+        EXPECT(isConsistent(fromRandomOperations<LinearProbingHashMap<int, int>>(numKeys), false));
+    }
+    /* With every key in the same home slot, every operation crosses the end of the
+     * table and walks the whole cluster.
+     */
+    EXPECT(isConsistent(fromRandomOperations<RobinHoodHashMap<int, int, ConstantHash>>(50), true));
+    EXPECT(isConsistent(fromRandomOperations<LinearProbingHashMap<int, int, ConstantHash>>(50), false));
+}
+
+STUDENT_TEST("try_emplace leaves its arguments alone when the key is already there.") {
+    RobinHoodHashMap<string, unique_ptr<int>> map;
+    EXPECT(map.try_emplace("a", make_unique<int>(1)).second);
+
+    unique_ptr<int> other = make_unique<int>(2);
+    EXPECT(!map.try_emplace("a", std::move(other)).second);
+    EXPECT(other != nullptr);
+    EXPECT_EQUAL(*map.at("a"), 1);
+
+    /* Move-only values survive rehashing and erasure shifting them around. */
+    for (int i = 0; i < 1000; i++) {
+        map.try_emplace(to_string(i), make_unique<int>(i));
+    }
+    for (int i = 0; i < 1000; i += 2) {
+        EXPECT(map.erase(to_string(i)));
+    }
+    for (int i = 1; i < 1000; i += 2) {
+        EXPECT_EQUAL(*map.at(to_string(i)), i);
+    }
+}
+
+STUDENT_TEST("Iteration visits every pair once, and values can be changed through it.") {
+    LinearProbingHashMap<int, int> map;
+    for (int i = 0; i < 500; i++) {
+        map[i] = i;
+    }
+    for (auto& [key, value]: map) {
+        value += 1000;
+    }
+    const auto& constMap = map;
+    Vector<bool> seen(500);
+    for (auto it = constMap.begin(); it != constMap.end(); ++it) {
+        EXPECT(!seen[it->first]);
+        seen[it->first] = true;
+        EXPECT_EQUAL(it->second, it->first + 1000);
+    }
+    for (bool wasSeen: seen) {
+        EXPECT(wasSeen);
+    }
+
+    /* Plain iterators convert to const ones. */
+    LinearProbingHashMap<int, int>::const_iterator found = map.find(7);
+    EXPECT_EQUAL(found->second, 1007);
+}
+
+STUDENT_TEST("reserve sizes the table up front so insertions never rehash.") {
+    RobinHoodHashMap<int, int> map;
+    map.reserve(10000);
+    auto* slots = map.slots;
+    for (int i = 0; i < 10000; i++) {
+        map[i] = i;
+    }
+    EXPECT_EQUAL(map.slots, slots);
+
+    /* It only rehashes once it's as full as it's allowed to get. */
+    int capacity = map.allocatedSize * map.kMaxLoadFactor;
+    for (int i = 10000; i < capacity; i++) {
+        map[i] = i;
+    }
+    EXPECT_EQUAL(map.slots, slots);
+    map[capacity] = capacity;
+    EXPECT(map.slots != slots);
+
+    EXPECT_ERROR(map.reserve(-1));
+    map.reserve(0);
+    EXPECT_EQUAL(map.size(), capacity + 1);
+}
+
+STUDENT_TEST("Maps copy and move like values.") {
+    RobinHoodHashMap<string, int> map;
+    for (int i = 0; i < 100; i++) {
+        map[to_string(i)] = i;
+    }
+    RobinHoodHashMap<string, int> copy = map;
+    copy["0"] = -1;
+    EXPECT_EQUAL(map.at("0"), 0);
+    EXPECT_EQUAL(copy.at("99"), 99);
+
+    RobinHoodHashMap<string, int> moved = std::move(copy);
+    EXPECT(copy.isEmpty());
+    EXPECT_EQUAL(moved.at("0"), -1);
+
+    copy = map;
+    EXPECT_EQUAL(copy.size(), 100);
+    copy["new"] = 1;
+    EXPECT(!copy.isEmpty());
+    moved = std::move(copy);
+    EXPECT_EQUAL(moved.size(), 101);
+}
+
+STUDENT_TEST("Map lookups versus unordered_map, with string keys.") {
+    const int kElems = 1 << 20;
+    Vector<string> present, absent;
+    for (int i = 0; i < kElems; i++) {
+        present += "key" + to_string(i);
+        absent += "nokey" + to_string(i);
+    }
+    auto insertAll = [&](auto& map) {
+        for (int i = 0; i < kElems; i++) map.try_emplace(present[i], i);
+    };
+    auto findAll = [&](const auto& map, const Vector<string>& keys) {
+        int found = 0;
+        for (const string& key: keys) found += map.find(key) != map.end();
+        return found;
+    };
+    unordered_map<string, int> standard;
+    RobinHoodHashMap<string, int> robinHood;
+    LinearProbingHashMap<string, int> linear;
+    TIME_OPERATION(kElems, insertAll(standard));
+    TIME_OPERATION(kElems, insertAll(robinHood));
+    TIME_OPERATION(kElems, insertAll(linear));
+
+    /* Look keys up in a different order from the one they went in, so that the
+     * unordered_map's nodes aren't simply visited in the order they were allocated.
+     */
+    for (int i = kElems - 1; i > 0; i--) {
+        swap(present[i], present[randomInteger(0, i)]);
+    }
+    /* The results are added up and checked, so no lookups can be optimized away. */
+    int found = 0;
+    TIME_OPERATION(kElems, found += findAll(standard, present));
+    TIME_OPERATION(kElems, found += findAll(robinHood, present));
+    TIME_OPERATION(kElems, found += findAll(linear, present));
+    TIME_OPERATION(kElems, found += findAll(standard, absent));
+    TIME_OPERATION(kElems, found += findAll(robinHood, absent));
+    TIME_OPERATION(kElems, found += findAll(linear, absent));
+    EXPECT_EQUAL(found, 3 * kElems);
+}
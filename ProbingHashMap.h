@@ -0,0 +1,682 @@
+#pragma once
+
+#include "Demos/Utility.h"
+#include "GUI/SimpleTest.h"
+#include "error.h"
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Hash function used by the maps below unless told otherwise. For most keys it's just
+ * std::hash. For strings it also accepts string_views and C strings, hashing all three
+ * the same way, so a map with string keys can be searched without building a string.
+ */
+template <typename K> struct DefaultHash: std::hash<K> {};
+
+template <> struct DefaultHash<std::string> {
+    using is_transparent = void;
+
+    std::size_t operator() (std::string_view key) const {
+        return std::hash<std::string_view>()(key);
+    }
+};
+
+/* The two ways the maps below can resolve collisions. */
+enum class Probing {
+    LINEAR,    // Each element goes in the first free slot after its home slot.
+    ROBIN_HOOD // Elements far from home take slots from elements close to theirs.
+};
+
+/**
+ * A hash map from keys of type K to values of type V, stored in one open-addressing
+ * table. It works like LinearProbingHashTable or RobinHoodHashTable, depending on
+ * the probing argument, but holds key/value pairs of any types, and grows as needed
+ * instead of filling up. Removal always uses backward-shift deletion, so there are no
+ * tombstones.
+ *
+ * Keys are hashed with HashFn and compared with KeyEqual. If both have an is_transparent
+ * member type, as the defaults do for string keys, lookups also accept anything they can
+ * hash and compare against a key - a std::string_view for a std::string key, say.
+ *
+ * The table always has a power-of-two number of slots. Each slot has its pair plus the
+ * distance from the pair's home slot, or EMPTY, side by side so that a probe touches
+ * one cache line per slot. As with HeapPQueue, slots are allocated with new[], so K and
+ * V must be default-constructible and move-assignable.
+ *
+ * Iterators are invalidated by anything that inserts or removes elements.
+ */
+template <typename K, typename V, Probing probing,
+          typename HashFn = DefaultHash<K>, typename KeyEqual = std::equal_to<>>
+class ProbingHashMap {
+private:
+    template <bool isConst> class Iterator;
+
+    /* Whether lookups can take types other than K. */
+    template <typename T, typename = void> struct IsTransparent: std::false_type {};
+    template <typename T> struct IsTransparent<T, std::void_t<typename T::is_transparent>>: std::true_type {};
+    static constexpr bool kTransparent = IsTransparent<HashFn>::value && IsTransparent<KeyEqual>::value;
+
+    /* Used to enable the overloads for other types only when lookups are transparent. */
+    template <typename Key> using IfTransparent = std::enable_if_t<kTransparent, Key>;
+
+public:
+    using value_type = std::pair<K, V>;
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    /* Largest fraction of the slots that can hold elements before the table doubles. */
+    static constexpr double kMaxLoadFactor = probing == Probing::ROBIN_HOOD ? 0.875 : 0.75;
+
+    /**
+     * Creates an empty map. Nothing is allocated until the first insertion.
+     */
+    ProbingHashMap(const HashFn& hashFn = HashFn(), const KeyEqual& equal = KeyEqual());
+
+    /**
+     * Copies, moves and destroys maps. A moved-from map is left empty.
+     */
+    ProbingHashMap(const ProbingHashMap& other);
+    ProbingHashMap(ProbingHashMap&& other) noexcept;
+    ProbingHashMap& operator= (ProbingHashMap other) noexcept;
+    ~ProbingHashMap();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Makes room for at least the given number of elements, so that inserting that many
+     * won't cause any rehashing.
+     */
+    void reserve(int numElems);
+
+    /**
+     * Inserts the key, with a value built from the remaining arguments, if the key isn't
+     * already in the map. If it is, the map and the arguments are left untouched.
+     *
+     * Returns an iterator to the key's pair, and whether it was inserted.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(K&& key, Args&&... args);
+
+    /**
+     * Builds a key/value pair from the arguments, then inserts it if its key isn't already
+     * in the map. Unlike try_emplace, this always builds the pair.
+     */
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args);
+
+    /**
+     * Inserts a copy of the pair if its key isn't already in the map.
+     */
+    std::pair<iterator, bool> insert(const value_type& entry);
+
+    /**
+     * Returns the value for a key, inserting a default-constructed value first if the key
+     * isn't there.
+     */
+    V& operator[] (const K& key);
+    V& operator[] (K&& key);
+
+    /**
+     * Returns the value for a key. If the key isn't there, this calls error().
+     */
+    V& at(const K& key);
+    const V& at(const K& key) const;
+    template <typename Key, typename = IfTransparent<Key>> V& at(const Key& key);
+    template <typename Key, typename = IfTransparent<Key>> const V& at(const Key& key) const;
+
+    /**
+     * Returns an iterator to the key's pair, or end() if the key isn't there.
+     */
+    iterator find(const K& key);
+    const_iterator find(const K& key) const;
+    template <typename Key, typename = IfTransparent<Key>> iterator find(const Key& key);
+    template <typename Key, typename = IfTransparent<Key>> const_iterator find(const Key& key) const;
+
+    /**
+     * Returns whether the key is in the map.
+     */
+    bool contains(const K& key) const;
+    template <typename Key, typename = IfTransparent<Key>> bool contains(const Key& key) const;
+
+    /**
+     * Removes the key and its value, returning whether the key was there.
+     */
+    bool erase(const K& key);
+    template <typename Key, typename = IfTransparent<Key>> bool erase(const Key& key);
+
+    /**
+     * Removes everything, keeping the slots for reuse.
+     */
+    void clear();
+
+    /**
+     * Iterates over the pairs in slot order, which has nothing to do with the order they
+     * were inserted in. Keys must not be changed through an iterator.
+     */
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+
+private:
+    /* Distance of an empty slot. Real distances are never negative. */
+    static const int EMPTY = -1;
+
+    /* Smallest number of slots the table is ever given. */
+    static const int kMinSlots = 8;
+
+    struct Slot {
+        value_type entry;
+        int distance;
+    };
+
+    Slot* slots = nullptr;
+    int allocatedSize = 0;
+    int logicalSize = 0;
+
+    /* Shift that turns a mixed hash code into a slot index: the top bits are used. */
+    int shift = 64;
+
+    HashFn hashFn;
+    KeyEqual equal;
+
+    /* Where a search for a key ended. If the key wasn't found, index is where it would
+     * go, and distance is how far that is from its home slot.
+     */
+    struct Probe {
+        int index;
+        int distance;
+        bool found;
+    };
+
+    /* Home slot of a key. The hash code is scrambled first, since std::hash of an integer
+     * is the integer itself, and its top bits would say very little.
+     */
+    template <typename Key> int homeOf(const Key& key) const;
+
+    template <typename Key> Probe probeFor(const Key& key) const;
+    template <typename Key> int findIndex(const Key& key) const;
+
+    /* Inserts the key if it's missing, building the value from the arguments. */
+    template <typename Key, typename... Args>
+    std::pair<iterator, bool> tryEmplaceImpl(Key&& key, Args&&... args);
+
+    /* Puts a pair into the slot a failed probe ended at, moving others along if needed,
+     * and returns the slot it ended up in.
+     */
+    int placeAt(const Probe& probe, value_type&& entry);
+
+    /* Empties a slot, pulling later elements back to close the gap. */
+    void eraseAt(int index);
+
+    /* Moves everything into a table with the given number of slots. */
+    void rehash(int numSlots);
+
+    /* Number of slots needed to hold the given number of elements. */
+    static int slotsFor(int numElems);
+
+    int nextSlot(int index) const;
+
+    /* An iterator is a position in the slot array, always at a full slot or the end. */
+    template <bool isConst> class Iterator {
+    public:
+        using Map = std::conditional_t<isConst, const ProbingHashMap, ProbingHashMap>;
+        using Value = std::conditional_t<isConst, const V, V>;
+
+        using iterator_category = std::forward_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = std::pair<K, V>;
+        using reference = std::conditional_t<isConst, const std::pair<K, V>&, std::pair<K, V>&>;
+        using pointer = std::conditional_t<isConst, const std::pair<K, V>*, std::pair<K, V>*>;
+
+        Iterator() = default;
+
+        /* Any iterator converts to a const_iterator. */
+        template <bool wasConst, typename = std::enable_if_t<isConst && !wasConst>>
+        Iterator(const Iterator<wasConst>& other) : map(other.map), index(other.index) {}
+
+        reference operator* () const {
+            return map->slots[index].entry;
+        }
+        pointer operator-> () const {
+            return &map->slots[index].entry;
+        }
+        Iterator& operator++ () {
+            index = map->firstFullFrom(index + 1);
+            return *this;
+        }
+        Iterator operator++ (int) {
+            Iterator result = *this;
+            ++*this;
+            return result;
+        }
+        bool operator== (const Iterator& rhs) const {
+            return index == rhs.index;
+        }
+        bool operator!= (const Iterator& rhs) const {
+            return index != rhs.index;
+        }
+
+    private:
+        Iterator(Map* map, int index) : map(map), index(index) {}
+
+        Map* map = nullptr;
+        int index = 0;
+
+        friend class ProbingHashMap;
+        template <bool> friend class Iterator;
+    };
+
+    /* Index of the first full slot at or after the given one, or allocatedSize. */
+    int firstFullFrom(int index) const;
+
+    ALLOW_TEST_ACCESS();
+};
+
+/* The two maps by name, with the hash and equality arguments still free. */
+template <typename K, typename V, typename HashFn = DefaultHash<K>, typename KeyEqual = std::equal_to<>>
+using RobinHoodHashMap = ProbingHashMap<K, V, Probing::ROBIN_HOOD, HashFn, KeyEqual>;
+
+template <typename K, typename V, typename HashFn = DefaultHash<K>, typename KeyEqual = std::equal_to<>>
+using LinearProbingHashMap = ProbingHashMap<K, V, Probing::LINEAR, HashFn, KeyEqual>;
+
+
+/* * * * * * Implementation Below This Point * * * * * */
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::ProbingHashMap(const HashFn& hashFn,
+                                                               const KeyEqual& equal)
+    : hashFn(hashFn), equal(equal) {
+}
+
+/* Hashing is deterministic, so a copy can keep every pair in the same slot. */
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::ProbingHashMap(const ProbingHashMap& other)
+    : hashFn(other.hashFn), equal(other.equal) {
+    if (other.allocatedSize == 0) {
+        return;
+    }
+    allocatedSize = other.allocatedSize;
+    logicalSize = other.logicalSize;
+    shift = other.shift;
+    slots = new Slot[allocatedSize];
+    for (int i = 0; i < allocatedSize; i++) {
+        slots[i].distance = other.slots[i].distance;
+        if (slots[i].distance != EMPTY) {
+            slots[i].entry = other.slots[i].entry;
+        }
+    }
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::ProbingHashMap(ProbingHashMap&& other) noexcept
+    : slots(other.slots), allocatedSize(other.allocatedSize), logicalSize(other.logicalSize), shift(other.shift),
+      hashFn(std::move(other.hashFn)), equal(std::move(other.equal)) {
+    other.slots = nullptr;
+    other.allocatedSize = 0;
+    other.logicalSize = 0;
+    other.shift = 64;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>&
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::operator= (ProbingHashMap other) noexcept {
+    std::swap(slots, other.slots);
+    std::swap(allocatedSize, other.allocatedSize);
+    std::swap(logicalSize, other.logicalSize);
+    std::swap(shift, other.shift);
+    std::swap(hashFn, other.hashFn);
+    std::swap(equal, other.equal);
+    return *this;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::~ProbingHashMap() {
+    delete[] slots;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+bool ProbingHashMap<K, V, probing, HashFn, KeyEqual>::isEmpty() const {
+    return size() == 0;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::size() const {
+    return logicalSize;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::slotsFor(int numElems) {
+    int numSlots = kMinSlots;
+    while (numElems > numSlots * kMaxLoadFactor) {
+        numSlots *= 2;
+    }
+    return numSlots;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+void ProbingHashMap<K, V, probing, HashFn, KeyEqual>::reserve(int numElems) {
+    if (numElems < 0) {
+        error("Can't reserve room for a negative number of elements.");
+    }
+    int numSlots = slotsFor(numElems);
+    if (numSlots > allocatedSize) {
+        rehash(numSlots);
+    }
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::nextSlot(int index) const {
+    return (index + 1) & (allocatedSize - 1);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::homeOf(const Key& key) const {
+    std::uint64_t code = std::uint64_t(hashFn(key)) * 0x9E3779B97F4A7C15ull;
+    return int(code >> shift);
+}
+
+/* Both kinds of probing walk forward from the home slot until they find the key or an
+ * empty slot. Robin Hood tables can also stop at the first element closer to its home
+ * than the key would be, since the key would have taken that element's slot.
+ */
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::Probe
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::probeFor(const Key& key) const {
+    int index = homeOf(key);
+    for (int distance = 0; ; distance++) {
+        int slotDistance = slots[index].distance;
+        if (slotDistance == EMPTY || (probing == Probing::ROBIN_HOOD && slotDistance < distance)) {
+            return { index, distance, false };
+        }
+        if (slotDistance == distance && equal(slots[index].entry.first, key)) {
+            return { index, distance, true };
+        }
+        index = nextSlot(index);
+    }
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::findIndex(const Key& key) const {
+    if (isEmpty()) {
+        return -1;
+    }
+    Probe probe = probeFor(key);
+    return probe.found ? probe.index : -1;
+}
+
+/* In a Robin Hood table the new pair displaces everything from its slot up to the next
+ * empty one. Those elements are in order of home slot, so each one just moves along by
+ * one, exactly as if they had been displaced one at a time.
+ */
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::placeAt(const Probe& probe, value_type&& entry) {
+    if (slots[probe.index].distance != EMPTY) {
+        int empty = probe.index;
+        while (slots[empty].distance != EMPTY) {
+            empty = nextSlot(empty);
+        }
+        for (int index = empty; index != probe.index; ) {
+            int previous = (index - 1) & (allocatedSize - 1);
+            slots[index].entry = std::move(slots[previous].entry);
+            slots[index].distance = slots[previous].distance + 1;
+            index = previous;
+        }
+    }
+    slots[probe.index].entry = std::move(entry);
+    slots[probe.index].distance = probe.distance;
+    logicalSize++;
+    return probe.index;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename... Args>
+std::pair<typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator, bool>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::tryEmplaceImpl(Key&& key, Args&&... args) {
+    if (allocatedSize == 0) {
+        rehash(kMinSlots);
+    }
+    Probe probe = probeFor(key);
+    if (probe.found) {
+        return { iterator(this, probe.index), false };
+    }
+    if (logicalSize + 1 > allocatedSize * kMaxLoadFactor) {
+        rehash(allocatedSize * 2);
+        probe = probeFor(key);
+    }
+    value_type entry(std::piecewise_construct, std::forward_as_tuple(std::forward<Key>(key)),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+    return { iterator(this, placeAt(probe, std::move(entry))), true };
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename... Args>
+std::pair<typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator, bool>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::try_emplace(const K& key, Args&&... args) {
+    return tryEmplaceImpl(key, std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename... Args>
+std::pair<typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator, bool>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::try_emplace(K&& key, Args&&... args) {
+    return tryEmplaceImpl(std::move(key), std::forward<Args>(args)...);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename... Args>
+std::pair<typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator, bool>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::emplace(Args&&... args) {
+    value_type entry(std::forward<Args>(args)...);
+    return tryEmplaceImpl(std::move(entry.first), std::move(entry.second));
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+std::pair<typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator, bool>
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::insert(const value_type& entry) {
+    return tryEmplaceImpl(entry.first, entry.second);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::operator[] (const K& key) {
+    return tryEmplaceImpl(key).first->second;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::operator[] (K&& key) {
+    return tryEmplaceImpl(std::move(key)).first->second;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::at(const K& key) {
+    int index = findIndex(key);
+    if (index == -1) {
+        error("Key not found in map.");
+    }
+    return slots[index].entry.second;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+const V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::at(const K& key) const {
+    return const_cast<ProbingHashMap*>(this)->at(key);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::at(const Key& key) {
+    int index = findIndex(key);
+    if (index == -1) {
+        error("Key not found in map.");
+    }
+    return slots[index].entry.second;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+const V& ProbingHashMap<K, V, probing, HashFn, KeyEqual>::at(const Key& key) const {
+    return const_cast<ProbingHashMap*>(this)->at(key);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::find(const K& key) {
+    int index = findIndex(key);
+    return index == -1 ? end() : iterator(this, index);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::const_iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::find(const K& key) const {
+    int index = findIndex(key);
+    return index == -1 ? end() : const_iterator(this, index);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::find(const Key& key) {
+    int index = findIndex(key);
+    return index == -1 ? end() : iterator(this, index);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::const_iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::find(const Key& key) const {
+    int index = findIndex(key);
+    return index == -1 ? end() : const_iterator(this, index);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+bool ProbingHashMap<K, V, probing, HashFn, KeyEqual>::contains(const K& key) const {
+    return findIndex(key) != -1;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+bool ProbingHashMap<K, V, probing, HashFn, KeyEqual>::contains(const Key& key) const {
+    return findIndex(key) != -1;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+bool ProbingHashMap<K, V, probing, HashFn, KeyEqual>::erase(const K& key) {
+    int index = findIndex(key);
+    if (index == -1) {
+        return false;
+    }
+    eraseAt(index);
+    return true;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+template <typename Key, typename>
+bool ProbingHashMap<K, V, probing, HashFn, KeyEqual>::erase(const Key& key) {
+    int index = findIndex(key);
+    if (index == -1) {
+        return false;
+    }
+    eraseAt(index);
+    return true;
+}
+
+/* An element can move back into the hole if the hole lies between its home slot and
+ * where it is now. In a Robin Hood table that's every element up to the first one at
+ * home, and each moves back by exactly one; with linear probing, elements can be
+ * skipped, and the ones that move may move further.
+ */
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+void ProbingHashMap<K, V, probing, HashFn, KeyEqual>::eraseAt(int index) {
+    int hole = index;
+    for (int next = nextSlot(hole); slots[next].distance != EMPTY; next = nextSlot(next)) {
+        int gap = (next - hole) & (allocatedSize - 1);
+        if (slots[next].distance >= gap) {
+            slots[hole].entry = std::move(slots[next].entry);
+            slots[hole].distance = slots[next].distance - gap;
+            hole = next;
+        } else if (probing == Probing::ROBIN_HOOD) {
+            break;
+        }
+    }
+    slots[hole].entry = value_type();
+    slots[hole].distance = EMPTY;
+    logicalSize--;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+void ProbingHashMap<K, V, probing, HashFn, KeyEqual>::clear() {
+    for (int i = 0; i < allocatedSize; i++) {
+        if (slots[i].distance != EMPTY) {
+            slots[i].entry = value_type();
+            slots[i].distance = EMPTY;
+        }
+    }
+    logicalSize = 0;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+void ProbingHashMap<K, V, probing, HashFn, KeyEqual>::rehash(int numSlots) {
+    Slot* oldSlots = slots;
+    int oldAllocatedSize = allocatedSize;
+
+    slots = new Slot[numSlots];
+    for (int i = 0; i < numSlots; i++) {
+        slots[i].distance = EMPTY;
+    }
+    allocatedSize = numSlots;
+    logicalSize = 0;
+    shift = 64;
+    for (int size = numSlots; size > 1; size /= 2) {
+        shift--;
+    }
+
+    /* Every key is known to be distinct, so each just goes where its search ends. */
+    for (int i = 0; i < oldAllocatedSize; i++) {
+        if (oldSlots[i].distance != EMPTY) {
+            placeAt(probeFor(oldSlots[i].entry.first), std::move(oldSlots[i].entry));
+        }
+    }
+    delete[] oldSlots;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+int ProbingHashMap<K, V, probing, HashFn, KeyEqual>::firstFullFrom(int index) const {
+    while (index < allocatedSize && slots[index].distance == EMPTY) {
+        index++;
+    }
+    return index;
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::begin() {
+    return iterator(this, firstFullFrom(0));
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::end() {
+    return iterator(this, allocatedSize);
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::const_iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::begin() const {
+    return const_iterator(this, firstFullFrom(0));
+}
+
+template <typename K, typename V, Probing probing, typename HashFn, typename KeyEqual>
+typename ProbingHashMap<K, V, probing, HashFn, KeyEqual>::const_iterator
+ProbingHashMap<K, V, probing, HashFn, KeyEqual>::end() const {
+    return const_iterator(this, allocatedSize);
+}
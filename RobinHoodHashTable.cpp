@@ -1,6 +1,12 @@
 #include "RobinHoodHashTable.h"
+#include "FrozenHashSet.h"
+#include "StringHashes.h"
 #include "GUI/SimpleTest.h"
+#include "error.h"
+#include "vector.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 using namespace std;
 
 /* This program implements the Robin Hood hash table with given hash functions. */
@@ -9,15 +15,63 @@ RobinHoodHashTable::RobinHoodHashTable(HashFunction<string> hashFn) {
     logicalSize = 0;
     allocatedSize = hashFn.numSlots();
     Hash = hashFn;
-    elems = new Slot[allocatedSize];
-    /* Initialize the elements in the array to empty. */
-    for (int i = 0; i < allocatedSize; i++) {
-        elems[i].distance = EMPTY_SLOT;
+    elems = emptySlots(allocatedSize);
+    fingerprints = new Fingerprint[allocatedSize];
+}
+
+RobinHoodHashTable::RobinHoodHashTable(HashFamily family, int initialSlots,
+                                       double maxLoadFactor, double minLoadFactor) {
+    if (initialSlots < 1) {
+        error("A growable table needs at least one slot.");
+    }
+    if (!(maxLoadFactor < 1) || !(0 <= minLoadFactor && minLoadFactor < maxLoadFactor / 2)) {
+        error("Load factors must satisfy 0 <= min < max / 2 and max < 1.");
     }
+    this->family = family;
+    this->minSlots = initialSlots;
+    this->maxLoadFactor = maxLoadFactor;
+    this->minLoadFactor = minLoadFactor;
+
+    logicalSize = 0;
+    Hash = family(initialSlots);
+    allocatedSize = Hash.numSlots();
+    elems = emptySlots(allocatedSize);
+    fingerprints = new Fingerprint[allocatedSize];
 }
 
 RobinHoodHashTable::~RobinHoodHashTable() {
     delete[] elems;
+    delete[] oldElems;
+    delete[] fingerprints;
+    delete[] oldFingerprints;
+}
+
+RobinHoodHashTable::Slot* RobinHoodHashTable::emptySlots(int numSlots) {
+    Slot* slots = new Slot[numSlots];
+    /* Initialize the elements in the array to empty. */
+    for (int i = 0; i < numSlots; i++) {
+        slots[i].distance = EMPTY_SLOT;
+    }
+    return slots;
+}
+
+/* Number of characters a string can hold without allocating, which this standard
+ * library does by storing them inside the string object itself.
+ */
+static const size_t kInlineCapacity = string().capacity();
+
+/* Short keys sit inside their slots and are cheap to compare directly, so they all get
+ * fingerprint zero and cost nothing to fingerprint. Long keys take the top bits of a hash
+ * of the whole key, so keys that differ anywhere, such as URLs that share both a prefix
+ * and a suffix, almost always get different fingerprints. That hash has nothing to do
+ * with the table's hash function, so elements with the same home still usually differ.
+ * It costs a pass over the key once per operation, about what one comparison would.
+ */
+RobinHoodHashTable::Fingerprint RobinHoodHashTable::fingerprintOf(const string& key) {
+    if (key.size() <= kInlineCapacity) {
+        return 0;
+    }
+    return Fingerprint(mumHash(key) >> (64 - 8 * sizeof(Fingerprint)));
 }
 
 int RobinHoodHashTable::size() const {
@@ -29,87 +83,312 @@ bool RobinHoodHashTable::isEmpty() const {
 }
 
 
-/* If an item is in the table, returns its index number;
- * otherwise returns -1.
+/* Returns whether the element in a slot equals the key. For long keys the fingerprints
+ * are checked first, to avoid following the stored string's pointer for a mismatch; short
+ * keys skip the fingerprint array entirely.
  */
-int RobinHoodHashTable::findElement (const string& elem) const {
-    int code = Hash(elem);
-    /* Checks if the hash table is empty. */
-    if (isEmpty()) {
-        return -1;
+bool RobinHoodHashTable::sameElement(const Slot& slot, const Fingerprint& slotPrint,
+                                     const string& key, Fingerprint print) {
+    if (key.size() > kInlineCapacity && slotPrint != print) {
+        return false;
     }
-    for (int i = 0; i < allocatedSize; i++ ) {
-        /* Finds a blank slot */
-        if (elems[(code+i) % allocatedSize].distance == EMPTY_SLOT) {
-            return -1;
-        }
-        /* The current slot is filled and closer to home than the searched element's distance from home */
-        if (elems[(code+i) % allocatedSize].distance < i){
+    return slot.element == key;
+}
+
+/* Index of the slot after the given one, wrapping around the end of the table.
+ * Power-of-two sizes wrap with a mask; other sizes with a comparison. Neither needs
+ * the division that % costs on every probe.
+ */
+int RobinHoodHashTable::nextSlot(int index, int numSlots) {
+    if ((numSlots & (numSlots - 1)) == 0) {
+        return (index + 1) & (numSlots - 1);
+    }
+    return index + 1 == numSlots ? 0 : index + 1;
+}
+
+/* If an item is in the given slots, returns its index number;
+ * otherwise returns -1.
+ */
+int RobinHoodHashTable::findIn(const Slot* slots, const Fingerprint* prints, int numSlots, int home,
+                               const string& elem, Fingerprint print) {
+    int index = home;
+    for (int i = 0; i < numSlots; i++ ) {
+        /* Finds a blank slot, or one closer to home than the searched element would be.
+         * (EMPTY_SLOT is negative, so one test covers both.)
+         */
+        if (slots[index].distance < i) {
             return -1;
         }
-        /* Excluding the above two possiblities, if the values of two items match, then the element is found. */
-        if (elems[(code+i) % allocatedSize].element == elem) {
-            return (code+i) % allocatedSize;
+        /* Only an element exactly as far from home can have the same home, so only then
+         * is it worth comparing the strings.
+         */
+        if (slots[index].distance == i && sameElement(slots[index], prints[index], elem, print)) {
+            return index;
         }
+        index = nextSlot(index, numSlots);
     }
     return -1;
 }
 
+/* If an item is in the table, returns its index number in elems;
+ * otherwise returns -1.
+ */
+int RobinHoodHashTable::findElement (const string& elem) const {
+    /* Checks if the hash table is empty. */
+    if (isEmpty()) {
+        return -1;
+    }
+    return findIn(elems, fingerprints, allocatedSize, Hash(elem), elem, fingerprintOf(elem));
+}
+
 bool RobinHoodHashTable::contains(const string& elem) const {
-    return findElement(elem) != -1 ? true : false;
+    if (probeCounting) {
+        probeCounters.lookups ++;
+        probeCounters.lookupProbes += probesFor(elem);
+    }
+    if (isEmpty()) {
+        return false;
+    }
+    Fingerprint print = fingerprintOf(elem);
+    if (findIn(elems, fingerprints, allocatedSize, Hash(elem), elem, print) != -1) {
+        return true;
+    }
+    /* Midway through a resize, the element may not have been moved over yet. */
+    return oldElems != nullptr &&
+           findIn(oldElems, oldFingerprints, oldAllocatedSize, oldHash(elem), elem, print) != -1;
 }
 
+/* Asks the processor to start loading the given address into the cache. */
+static void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#else
+    (void) address;
+#endif
+}
 
-bool RobinHoodHashTable::insert(const string& elem) {
-    /* Checks in case that the table is full or already contains the element to be inserted. */
-    if (logicalSize == allocatedSize || contains(elem)) {
-        return false;
+Vector<bool> RobinHoodHashTable::containsBatch(const Vector<string>& keys) const {
+    Vector<bool> result(keys.size());
+    if (isEmpty()) {
+        return result;
+    }
+    int homes[kBatchSize];
+    Fingerprint prints[kBatchSize];
+    for (int start = 0; start < keys.size(); start += kBatchSize) {
+        int end = min(start + kBatchSize, keys.size());
+        for (int i = start; i < end; i++) {
+            homes[i - start] = Hash(keys[i]);
+            prints[i - start] = fingerprintOf(keys[i]);
+            prefetch(&elems[homes[i - start]]);
+            if (keys[i].size() > kInlineCapacity) {
+                prefetch(&fingerprints[homes[i - start]]);
+            }
+        }
+        for (int i = start; i < end; i++) {
+            const string& key = keys[i];
+            result[i] = findIn(elems, fingerprints, allocatedSize, homes[i - start], key, prints[i - start]) != -1 ||
+                        (oldElems != nullptr &&
+                         findIn(oldElems, oldFingerprints, oldAllocatedSize, oldHash(key), key, prints[i - start]) != -1);
+        }
     }
-    int code = Hash(elem);
-    int distance = 0;
-    string curElem = elem;
+    return result;
+}
+
+/* Carries an element that has been displaced distance slots from home onward from the
+ * given index, swapping it with anything closer to home, until it lands in an empty slot.
+ */
+void RobinHoodHashTable::placeFrom(Slot* slots, Fingerprint* prints, int numSlots, int index,
+                                   string curElem, Fingerprint print, int distance) {
     /* Until an empty slot is found, repeatedly displaces the element in the table that is closer
      * to home than the element to be inserted. */
-    while (elems[code % allocatedSize].distance != EMPTY_SLOT) {
-        if (elems[code % allocatedSize].distance < distance) {
-            swap(curElem,elems[code % allocatedSize].element);
-            swap (distance, elems[code % allocatedSize].distance);
+    while (slots[index].distance != EMPTY_SLOT) {
+        if (slots[index].distance < distance) {
+            swap(curElem, slots[index].element);
+            swap(print, prints[index]);
+            swap(distance, slots[index].distance);
         }
         distance ++;
-        code ++;
+        index = nextSlot(index, numSlots);
     }
     /* Places the last element to be inserted into the empty slot. */
-    elems[code % allocatedSize].element = curElem;
-    elems[(code) % allocatedSize].distance = distance;
-    logicalSize ++;
-    return true;
+    slots[index].element = std::move(curElem);
+    slots[index].distance = distance;
+    prints[index] = print;
 }
 
+/* Places an element known not to be in the slots, which must have a free slot. */
+void RobinHoodHashTable::placeIn(Slot* slots, Fingerprint* prints, int numSlots, int home,
+                                 string elem, Fingerprint print) {
+    placeFrom(slots, prints, numSlots, home, std::move(elem), print, 0);
+}
 
+/* Inserts an element into slots with a free slot in one pass, returning false if it
+ * turns out to be there already. The element would have to sit before the first slot
+ * that is empty or closer to home than it, so reaching that slot proves it's new, and
+ * the displacing can start right there.
+ */
+bool RobinHoodHashTable::insertIn(Slot* slots, Fingerprint* prints, int numSlots, int home,
+                                  const string& elem, Fingerprint print) {
+    int index = home;
+    for (int distance = 0; ; distance++) {
+        if (slots[index].distance < distance) {
+            placeFrom(slots, prints, numSlots, index, elem, print, distance);
+            return true;
+        }
+        if (slots[index].distance == distance && sameElement(slots[index], prints[index], elem, print)) {
+            return false;
+        }
+        index = nextSlot(index, numSlots);
+    }
+}
 
+bool RobinHoodHashTable::insert(const string& elem) {
+    if (probeCounting) {
+        probeCounters.insertions ++;
+        probeCounters.insertionProbes += probesFor(elem);
+    }
+    Fingerprint print = fingerprintOf(elem);
+    if (family) {
+        migrate(migrationSteps);
+        if (oldElems != nullptr &&
+            findIn(oldElems, oldFingerprints, oldAllocatedSize, oldHash(elem), elem, print) != -1) {
+            return false;
+        }
+        /* Counting the elements still in the old array keeps elems from ever filling up. */
+        if (logicalSize + 1 > maxLoadFactor * allocatedSize) {
+            /* Rare enough that it's fine to check for a duplicate separately, so that
+             * re-inserting an element never triggers a resize.
+             */
+            if (findElement(elem) != -1) {
+                return false;
+            }
+            int numSlots = allocatedSize * 2;
+            while (logicalSize + 1 > maxLoadFactor * numSlots) numSlots *= 2;
+            resize(numSlots);
+        }
+    }
+    /* Checks in case that the table is full. */
+    else if (logicalSize == allocatedSize) {
+        return false;
+    }
+    if (!insertIn(elems, fingerprints, allocatedSize, Hash(elem), elem, print)) {
+        return false;
+    }
+    logicalSize ++;
+    return true;
+}
+
+/* Removes the element at the given index, then pulls the rest of its cluster back. */
+void RobinHoodHashTable::backwardShift(Slot* slots, Fingerprint* prints, int numSlots, int loc) {
+    int next = nextSlot(loc, numSlots);
+    /*If the element after the element to be removed is neither empty nor at its home position,
+     * move it backward one slot; repeat the process with the following elements until
+     * an empty slot or item at home position is found.*/
+    while (slots[next].distance > 0) {
+        slots[loc].element = std::move(slots[next].element);
+        slots[loc].distance = slots[next].distance - 1;
+        prints[loc] = prints[next];
+        loc = next;
+        next = nextSlot(next, numSlots);
+    }
+    /* Remove the element. */
+    slots[loc].distance = EMPTY_SLOT;
+}
 
 bool RobinHoodHashTable::remove(const string& elem) {
+    if (probeCounting) {
+        probeCounters.removals ++;
+        probeCounters.removalProbes += probesFor(elem);
+    }
+    if (family) {
+        migrate(migrationSteps);
+    }
     int loc = findElement(elem);
     /*The item is found */
     if (loc != -1) {
-        for (int i = 0; i < allocatedSize; i++) {
-            /*If the element after the element to be removed is neither empty nor at its home position,
-             * move it backward one slot; repeat the process with the following elements until
-             * an empty slot or item at home position is found.*/
-            if (elems[(loc + i + 1) % allocatedSize].distance > 0) {
-                elems[(loc + i) % allocatedSize].element = elems[(loc+i + 1) % allocatedSize].element;
-                elems[(loc + i) % allocatedSize].distance = elems[(loc+i + 1) % allocatedSize].distance - 1;
-            }
-            /* Remove the element. */
-            else {
-                elems[(loc+i) % allocatedSize].distance = EMPTY_SLOT;
-                logicalSize --;
-                return true;
-            }
+        backwardShift(elems, fingerprints, allocatedSize, loc);
+    } else if (oldElems != nullptr &&
+               (loc = findIn(oldElems, oldFingerprints, oldAllocatedSize, oldHash(elem), elem,
+                             fingerprintOf(elem))) != -1) {
+        backwardShift(oldElems, oldFingerprints, oldAllocatedSize, loc);
+        oldLogicalSize --;
+    } else {
+        /* If loc is equal to -1, either the table is empty or the element does not exist, and thus can't be removed. */
+        return false;
+    }
+    logicalSize --;
+
+    /* Halving keeps the load factor under 2 * minLoadFactor, which is below the maximum. */
+    if (minLoadFactor > 0 && allocatedSize > minSlots && logicalSize < minLoadFactor * allocatedSize) {
+        resize(max(allocatedSize / 2, minSlots));
+    }
+    return true;
+}
+
+/* The migration gets enough steps per operation to finish before the load factor can
+ * cross either threshold of the new array, so resizes never overlap. Moving the old
+ * array takes at most one step per old slot and per old element, plus one to free it.
+ * Each operation migrates before it can resize, so the operation that triggers the next
+ * resize still gets its steps in first.
+ */
+void RobinHoodHashTable::resize(int numSlots) {
+    if (oldElems != nullptr) {
+        error("Internal error: a resize started before the last one finished.");
+    }
+    oldElems = elems;
+    oldFingerprints = fingerprints;
+    oldAllocatedSize = allocatedSize;
+    oldLogicalSize = logicalSize;
+    oldHash = Hash;
+    migrationCursor = 0;
+
+    Hash = family(numSlots);
+    allocatedSize = Hash.numSlots();
+    elems = emptySlots(allocatedSize);
+    fingerprints = new Fingerprint[allocatedSize];
+
+    /* This operation leaves logicalSize or logicalSize + 1 elements; count from
+     * whichever is closer to each threshold. An insertion grows the table once it
+     * starts with at least floor(maxLoadFactor * allocatedSize) elements, and a removal
+     * shrinks it once it leaves fewer than minLoadFactor * allocatedSize.
+     */
+    long long opsUntilResize = (long long) (maxLoadFactor * allocatedSize) - (logicalSize + 1) + 1;
+    if (minLoadFactor > 0 && allocatedSize > minSlots) {
+        long long shrinkBelow = (long long) ceil(minLoadFactor * allocatedSize) - 1;
+        opsUntilResize = min(opsUntilResize, logicalSize - shrinkBelow);
+    }
+    opsUntilResize = max(opsUntilResize, 1LL);
+    long long work = oldAllocatedSize + oldLogicalSize + 1;
+    migrationSteps = max<long long>(kMigrationSteps, (work + opsUntilResize - 1) / opsUntilResize);
+}
+
+void RobinHoodHashTable::migrate(int steps) {
+    while (oldElems != nullptr && steps > 0) {
+        if (oldLogicalSize == 0) {
+            delete[] oldElems;
+            delete[] oldFingerprints;
+            oldElems = nullptr;
+            oldFingerprints = nullptr;
+            return;
         }
+        /* Taking the element at the cursor with a backward shift keeps the old array a
+         * valid Robin Hood table, and only ever pulls later elements onto the cursor,
+         * so nothing is skipped.
+         */
+        Slot& slot = oldElems[migrationCursor];
+        if (slot.distance == EMPTY_SLOT) {
+            migrationCursor++;
+        } else {
+            /* Fingerprints don't depend on the table size, so they come along as is. */
+            string elem = std::move(slot.element);
+            Fingerprint print = oldFingerprints[migrationCursor];
+            backwardShift(oldElems, oldFingerprints, oldAllocatedSize, migrationCursor);
+            oldLogicalSize--;
+            int home = Hash(elem);
+            placeIn(elems, fingerprints, allocatedSize, home, std::move(elem), print);
+        }
+        steps--;
     }
-    /* If loc is equal to -1, either the table is empty or the element does not exist, and thus can't be removed. */
-    return false;
 }
 
 
@@ -118,24 +397,761 @@ void RobinHoodHashTable::printDebugInfo() const {
     for (int i = 0; i < allocatedSize; i++) {
         cout << elems[i] <<endl;
     }
+    if (oldElems != nullptr) {
+        cout << "Not yet moved, from slot " << migrationCursor << " on:" << endl;
+        for (int i = 0; i < oldAllocatedSize; i++) {
+            cout << oldElems[i] << endl;
+        }
+    }
+}
+
+FrozenHashSet RobinHoodHashTable::freeze() const {
+    return FrozenHashSet(*this);
+}
+
+/* Walks the same slots findIn would, counting them, first in elems and then, if the
+ * element wasn't there, in the array still being moved out of.
+ */
+int RobinHoodHashTable::probesFor(const string& elem) const {
+    auto probesIn = [&](const Slot* slots, int numSlots, int home, bool& found) {
+        int index = home;
+        for (int i = 0; i < numSlots; i++) {
+            if (slots[index].distance < i) return i + 1;
+            if (slots[index].distance == i && slots[index].element == elem) {
+                found = true;
+                return i + 1;
+            }
+            index = nextSlot(index, numSlots);
+        }
+        return numSlots;
+    };
+    bool found = false;
+    int probes = probesIn(elems, allocatedSize, Hash(elem), found);
+    if (!found && oldElems != nullptr) {
+        probes += probesIn(oldElems, oldAllocatedSize, oldHash(elem), found);
+    }
+    return probes;
+}
+
+void RobinHoodHashTable::setProbeCounting(bool enabled) {
+    probeCounting = enabled;
+    probeCounters = ProbeCounters();
+}
+
+/* Every slot already records its element's distance from home, so nothing needs hashing. */
+HashTableStats RobinHoodHashTable::stats() const {
+    Vector<int> histogram;
+    auto addDistances = [&](const Slot* slots, int numSlots) {
+        for (int i = 0; i < numSlots; i++) {
+            int distance = slots[i].distance;
+            if (distance == EMPTY_SLOT) continue;
+            while (histogram.size() <= distance) histogram.add(0);
+            histogram[distance] ++;
+        }
+    };
+    addDistances(elems, allocatedSize);
+    if (oldElems != nullptr) {
+        addDistances(oldElems, oldAllocatedSize);
+    }
+    HashTableStats result = makeHashTableStats(allocatedSize, 0, histogram, [&](int i) {
+        return elems[i].distance != EMPTY_SLOT;
+    });
+    /* Misses stop early here, so the cluster lengths overstate what they cost. */
+    result.averageMissProbes = robinHoodMissProbes(allocatedSize, [&](int i) {
+        return elems[i].distance;
+    });
+    result.counters = probeCounters;
+    return result;
+}
+
+/* * * * * * Arena-Backed Table * * * * * */
+
+ArenaRobinHoodHashTable::ArenaRobinHoodHashTable(HashFunction<string> hashFn) {
+    logicalSize = 0;
+    allocatedSize = hashFn.numSlots();
+    Hash = hashFn;
+    elems = new Slot[allocatedSize];
+    for (int i = 0; i < allocatedSize; i++) {
+        elems[i].distance = EMPTY_SLOT;
+    }
+}
+
+ArenaRobinHoodHashTable::~ArenaRobinHoodHashTable() {
+    delete[] elems;
+}
+
+bool ArenaRobinHoodHashTable::isEmpty() const {
+    return size() == 0;
+}
+
+int ArenaRobinHoodHashTable::size() const {
+    return logicalSize;
+}
+
+int ArenaRobinHoodHashTable::nextSlot(int index) const {
+    return index + 1 == allocatedSize ? 0 : index + 1;
+}
+
+int ArenaRobinHoodHashTable::findElement(const string& key) const {
+    if (isEmpty()) {
+        return -1;
+    }
+    int index = Hash(key);
+    for (int i = 0; i < allocatedSize; i++) {
+        /* Empty, or closer to home than the key would be: the key isn't here. */
+        if (elems[index].distance < i) {
+            return -1;
+        }
+        if (elems[index].distance == i && arena.equals(elems[index].key, key)) {
+            return index;
+        }
+        index = nextSlot(index);
+    }
+    return -1;
+}
+
+bool ArenaRobinHoodHashTable::contains(const string& key) const {
+    return findElement(key) != -1;
+}
+
+bool ArenaRobinHoodHashTable::insert(const string& key) {
+    if (logicalSize == allocatedSize || contains(key)) {
+        return false;
+    }
+    /* Displace anything closer to home, just as RobinHoodHashTable does. Swapping
+     * ArenaKeys moves sixteen bytes, never the characters.
+     */
+    Slot current = { arena.add(key), 0 };
+    int index = Hash(key);
+    while (elems[index].distance != EMPTY_SLOT) {
+        if (elems[index].distance < current.distance) {
+            swap(current, elems[index]);
+        }
+        current.distance++;
+        index = nextSlot(index);
+    }
+    elems[index] = current;
+    logicalSize++;
+    return true;
+}
+
+bool ArenaRobinHoodHashTable::remove(const string& key) {
+    int index = findElement(key);
+    if (index == -1) {
+        return false;
+    }
+    arena.release(elems[index].key);
+
+    /* Backward-shift deletion. */
+    int next = nextSlot(index);
+    while (elems[next].distance > 0) {
+        elems[index] = elems[next];
+        elems[index].distance--;
+        index = next;
+        next = nextSlot(next);
+    }
+    elems[index].distance = EMPTY_SLOT;
+    logicalSize--;
+
+    compactArena();
+    return true;
+}
+
+void ArenaRobinHoodHashTable::compactArena() {
+    /* Waiting until garbage is most of the arena keeps the copying amortized O(1). */
+    if (arena.garbageBytes() <= arena.bytesUsed() / 2) {
+        return;
+    }
+    KeyArena fresh;
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].distance != EMPTY_SLOT) {
+            elems[i].key = fresh.add(arena.view(elems[i].key));
+        }
+    }
+    arena.swap(fresh);
+}
+
+void ArenaRobinHoodHashTable::rehash(HashFunction<string> hashFn) {
+    if (hashFn.numSlots() < logicalSize) {
+        error("The new hash function doesn't have room for every element.");
+    }
+    Slot* oldElems = elems;
+    int oldSize = allocatedSize;
+
+    allocatedSize = hashFn.numSlots();
+    Hash = hashFn;
+    elems = new Slot[allocatedSize];
+    for (int i = 0; i < allocatedSize; i++) {
+        elems[i].distance = EMPTY_SLOT;
+    }
+
+    /* The hash function takes a std::string, so reuse one buffer for every key rather
+     * than allocating a string apiece.
+     */
+    string scratch;
+    for (int i = 0; i < oldSize; i++) {
+        if (oldElems[i].distance == EMPTY_SLOT) continue;
+        scratch.assign(arena.view(oldElems[i].key));
+        Slot current = { oldElems[i].key, 0 };
+        int index = Hash(scratch);
+        while (elems[index].distance != EMPTY_SLOT) {
+            if (elems[index].distance < current.distance) {
+                swap(current, elems[index]);
+            }
+            current.distance++;
+            index = nextSlot(index);
+        }
+        elems[index] = current;
+    }
+    delete[] oldElems;
+}
+
+size_t ArenaRobinHoodHashTable::bytesUsed() const {
+    return allocatedSize * sizeof(Slot) + arena.bytesAllocated();
+}
+
+void ArenaRobinHoodHashTable::printDebugInfo() const {
+    for (int i = 0; i < allocatedSize; i++) {
+        if (elems[i].distance == EMPTY_SLOT) {
+            cout << "(empty)" << endl;
+        } else {
+            cout << arena.view(elems[i].key) << " " << elems[i].distance << endl;
+        }
+    }
 }
 
 /* * * * * * Test Cases Below This Point * * * * * */
 
 /* Optional: Add your own custom tests here! */
 
+/* Hash family for growable tables in the tests below. */
+HashFunction<string> randomOfSize(int numSlots) {
+    return Hash::random(numSlots);
+}
 
+STUDENT_TEST("Growable table resizes instead of filling up.") {
+    RobinHoodHashTable table(randomOfSize, 4, 0.75);
+    for (int i = 0; i < 1000; i++) {
+        EXPECT(table.insert(to_string(i)));
+        EXPECT(!table.insert(to_string(i)));
+        EXPECT(table.size() <= 0.75 * table.allocatedSize);
+    }
+    EXPECT_EQUAL(table.size(), 1000);
+    for (int i = 0; i < 2000; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), i < 1000);
+    }
+}
 
+STUDENT_TEST("Growable table moves elements across a few at a time.") {
+    RobinHoodHashTable table(randomOfSize, 1024, 0.5);
+    for (int i = 0; i < 512; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT(table.oldElems == nullptr);
 
+    /* This one crosses the threshold. Nearly everything should still be in the old array. */
+    EXPECT(table.insert("512"));
+    EXPECT_EQUAL(table.allocatedSize, 2048);
+    EXPECT(table.oldElems != nullptr);
+    EXPECT(table.oldLogicalSize >= 512 - RobinHoodHashTable::kMigrationSteps);
 
+    /* Each later operation moves at most a handful, and everything stays findable. */
+    int before = table.oldLogicalSize;
+    for (int i = 513; table.oldElems != nullptr; i++) {
+        EXPECT(table.insert(to_string(i)));
+        EXPECT(before - table.oldLogicalSize <= RobinHoodHashTable::kMigrationSteps);
+        before = table.oldLogicalSize;
+        for (int j = 0; j <= i; j += 37) {
+            EXPECT(table.contains(to_string(j)));
+        }
+    }
+    for (int i = 0; i < table.size(); i++) {
+        EXPECT(table.contains(to_string(i)));
+    }
+}
 
+STUDENT_TEST("Growable table shrinks on removal, but not below its initial size.") {
+    RobinHoodHashTable table(randomOfSize, 16, 0.8, 0.2);
+    for (int i = 0; i < 5000; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    int grown = table.allocatedSize;
+    for (int i = 0; i < 4990; i++) {
+        EXPECT(table.remove(to_string(i)));
+        EXPECT(!table.remove(to_string(i)));
+    }
+    EXPECT(table.allocatedSize < grown);
+    EXPECT(table.allocatedSize >= 16);
+    for (int i = 0; i < 5000; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), i >= 4990);
+    }
+    for (int i = 4990; i < 5000; i++) {
+        EXPECT(table.remove(to_string(i)));
+    }
+    EXPECT(table.isEmpty());
+    EXPECT_EQUAL(table.allocatedSize, 16);
+}
 
+STUDENT_TEST("Growable table agrees with a reference set under random operations.") {
+    RobinHoodHashTable table(randomOfSize, 1, 0.9, 0.3);
+    Vector<bool> present(400);
+    for (int round = 0; round < 50000; round++) {
+        int key = randomInteger(0, present.size() - 1);
+        /* Drift between filling and draining, so the table grows and shrinks repeatedly. */
+        bool adding = randomInteger(0, 99) < ((round / 5000) % 2 == 0 ? 70 : 30);
+        if (adding) {
+            EXPECT_EQUAL(table.insert(to_string(key)), !present[key]);
+            present[key] = true;
+        } else {
+            EXPECT_EQUAL(table.remove(to_string(key)), bool(present[key]));
+            present[key] = false;
+        }
+        EXPECT_EQUAL(table.contains(to_string(key)), bool(present[key]));
+    }
+    int count = 0;
+    for (int key = 0; key < present.size(); key++) {
+        EXPECT_EQUAL(table.contains(to_string(key)), bool(present[key]));
+        if (present[key]) count++;
+    }
+    EXPECT_EQUAL(table.size(), count);
+}
 
+STUDENT_TEST("Each resize finishes before the next one starts, a bounded few steps at a time.") {
+    /* Thresholds this close together leave few operations between one resize and the
+     * next, so each operation has to move more. Growing well past 4096 slots and then
+     * turning around checks that the steps per operation don't grow with the table.
+     */
+    for (int trial = 0; trial < 5; trial++) {
+        RobinHoodHashTable table(randomOfSize, 16, 0.9, 0.44);
+        Vector<bool> present;
+        int next = 0;
+        int numResizes = 0;
+        int maxSteps = 0;
+        auto step = [&](bool inserting, int key) {
+            bool wasMigrating = table.oldElems != nullptr;
+            int size = table.allocatedSize;
+            int before = table.oldLogicalSize;
+            if (inserting) {
+                EXPECT(table.insert(to_string(key)));
+            } else {
+                EXPECT(table.remove(to_string(key)));
+            }
+            if (table.allocatedSize != size) {
+                EXPECT(!wasMigrating);
+                numResizes++;
+            } else if (wasMigrating) {
+                EXPECT(before - table.oldLogicalSize <= table.migrationSteps);
+            }
+            maxSteps = max(maxSteps, table.migrationSteps);
+        };
 
+        while (table.allocatedSize <= 4096) {
+            present += true;
+            step(true, next++);
+        }
+        /* Shrink soon after the grow, then grow soon after the shrink. */
+        int grown = table.allocatedSize;
+        for (int key = 0; table.allocatedSize == grown; key++) {
+            step(false, key);
+            present[key] = false;
+        }
+        int shrunk = table.allocatedSize;
+        while (table.allocatedSize == shrunk) {
+            present += true;
+            step(true, next++);
+        }
+        EXPECT(numResizes >= 10);
+        EXPECT(maxSteps <= 200);
 
+        int count = 0;
+        for (int key = 0; key < present.size(); key++) {
+            EXPECT_EQUAL(table.contains(to_string(key)), bool(present[key]));
+            if (present[key]) count++;
+        }
+        EXPECT_EQUAL(table.size(), count);
+    }
+}
 
+STUDENT_TEST("Growable table rejects bad settings.") {
+    EXPECT_ERROR(RobinHoodHashTable(randomOfSize, 0));
+    EXPECT_ERROR(RobinHoodHashTable(randomOfSize, 8, 1.0));
+    EXPECT_ERROR(RobinHoodHashTable(randomOfSize, 8, 0.8, 0.4));
+    EXPECT_ERROR(RobinHoodHashTable(randomOfSize, 8, 0.8, -0.1));
+}
 
+STUDENT_TEST("Single-pass insert rejects duplicates anywhere in a crowded table.") {
+    /* Sizes on both sides of a power of two, to exercise both kinds of wraparound. */
+    for (int numSlots: { 63, 64, 65 }) {
+        RobinHoodHashTable table(Hash::random(numSlots));
+        for (int i = 0; i < numSlots; i++) {
+            EXPECT(table.insert(to_string(i)));
+            for (int j = 0; j <= i; j++) {
+                EXPECT(!table.insert(to_string(j)));
+            }
+            EXPECT_EQUAL(table.size(), i + 1);
+        }
+        /* Every slot should hold its element the right distance from home. */
+        for (int i = 0; i < numSlots; i++) {
+            const auto& slot = table.elems[i];
+            EXPECT_EQUAL((table.Hash(slot.element) + slot.distance) % numSlots, i);
+        }
+    }
+}
+
+STUDENT_TEST("Probe cost at load factors 0.5, 0.8 and 0.95.") {
+    for (int numSlots: { 1 << 20, (1 << 20) - 3 }) {
+        for (double load: { 0.5, 0.8, 0.95 }) {
+            int numElems = numSlots * load;
+            Vector<string> present, absent;
+            for (int i = 0; i < numElems; i++) {
+                present += "key" + to_string(i);
+                absent += "nokey" + to_string(i);
+            }
+            RobinHoodHashTable table(Hash::random(numSlots));
+            auto insertAll = [&] {
+                for (const string& key: present) table.insert(key);
+            };
+            auto findAll = [&](const Vector<string>& keys) {
+                int found = 0;
+                for (const string& key: keys) found += table.contains(key);
+                return found;
+            };
+            cout << "    " << numSlots << " slots, load factor " << load << endl;
+            TIME_OPERATION(numElems, insertAll());
+            TIME_OPERATION(numElems, findAll(present));
+            TIME_OPERATION(numElems, findAll(absent));
+            EXPECT_EQUAL(findAll(present), numElems);
+        }
+    }
+}
+
+STUDENT_TEST("Fingerprints move along with their elements.") {
+    auto checkPrints = [](const RobinHoodHashTable& table) {
+        for (int i = 0; i < table.allocatedSize; i++) {
+            if (table.elems[i].distance != RobinHoodHashTable::EMPTY_SLOT) {
+                EXPECT_EQUAL(table.fingerprints[i], RobinHoodHashTable::fingerprintOf(table.elems[i].element));
+            }
+        }
+    };
+    /* Too long to store inline, so every key gets a real fingerprint. */
+    auto keyFor = [](int i) {
+        return "a key too long to store inline, #" + to_string(i);
+    };
+
+    /* Distinct keys should nearly always get distinct fingerprints, or this test could
+     * pass with fingerprints left behind when their elements move.
+     */
+    Vector<bool> seen(1 << 16, false);
+    int distinct = 0;
+    for (int i = 0; i < 50; i++) {
+        RobinHoodHashTable::Fingerprint print = RobinHoodHashTable::fingerprintOf(keyFor(i));
+        EXPECT_NOT_EQUAL(print, 0);
+        if (!seen[print]) distinct++;
+        seen[print] = true;
+    }
+    EXPECT(distinct >= 48);
+
+    /* Everything in one home, so every insert and remove shifts the whole cluster. */
+    RobinHoodHashTable crowded(Hash::zero(50));
+    for (int i = 0; i < 50; i++) {
+        EXPECT(crowded.insert(keyFor(i)));
+        checkPrints(crowded);
+    }
+    for (int i = 0; i < 50; i += 2) {
+        EXPECT(crowded.remove(keyFor(i)));
+        checkPrints(crowded);
+    }
 
+    /* Growing and shrinking carries fingerprints into the new array. */
+    RobinHoodHashTable growable(randomOfSize, 8, 0.9, 0.3);
+    for (int i = 0; i < 3000; i++) {
+        EXPECT(growable.insert(keyFor(i)));
+    }
+    checkPrints(growable);
+    for (int i = 0; i < 2900; i++) {
+        EXPECT(growable.remove(keyFor(i)));
+    }
+    checkPrints(growable);
+    for (int i = 0; i < 3000; i++) {
+        EXPECT_EQUAL(growable.contains(keyFor(i)), i >= 2900);
+    }
+}
+
+STUDENT_TEST("Lookups of URL-like keys at load factor 0.95.") {
+    const int kSlots = 1 << 19;
+    const int kElems = kSlots * 0.95;
+    /* Long shared prefixes make every full string comparison expensive. Each id is eight
+     * digits, so the absent keys in the middle group have the same length, prefix and
+     * suffix as the present ones, and differ only in the middle.
+     */
+    const string prefix = "https://www.example.com/catalog/products/category/";
+    auto idOf = [](int i) {
+        string digits = to_string(i);
+        return string(8 - digits.size(), '0') + digits;
+    };
+    Vector<string> present, absentTail, absentMiddle;
+    for (int i = 0; i < kElems; i++) {
+        present += prefix + idOf(i) + "/details";
+        absentTail += prefix + idOf(i) + "/reviews";
+        absentMiddle += prefix + idOf(i + 10000000) + "/details";
+    }
+    RobinHoodHashTable table(Hash::random(kSlots));
+    for (const string& url: present) {
+        table.insert(url);
+    }
+    auto findAll = [&](const Vector<string>& keys) {
+        int found = 0;
+        for (const string& key: keys) found += table.contains(key);
+        return found;
+    };
+    TIME_OPERATION(kElems, findAll(present));
+    TIME_OPERATION(kElems, findAll(absentTail));
+    TIME_OPERATION(kElems, findAll(absentMiddle));
+    EXPECT_EQUAL(findAll(present), kElems);
+    EXPECT_EQUAL(findAll(absentTail), 0);
+    EXPECT_EQUAL(findAll(absentMiddle), 0);
+}
+
+STUDENT_TEST("Arena table agrees with a reference set, for short and long keys.") {
+    ArenaRobinHoodHashTable table(Hash::random(500));
+    Vector<bool> present(400);
+    auto keyFor = [](int i) {
+        /* Every other key is too long to store inline. */
+        return i % 2 == 0 ? to_string(i) : "a much longer key, number " + to_string(i);
+    };
+    for (int round = 0; round < 20000; round++) {
+        int i = randomInteger(0, present.size() - 1);
+        if (randomInteger(0, 1) == 0) {
+            EXPECT_EQUAL(table.insert(keyFor(i)), !present[i]);
+            present[i] = true;
+        } else {
+            EXPECT_EQUAL(table.remove(keyFor(i)), bool(present[i]));
+            present[i] = false;
+        }
+        EXPECT_EQUAL(table.contains(keyFor(i)), bool(present[i]));
+    }
+    /* All that churn must not let the arena fill up with dead keys. */
+    EXPECT(table.arena.garbageBytes() <= table.arena.bytesUsed() / 2);
+
+    table.rehash(Hash::random(1000));
+    EXPECT_EQUAL(table.allocatedSize, 1000);
+    for (int i = 0; i < present.size(); i++) {
+        EXPECT_EQUAL(table.contains(keyFor(i)), bool(present[i]));
+    }
+}
+
+STUDENT_TEST("Arena table fills up like the original, and won't rehash into too little room.") {
+    ArenaRobinHoodHashTable table(Hash::constant(10, 7));
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.insert(to_string(i)));
+        EXPECT_EQUAL(table.elems[(i + 7) % 10].distance, i);
+    }
+    EXPECT(!table.insert("10"));
+    EXPECT(!table.insert("0"));
+    EXPECT_ERROR(table.rehash(Hash::random(9)));
+    EXPECT(table.remove("0"));
+    EXPECT(table.insert("10"));
+}
+
+STUDENT_TEST("Memory per key: std::string slots versus arena slots.") {
+    /* Bytes the original table uses: its slots, its fingerprints, and a heap block for
+     * every string too long to keep inside itself.
+     */
+    auto stringTableBytes = [](const RobinHoodHashTable& table) {
+        size_t bytes = table.allocatedSize * (sizeof(RobinHoodHashTable::Slot) + sizeof(RobinHoodHashTable::Fingerprint));
+        for (int i = 0; i < table.allocatedSize; i++) {
+            const string& key = table.elems[i].element;
+            if (table.elems[i].distance != RobinHoodHashTable::EMPTY_SLOT && key.capacity() > string().capacity()) {
+                bytes += key.capacity() + 1;
+            }
+        }
+        return bytes;
+    };
+
+    cout << "    Slot size: " << sizeof(RobinHoodHashTable::Slot) << " bytes with std::string, "
+         << sizeof(ArenaRobinHoodHashTable::Slot) << " bytes with ArenaKey" << endl;
+
+    const int kElems = 100000;
+    for (string prefix: { "", "https://www.example.com/items/" }) {
+        RobinHoodHashTable strings(Hash::random(kElems / 0.8));
+        ArenaRobinHoodHashTable arenas(Hash::random(kElems / 0.8));
+        for (int i = 0; i < kElems; i++) {
+            strings.insert(prefix + to_string(i));
+            arenas.insert(prefix + to_string(i));
+        }
+        /* The arena needs no per-key allocations at all; the original needs one for
+         * every key that doesn't fit inline.
+         */
+        int heapBlocks = 0;
+        for (int i = 0; i < strings.allocatedSize; i++) {
+            if (strings.elems[i].distance != RobinHoodHashTable::EMPTY_SLOT &&
+                strings.elems[i].element.capacity() > string().capacity()) {
+                heapBlocks++;
+            }
+        }
+        cout << "    " << (prefix.empty() ? "Short" : "Long") << " keys: "
+             << double(stringTableBytes(strings)) / kElems << " bytes/key and "
+             << heapBlocks << " string allocations with std::string, "
+             << double(arenas.bytesUsed()) / kElems << " bytes/key with the arena" << endl;
+        EXPECT(arenas.bytesUsed() < stringTableBytes(strings));
+
+        auto findAll = [&](const auto& table) {
+            int found = 0;
+            for (int i = 0; i < kElems; i++) found += table.contains(prefix + to_string(i));
+            return found;
+        };
+        TIME_OPERATION(kElems, findAll(strings));
+        TIME_OPERATION(kElems, findAll(arenas));
+        EXPECT_EQUAL(findAll(arenas), kElems);
+    }
+}
+
+STUDENT_TEST("Growable table versus a table sized up front.") {
+    const int kElems = 1000000;
+    auto fill = [&](RobinHoodHashTable& table) {
+        for (int i = 0; i < kElems; i++) {
+            table.insert(to_string(i));
+        }
+    };
+    RobinHoodHashTable presized(Hash::random(kElems / 0.9));
+    TIME_OPERATION(kElems, fill(presized));
+
+    RobinHoodHashTable growable(randomOfSize, 16, 0.9);
+    TIME_OPERATION(kElems, fill(growable));
+    EXPECT_EQUAL(growable.size(), kElems);
+}
+
+STUDENT_TEST("containsBatch agrees with contains, for batches of any length.") {
+    RobinHoodHashTable table(Hash::random(1000));
+    for (int i = 0; i < 600; i += 2) {
+        table.insert(to_string(i));
+    }
+    table.insert("a key long enough to need its own heap allocation");
+    EXPECT(table.remove("10"));
+
+    Vector<string> keys;
+    EXPECT(table.containsBatch(keys).isEmpty());
+    for (int length: { 1, 15, 16, 17, 600 }) {
+        keys.clear();
+        for (int i = 0; i < length; i++) {
+            keys += to_string(i);
+        }
+        keys += "a key long enough to need its own heap allocation";
+        Vector<bool> found = table.containsBatch(keys);
+        EXPECT_EQUAL(found.size(), keys.size());
+        for (int i = 0; i < keys.size(); i++) {
+            EXPECT_EQUAL(found[i], table.contains(keys[i]));
+        }
+    }
+
+    RobinHoodHashTable empty(Hash::random(10));
+    EXPECT_EQUAL(empty.containsBatch({ "a", "b" }), { false, false });
+}
+
+STUDENT_TEST("containsBatch finds elements not yet moved across by a resize.") {
+    RobinHoodHashTable table([](int numSlots) { return Hash::random(numSlots); }, 64);
+    Vector<string> keys;
+    for (int i = 0; i < 58; i++) {
+        table.insert(to_string(i));
+        keys += to_string(i);
+    }
+    EXPECT(table.oldElems != nullptr);
+    for (bool isThere: table.containsBatch(keys)) {
+        EXPECT(isThere);
+    }
+}
+
+STUDENT_TEST("containsBatch versus one contains at a time, in a table far larger than the cache.") {
+    /* 4M slots of 40 bytes each: 160MB, beyond a typical L3 cache. */
+    const int kNumSlots = 1 << 22;
+    const int kElems = kNumSlots / 2;
+    RobinHoodHashTable table(Hash::random(kNumSlots));
+    Vector<string> keys;
+    for (int i = 0; i < kElems; i++) {
+        table.insert(to_string(i));
+        keys += to_string(randomInteger(0, 2 * kElems));
+    }
+
+    auto oneAtATime = [&] {
+        int found = 0;
+        for (const string& key: keys) found += table.contains(key);
+        return found;
+    };
+    auto batched = [&] {
+        int found = 0;
+        for (bool isThere: table.containsBatch(keys)) found += isThere;
+        return found;
+    };
+    int found = 0;
+    TIME_OPERATION(kElems, found += oneAtATime());
+    TIME_OPERATION(kElems, found -= batched());
+    EXPECT_EQUAL(found, 0);
+}
+
+
+
+
+
+
+
+
+
+
+
+
+
+
+STUDENT_TEST("stats reports distances and clusters, and counts probes when asked.") {
+    RobinHoodHashTable table(Hash::identity(10));
+    for (string key: { "0", "10", "20", "5" }) {
+        table.insert(key);
+    }
+    HashTableStats stats = table.stats();
+    EXPECT_EQUAL(stats.numElements, 4);
+    EXPECT_EQUAL(stats.numTombstones, 0);
+    EXPECT_EQUAL(stats.probeHistogram, { 2, 1, 1 });
+    EXPECT_EQUAL(stats.averageProbeDistance, 0.75);
+    EXPECT_EQUAL(stats.numClusters, 2);
+    EXPECT_EQUAL(stats.maxClusterLength, 3);
+    /* From each home in turn: 4 3 2 1 1 2 1 1 1 1. */
+    EXPECT_EQUAL(stats.averageMissProbes, 1.7);
+
+    /* Elements at home stop a miss from the slot before. Walking the cluster would take
+     * 5 4 3 2 probes from the first four homes, but here each takes two.
+     */
+    RobinHoodHashTable atHome(Hash::identity(10));
+    for (string key: { "0", "1", "2", "3" }) {
+        atHome.insert(key);
+    }
+    EXPECT_EQUAL(atHome.stats().averageMissProbes, 1.4);
+
+    table.setProbeCounting(true);
+    EXPECT(!table.contains("30"));  // Four probes, ending at the empty slot 3.
+    EXPECT(!table.contains("1"));   // Three, stopping at slot 3 as well.
+    EXPECT(table.remove("10"));     // Two.
+    EXPECT(!table.insert("0"));     // One.
+    stats = table.stats();
+    EXPECT_EQUAL(stats.counters.lookupProbes, 7);
+    EXPECT_EQUAL(stats.counters.removalProbes, 2);
+    EXPECT_EQUAL(stats.counters.insertions, 1);
+    EXPECT_EQUAL(stats.counters.insertionProbes, 1);
+}
+
+STUDENT_TEST("stats counts every element midway through a resize.") {
+    RobinHoodHashTable table([](int numSlots) { return Hash::random(numSlots); }, 64);
+    table.setProbeCounting(true);
+    for (int i = 0; i < 1000; i++) {
+        table.insert(to_string(i));
+        EXPECT_EQUAL(table.stats().numElements, table.size());
+    }
+    for (int i = 0; i < 1000; i++) {
+        EXPECT(table.contains(to_string(i)));
+    }
+    HashTableStats stats = table.stats();
+    EXPECT_EQUAL(stats.counters.lookups, 1000);
+    EXPECT(stats.counters.probesPerLookup() >= 1);
+    EXPECT(stats.loadFactor <= 0.9);
+}
 
 /* * * * * Provided Tests Below This Point * * * * */
 #include "Demos/Utility.h"
@@ -4,10 +4,25 @@
 #include "Demos/Utility.h"
 #include "GUI/SimpleTest.h"
 #include "GUI/MemoryDiagnostics.h"
+#include "HashTableStats.h"
+#include "KeyArena.h"
+#include "vector.h"
+#include <cstdint>
+#include <functional>
 #include <string>
 
+class FrozenHashSet;
+
 class RobinHoodHashTable {
 public:
+    /* A way of making hash functions of any size, such as
+     *
+     *     [](int numSlots) { return Hash::random(numSlots); }
+     *
+     * Growable tables need one of these, since each resize needs a new hash function.
+     */
+    using HashFamily = std::function<HashFunction<std::string>(int numSlots)>;
+
     /**
      * Constructs a new Robin Hood hash table that uses the hash function given
      * as the argument. (Note that the hash function lets you determine how
@@ -15,6 +30,28 @@ public:
      */
     RobinHoodHashTable(HashFunction<std::string> hashFn);
 
+    /**
+     * Constructs a Robin Hood hash table that resizes itself instead of filling up.
+     * Whenever an insertion would push the load factor past maxLoadFactor, the table
+     * doubles in size. If minLoadFactor is positive, whenever a removal drops the load
+     * factor below it, the table halves in size, though never below initialSlots.
+     *
+     * Resizing is incremental: the old table is kept alongside the new one, and each
+     * insertion or removal moves a few more elements across, so no single operation
+     * pays for rehashing everything. Each resize finishes before the next can start;
+     * the closer minLoadFactor is to maxLoadFactor / 2, the more elements each
+     * operation has to move to make sure of that.
+     *
+     * The load factors must satisfy 0 <= minLoadFactor < maxLoadFactor / 2 and
+     * maxLoadFactor < 1, and initialSlots must be positive; otherwise this calls error().
+     *
+     * Power-of-two sizes make probing a little cheaper, since wrapping around the end
+     * of the table is then a bit mask. Sizes only ever double or halve, so a power-of-two
+     * initialSlots keeps the table at a power of two for good.
+     */
+    RobinHoodHashTable(HashFamily family, int initialSlots,
+                       double maxLoadFactor = 0.9, double minLoadFactor = 0);
+
     /**
      * Cleans up all memory allocated by this hash table.
      */
@@ -34,7 +71,8 @@ public:
      * Inserts the specified element into this hash table. If the element already
      * exists, this leaves the table unchanged. If there is no space in the table
      * to insert an element - that is, every slot is full - this should return
-     * false to indicate that there is no more space.
+     * false to indicate that there is no more space. Growable tables make room
+     * instead, so they never run out of space.
      *
      * This function returns whether the element was inserted into the table.
      */
@@ -45,6 +83,14 @@ public:
      */
     bool contains(const std::string& key) const;
 
+    /**
+     * Looks up many keys at once, returning whether each one is in the table. The keys
+     * are taken kBatchSize at a time: all of them are hashed and their home slots
+     * prefetched before any is looked up, so that in a table too large for the cache,
+     * the memory accesses overlap rather than each waiting on the last.
+     */
+    Vector<bool> containsBatch(const Vector<std::string>& keys) const;
+
     /**
      * Removes the specified element from this hash table. If the element is not
      * present in the hash table, this operation is a no-op.
@@ -56,6 +102,29 @@ public:
      */
     bool remove(const std::string& key);
 
+    /**
+     * Returns a summary of the table's shape: its load factor, how far elements sit from
+     * their home slots, how long its clusters are, and so on (see HashTableStats). This
+     * takes one pass over the slots. Midway through a resize, the distances include the
+     * elements not yet moved, but the slots and clusters are those of the new array.
+     * averageMissProbes counts only the slots a miss really looks at before it gives up.
+     */
+    HashTableStats stats() const;
+
+    /**
+     * Turns counting of the probes each contains, insert and remove makes on or off,
+     * starting the counts over from zero. The counts show up in stats(). Counting has
+     * each operation walk its probe sequence a second time, so it's for measuring, not
+     * for leaving on.
+     */
+    void setProbeCounting(bool enabled);
+
+    /**
+     * Builds a read-only copy of the table around a minimal perfect hash function, for
+     * data that won't change again. Lookups in it never probe. See FrozenHashSet.
+     */
+    FrozenHashSet freeze() const;
+
     /**
      * Prints out relevant information to assist with debugging.
      */
@@ -94,13 +163,169 @@ private:
     /* Finds the index of the element if the element is in the hashtable. */
     int findElement (const std::string& key) const;
 
+    /* A second, cheap hash of each element, kept in an array parallel to elems.
+     * Probes compare fingerprints before long strings, so a mismatch almost never has
+     * to chase the string's characters. (They can't live in Slot, whose layout the
+     * tests depend on.)
+     */
+    using Fingerprint = std::uint16_t;
+    Fingerprint* fingerprints = nullptr;
+    static Fingerprint fingerprintOf(const std::string& key);
+
+    /* Returns whether the element in a slot, with the given fingerprint, equals the key. */
+    static bool sameElement(const Slot& slot, const Fingerprint& slotPrint,
+                            const std::string& key, Fingerprint print);
+
+    /* The same jobs as findElement, insert and remove, on any array of slots and its
+     * fingerprints. placeIn skips the duplicate check, for elements known to be new.
+     */
+    static int findIn(const Slot* slots, const Fingerprint* prints, int numSlots, int home,
+                      const std::string& key, Fingerprint print);
+    static bool insertIn(Slot* slots, Fingerprint* prints, int numSlots, int home,
+                         const std::string& elem, Fingerprint print);
+    static void placeIn(Slot* slots, Fingerprint* prints, int numSlots, int home,
+                        std::string elem, Fingerprint print);
+    static void placeFrom(Slot* slots, Fingerprint* prints, int numSlots, int index,
+                          std::string elem, Fingerprint print, int distance);
+    static void backwardShift(Slot* slots, Fingerprint* prints, int numSlots, int index);
+
+    /* Index of the slot after the given one, wrapping around the end of the table. */
+    static int nextSlot(int index, int numSlots);
+
+    /* Makes a new array of empty slots. */
+    static Slot* emptySlots(int numSlots);
 
+    /* How many keys containsBatch has in flight at once. */
+    static const int kBatchSize = 16;
 
+    /* Settings for growable tables. family is empty for fixed-size tables. */
+    HashFamily family;
+    int minSlots = 0;
+    double maxLoadFactor = 1;
+    double minLoadFactor = 0;
 
+    /* While a resize is in progress, the elements not yet moved into elems. They are
+     * taken from the front of the array, at migrationCursor, so everything before the
+     * cursor is empty. logicalSize counts the elements of both arrays.
+     */
+    Slot* oldElems = nullptr;
+    Fingerprint* oldFingerprints = nullptr;
+    int oldAllocatedSize = 0;
+    int oldLogicalSize = 0;
+    int migrationCursor = 0;
+    HashFunction<std::string> oldHash;
+
+    /* How many slots of the old array each insertion or removal deals with: at least
+     * kMigrationSteps, and more if that's what it takes for the migration to finish
+     * before the next resize could start. That depends only on the load factors, never
+     * on how many elements there are.
+     */
+    static const int kMigrationSteps = 8;
+    int migrationSteps = kMigrationSteps;
+
+    /* Starts moving everything into a new array of the given size. */
+    void resize(int numSlots);
+
+    /* Moves elements from the old array into elems, visiting at most the given number
+     * of old slots.
+     */
+    void migrate(int steps);
+
+
+
+
+
+    /* Probe counting, for stats(). */
+    bool probeCounting = false;
+    mutable ProbeCounters probeCounters;
+
+    /* Number of slots a search for the key looks at, including the one that ends it. */
+    int probesFor(const std::string& key) const;
 
     /* Internal shenanigans to make this play well with C++. */
     DISALLOW_COPYING_OF(RobinHoodHashTable);
     ALLOW_TEST_ACCESS();
+
+    /* Snapshots and frozen sets read the slots directly when they're built. */
+    friend class RobinHoodSnapshot;
+    friend class FrozenHashSet;
     MAKE_PRINTERS_FOR(Slot);
     MAKE_COMPARATORS_FOR(Slot);
 };
+
+/**
+ * A fixed-size Robin Hood hash table with the same interface as RobinHoodHashTable, but
+ * whose slots hold ArenaKeys instead of std::strings. Each slot takes 20 bytes rather
+ * than 40; keys of up to twelve characters sit inside their slots, and longer keys are
+ * packed end to end in one KeyArena instead of each getting its own heap allocation.
+ */
+class ArenaRobinHoodHashTable {
+public:
+    /**
+     * Constructs a new table using the given hash function, with hashFn.numSlots() slots.
+     */
+    ArenaRobinHoodHashTable(HashFunction<std::string> hashFn);
+
+    /**
+     * Cleans up all memory allocated by this hash table.
+     */
+    ~ArenaRobinHoodHashTable();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Inserts, looks up and removes elements exactly as RobinHoodHashTable does. In
+     * particular, insert returns false if the table is full.
+     */
+    bool insert(const std::string& key);
+    bool contains(const std::string& key) const;
+    bool remove(const std::string& key);
+
+    /**
+     * Moves every element into a new slot array sized and placed by the given hash
+     * function. Only the 20-byte slots move; the characters of long keys stay put in
+     * the arena. If the new function has fewer slots than there are elements, this
+     * calls error().
+     */
+    void rehash(HashFunction<std::string> hashFn);
+
+    /**
+     * Returns how many bytes the slot array and the arena take up together.
+     */
+    std::size_t bytesUsed() const;
+
+    /**
+     * Prints out relevant information to assist with debugging.
+     */
+    void printDebugInfo() const;
+
+private:
+    struct Slot {
+        ArenaKey key;
+        int distance;
+
+        TRACK_ALLOCATIONS_OF(Slot);
+    };
+
+    static const int EMPTY_SLOT = -137;
+
+    Slot* elems = nullptr;
+    int allocatedSize;
+    int logicalSize;
+    HashFunction<std::string> Hash;
+    KeyArena arena;
+
+    /* Finds the index of the element if the element is in the hashtable, or -1. */
+    int findElement(const std::string& key) const;
+
+    /* Index of the slot after the given one, wrapping around the end of the table. */
+    int nextSlot(int index) const;
+
+    /* Drops the characters of removed keys once they make up most of the arena. */
+    void compactArena();
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(ArenaRobinHoodHashTable);
+    ALLOW_TEST_ACCESS();
+};
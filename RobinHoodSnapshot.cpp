@@ -0,0 +1,390 @@
+#include "RobinHoodSnapshot.h"
+#include "GUI/SimpleTest.h"
+#include "StringHashes.h"
+#include "error.h"
+#include "random.h"
+#include "vector.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace std;
+
+/* This program implements a Robin Hood hash table that is queried straight out of a file. */
+
+uint64_t RobinHoodSnapshot::homeOf(uint64_t hash, int shift) {
+    return shift == 64 ? 0 : hash >> shift;
+}
+
+/* Elements are laid out by inserting them into a fresh slot array in the usual Robin Hood
+ * way. Every key in a table is distinct, so there's nothing to compare. The keys are
+ * written out afterwards in the same order they were given offsets.
+ */
+void RobinHoodSnapshot::save(const RobinHoodHashTable& table, const string& filename, uint64_t seed) {
+    auto forEachElement = [&](auto visit) {
+        for (int i = 0; i < table.allocatedSize; i++) {
+            if (table.elems[i].distance != RobinHoodHashTable::EMPTY_SLOT) visit(table.elems[i].element);
+        }
+        /* Midway through a resize, some elements are still in the old array. */
+        if (table.oldElems != nullptr) {
+            for (int i = 0; i < table.oldAllocatedSize; i++) {
+                if (table.oldElems[i].distance != RobinHoodHashTable::EMPTY_SLOT) visit(table.oldElems[i].element);
+            }
+        }
+    };
+
+    uint64_t numSlots = 16;
+    int shift = 60;
+    while (table.size() > kMaxLoadFactor * numSlots) {
+        numSlots *= 2;
+        shift--;
+    }
+
+    Slot* laidOut = new Slot[numSlots];
+    for (uint64_t i = 0; i < numSlots; i++) {
+        laidOut[i] = { EMPTY_SLOT, 0, 0 };
+    }
+    uint64_t keyBytes = 0;
+    forEachElement([&](const string& key) {
+        uint64_t hash = mumHash(key, seed);
+        Slot entry = { 0, uint32_t(hash), keyBytes };
+        keyBytes += sizeof(uint32_t) + key.size();
+        for (uint64_t index = homeOf(hash, shift); ; index = (index + 1) & (numSlots - 1)) {
+            if (laidOut[index].distance == EMPTY_SLOT) {
+                laidOut[index] = entry;
+                break;
+            }
+            if (laidOut[index].distance < entry.distance) {
+                swap(laidOut[index], entry);
+            }
+            entry.distance++;
+        }
+    });
+
+    Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byteOrder = kByteOrderMark;
+    header.seed = seed;
+    header.numSlots = numSlots;
+    header.numElements = table.size();
+    header.slotsOffset = sizeof(Header);
+    header.keysOffset = header.slotsOffset + numSlots * sizeof(Slot);
+    header.fileSize = header.keysOffset + keyBytes;
+
+    ofstream output(filename, ios::binary | ios::trunc);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(laidOut), numSlots * sizeof(Slot));
+    delete[] laidOut;
+    forEachElement([&](const string& key) {
+        uint32_t length = key.size();
+        output.write(reinterpret_cast<const char*>(&length), sizeof(length));
+        output.write(key.data(), key.size());
+    });
+    output.close();
+    if (!output) {
+        error("Could not write snapshot " + filename);
+    }
+}
+
+RobinHoodSnapshot::RobinHoodSnapshot(const string& filename) {
+#ifndef _WIN32
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file == -1) error("Could not open file " + filename);
+    struct stat info;
+    if (fstat(file, &info) == -1) {
+        close(file);
+        error("Could not read the size of file " + filename);
+    }
+    if (size_t(info.st_size) < sizeof(Header)) {
+        close(file);
+        error(filename + " is too short to be a snapshot.");
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) error("Could not map file " + filename);
+    /* Lookups land all over the slots, so reading ahead would only waste memory. */
+    madvise(mapped, info.st_size, MADV_RANDOM);
+    image = static_cast<const char*>(mapped);
+    imageSize = info.st_size;
+    isMapped = true;
+#else
+    /* No mmap here, so read the whole file into one buffer instead. The buffer is made
+     * of 64-bit words so that the header and slots are aligned.
+     */
+    ifstream input(filename, ios::binary | ios::ate);
+    if (!input) error("Could not open file " + filename);
+    imageSize = input.tellg();
+    if (imageSize < sizeof(Header)) error(filename + " is too short to be a snapshot.");
+    char* buffer = reinterpret_cast<char*>(new uint64_t[(imageSize + 7) / 8]);
+    input.seekg(0);
+    input.read(buffer, imageSize);
+    image = buffer;
+    if (!input) {
+        delete[] reinterpret_cast<uint64_t*>(buffer);
+        error("Could not read file " + filename);
+    }
+#endif
+
+    header = reinterpret_cast<const Header*>(image);
+    /* The destructor doesn't run if the constructor fails, so clean up here. */
+    try {
+        checkHeader(filename);
+    } catch (...) {
+        release();
+        throw;
+    }
+    slots = reinterpret_cast<const Slot*>(image + header->slotsOffset);
+    keys = image + header->keysOffset;
+    shift = 64;
+    for (uint64_t numSlots = header->numSlots; numSlots > 1; numSlots /= 2) {
+        shift--;
+    }
+}
+
+RobinHoodSnapshot::~RobinHoodSnapshot() {
+    release();
+}
+
+void RobinHoodSnapshot::release() {
+#ifndef _WIN32
+    if (isMapped) munmap(const_cast<char*>(image), imageSize);
+#else
+    delete[] reinterpret_cast<const uint64_t*>(image);
+#endif
+}
+
+void RobinHoodSnapshot::checkHeader(const string& filename) const {
+    if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+        error(filename + " is not a snapshot.");
+    }
+    if (header->byteOrder != kByteOrderMark) {
+        error(filename + " was written by a machine with the opposite byte order.");
+    }
+    if (header->version != kVersion) {
+        error(filename + " is a version " + to_string(header->version) +
+              " snapshot, but only version " + to_string(kVersion) + " can be read.");
+    }
+    uint64_t numSlots = header->numSlots;
+    bool consistent = numSlots > 0 && (numSlots & (numSlots - 1)) == 0 &&
+                      header->numElements < numSlots &&
+                      header->slotsOffset == sizeof(Header) &&
+                      header->keysOffset == header->slotsOffset + numSlots * sizeof(Slot) &&
+                      header->keysOffset <= header->fileSize &&
+                      header->fileSize == imageSize;
+    if (!consistent) {
+        error(filename + " is truncated or corrupt.");
+    }
+}
+
+int RobinHoodSnapshot::size() const {
+    return header->numElements;
+}
+
+bool RobinHoodSnapshot::isEmpty() const {
+    return size() == 0;
+}
+
+/* Checking each key as it's read keeps opening an image from having to read every slot.
+ * The checks are written so that no huge offset or length can overflow them.
+ */
+string_view RobinHoodSnapshot::keyAt(uint64_t offset) const {
+    uint64_t keysSize = header->fileSize - header->keysOffset;
+    uint32_t length;
+    if (offset > keysSize || keysSize - offset < sizeof(length)) {
+        error("Snapshot image is corrupt: a key lies outside the file.");
+    }
+    memcpy(&length, keys + offset, sizeof(length));
+    if (length > keysSize - offset - sizeof(length)) {
+        error("Snapshot image is corrupt: a key runs past the end of the file.");
+    }
+    return string_view(keys + offset + sizeof(length), length);
+}
+
+/* The usual Robin Hood lookup, except that the stored hash bits rule out almost every
+ * wrong key before its characters are read.
+ */
+bool RobinHoodSnapshot::contains(string_view key) const {
+    uint64_t hash = mumHash(key, header->seed);
+    uint32_t fingerprint = uint32_t(hash);
+    uint64_t mask = header->numSlots - 1;
+    uint64_t index = homeOf(hash, shift);
+    for (int32_t distance = 0; uint64_t(distance) <= mask; distance++) {
+        const Slot& slot = slots[index];
+        if (slot.distance < distance) {
+            return false;
+        }
+        if (slot.distance == distance && slot.fingerprint == fingerprint && keyAt(slot.keyOffset) == key) {
+            return true;
+        }
+        index = (index + 1) & mask;
+    }
+    return false;
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+STUDENT_TEST("A snapshot answers lookups exactly as the table it was taken of.") {
+    const string filename = "robinhood-snapshot-test.rhs";
+    RobinHoodHashTable table(Hash::random(10000));
+    for (int i = 0; i < 8000; i++) {
+        table.insert(to_string(i));
+    }
+    for (int i = 0; i < 8000; i += 3) {
+        table.remove(to_string(i));
+    }
+    /* An empty key, and keys long enough to need several cache lines. */
+    table.insert("");
+    table.insert(string(1000, 'x'));
+    table.insert(string(1000, 'x') + "y");
+
+    RobinHoodSnapshot::save(table, filename);
+    RobinHoodSnapshot snapshot(filename);
+    EXPECT_EQUAL(snapshot.size(), table.size());
+    for (int i = -100; i < 8100; i++) {
+        EXPECT_EQUAL(snapshot.contains(to_string(i)), table.contains(to_string(i)));
+    }
+    EXPECT(snapshot.contains(""));
+    EXPECT(snapshot.contains(string(1000, 'x')));
+    EXPECT(snapshot.contains(string(1000, 'x') + "y"));
+    EXPECT(!snapshot.contains(string(999, 'x')));
+
+    /* Saving again replaces the old image. */
+    RobinHoodHashTable empty(Hash::random(10));
+    RobinHoodSnapshot::save(empty, filename, 137);
+    RobinHoodSnapshot emptySnapshot(filename);
+    EXPECT(emptySnapshot.isEmpty());
+    EXPECT(!emptySnapshot.contains(""));
+    remove(filename.c_str());
+}
+
+STUDENT_TEST("A snapshot taken midway through a resize includes the elements not yet moved.") {
+    const string filename = "robinhood-snapshot-test.rhs";
+    RobinHoodHashTable table([](int numSlots) { return Hash::random(numSlots); }, 64);
+    int count = 0;
+    while (table.oldElems == nullptr || count < 1000) {
+        table.insert(to_string(count++));
+    }
+    EXPECT(table.oldElems != nullptr);
+
+    RobinHoodSnapshot::save(table, filename);
+    RobinHoodSnapshot snapshot(filename);
+    EXPECT_EQUAL(snapshot.size(), count);
+    for (int i = 0; i < count; i++) {
+        EXPECT(snapshot.contains(to_string(i)));
+    }
+    EXPECT(!snapshot.contains(to_string(count)));
+    remove(filename.c_str());
+}
+
+STUDENT_TEST("Snapshots reject missing, foreign, truncated, future and damaged files.") {
+    const string filename = "robinhood-snapshot-test.rhs";
+    EXPECT_ERROR(RobinHoodSnapshot("no-such-snapshot.rhs"));
+
+    {
+        ofstream output(filename, ios::binary);
+        output << "This is a text file, and it is long enough to hold a header, but it isn't one.";
+    }
+    EXPECT_ERROR(RobinHoodSnapshot(filename));
+
+    RobinHoodHashTable table(Hash::random(100));
+    for (int i = 0; i < 50; i++) {
+        table.insert(to_string(i));
+    }
+    RobinHoodSnapshot::save(table, filename);
+    string contents;
+    {
+        ifstream input(filename, ios::binary);
+        contents.assign(istreambuf_iterator<char>(input), istreambuf_iterator<char>());
+    }
+    auto rewrite = [&](const string& newContents) {
+        ofstream output(filename, ios::binary | ios::trunc);
+        output << newContents;
+    };
+
+    rewrite(contents.substr(0, contents.size() - 1));
+    EXPECT_ERROR(RobinHoodSnapshot(filename));
+
+    string future = contents;
+    future[offsetof(RobinHoodSnapshot::Header, version)]++;
+    rewrite(future);
+    EXPECT_ERROR(RobinHoodSnapshot(filename));
+
+    /* Damage inside the slots or keys only shows up when a lookup reads it. */
+    auto lookUpAll = [&]() {
+        RobinHoodSnapshot damaged(filename);
+        for (int i = 0; i < 50; i++) {
+            damaged.contains(to_string(i));
+        }
+    };
+    using Slot = RobinHoodSnapshot::Slot;
+    string badOffset = contents;
+    for (size_t at = sizeof(RobinHoodSnapshot::Header); ; at += sizeof(Slot)) {
+        Slot slot;
+        memcpy(&slot, badOffset.data() + at, sizeof(Slot));
+        if (slot.distance != RobinHoodSnapshot::EMPTY_SLOT) {
+            slot.keyOffset = contents.size();
+            memcpy(&badOffset[at], &slot, sizeof(Slot));
+            break;
+        }
+    }
+    rewrite(badOffset);
+    EXPECT_ERROR(lookUpAll());
+
+    string badLength = contents;
+    uint64_t keysOffset;
+    memcpy(&keysOffset, contents.data() + offsetof(RobinHoodSnapshot::Header, keysOffset), sizeof(keysOffset));
+    uint32_t length = 0xFFFFFFF0;
+    memcpy(&badLength[keysOffset], &length, sizeof(length));
+    rewrite(badLength);
+    EXPECT_ERROR(lookUpAll());
+
+    rewrite(contents);
+    RobinHoodSnapshot snapshot(filename);
+    EXPECT_EQUAL(snapshot.size(), 50);
+    for (int i = 0; i < 50; i++) {
+        EXPECT(snapshot.contains(to_string(i)));
+    }
+    remove(filename.c_str());
+}
+
+STUDENT_TEST("Opening a snapshot versus rebuilding the table by inserting every key.") {
+    const string filename = "robinhood-snapshot-test.rhs";
+    const int kElems = 1 << 20;
+    Vector<string> keys;
+    for (int i = 0; i < kElems; i++) {
+        keys += "https://example.com/item/" + to_string(i);
+    }
+    auto buildTable = [&](RobinHoodHashTable& table) {
+        for (const string& key: keys) table.insert(key);
+    };
+    RobinHoodHashTable table(Hash::random(kElems * 5 / 4));
+    TIME_OPERATION(kElems, buildTable(table));
+    TIME_OPERATION(kElems, RobinHoodSnapshot::save(table, filename));
+
+    RobinHoodSnapshot* snapshot = nullptr;
+    TIME_OPERATION(kElems, snapshot = new RobinHoodSnapshot(filename));
+
+    for (int i = kElems - 1; i > 0; i--) {
+        swap(keys[i], keys[randomInteger(0, i)]);
+    }
+    auto findAll = [&](const auto& lookup) {
+        int found = 0;
+        for (const string& key: keys) found += lookup.contains(key);
+        return found;
+    };
+    int found = 0;
+    TIME_OPERATION(kElems, found += findAll(table));
+    TIME_OPERATION(kElems, found += findAll(*snapshot));
+    EXPECT_EQUAL(found, 2 * kElems);
+
+    delete snapshot;
+    remove(filename.c_str());
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "RobinHoodHashTable.h"
+#include "Demos/Utility.h"
+#include "GUI/SimpleTest.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * A read-only Robin Hood hash table stored as a flat file image, so that it can be
+ * memory-mapped and queried as is. Opening one doesn't rehash or copy anything: it maps
+ * the file, checks the header, and is ready for lookups, however many keys there are.
+ * The operating system pages the image in as lookups touch it.
+ *
+ * The image is a header, then the slot array, then the keys, each as a four-byte length
+ * and its characters. Each slot holds its element's distance from home, 32 bits of the
+ * element's hash, and the offset of its key. HashFunctions can't be written to disk, so
+ * the image uses its own hash, mumHash with a seed recorded in the header, and lays the
+ * elements out afresh when it is saved.
+ *
+ * Images are in the byte order of the machine that wrote them; opening one written with
+ * the other byte order, or with a different version of this format, is an error.
+ */
+class RobinHoodSnapshot {
+public:
+    /**
+     * Writes every element of the table to the named file as a snapshot image, replacing
+     * anything already there. Reports an error if the file can't be written.
+     */
+    static void save(const RobinHoodHashTable& table, const std::string& filename,
+                     std::uint64_t seed = kDefaultSeed);
+
+    /**
+     * Opens a snapshot image, memory-mapping it where the system allows and reading it
+     * into memory in one piece where it doesn't. Reports an error if the file can't be
+     * opened or isn't a snapshot image of this version.
+     */
+    explicit RobinHoodSnapshot(const std::string& filename);
+
+    /**
+     * Unmaps the image.
+     */
+    ~RobinHoodSnapshot();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Returns whether the key was in the table the snapshot was taken of. Opening an
+     * image only checks its header, so this reports an error if it comes across a key
+     * that lies outside the image.
+     */
+    bool contains(std::string_view key) const;
+
+    /* The version written into new images; images of any other version are rejected. */
+    static const std::uint32_t kVersion = 1;
+
+    static const std::uint64_t kDefaultSeed = 0x5EED5EED5EED5EED;
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t byteOrder;   // kByteOrderMark, as the writer stored it.
+        std::uint64_t seed;
+        std::uint64_t numSlots;    // Always a power of two.
+        std::uint64_t numElements;
+        std::uint64_t slotsOffset;
+        std::uint64_t keysOffset;
+        std::uint64_t fileSize;
+    };
+
+    struct Slot {
+        std::int32_t distance;     // EMPTY_SLOT if the slot is empty.
+        std::uint32_t fingerprint; // The low 32 bits of the element's hash.
+        std::uint64_t keyOffset;   // From the start of the keys.
+    };
+
+    static const std::int32_t EMPTY_SLOT = -1;
+    static const std::uint32_t kByteOrderMark = 0x01020304;
+    static constexpr char kMagic[8] = { 'R', 'H', 'S', 'N', 'A', 'P', '\r', '\n' };
+
+    /* Images are made at most this full. */
+    static constexpr double kMaxLoadFactor = 0.8;
+
+    const char* image = nullptr;
+    std::size_t imageSize = 0;
+    bool isMapped = false;
+
+    const Header* header = nullptr;
+    const Slot* slots = nullptr;
+    const char* keys = nullptr;
+    int shift = 0;
+
+    /* Where a hash's home slot is in a table of 2^(64 - shift) slots. */
+    static std::uint64_t homeOf(std::uint64_t hash, int shift);
+
+    /* The key stored at the given offset into the keys. */
+    std::string_view keyAt(std::uint64_t offset) const;
+
+    /* Unmaps or frees the image. */
+    void release();
+
+    /* Checks that the header describes an image that fits in the file. */
+    void checkHeader(const std::string& filename) const;
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(RobinHoodSnapshot);
+    ALLOW_TEST_ACCESS();
+};
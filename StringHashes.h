@@ -0,0 +1,53 @@
+#pragma once
+
+#include "HashFunction.h"
+#include "GUI/SimpleTest.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Fast, well-known string hashes, for trying in the hash tables in place of Hash::random.
+ * Each one maps a key to 64 bits; hashFunctionFrom turns any of them into a
+ * HashFunction<std::string> with a given number of slots.
+ */
+
+/**
+ * 64-bit FNV-1a: one xor and one multiply per byte. Tiny and simple, but slow on long
+ * keys, and its low bits mix poorly.
+ */
+std::uint64_t fnv1a(std::string_view key);
+
+/**
+ * XXH64, the 64-bit xxHash, which works through long keys 32 bytes at a time in four
+ * independent lanes.
+ */
+std::uint64_t xxHash64(std::string_view key, std::uint64_t seed = 0);
+
+/**
+ * A hash in the style of wyhash: every sixteen bytes are folded in with a single 64-by-64
+ * bit multiply, keeping both halves of the 128-bit product. Short keys take one multiply
+ * and no loop at all.
+ */
+std::uint64_t mumHash(std::string_view key, std::uint64_t seed = 0);
+
+/**
+ * CRC-32C (the Castagnoli polynomial), using the SSE4.2 crc32 instruction when the
+ * processor has it and a lookup table otherwise. The result fits in 32 bits.
+ */
+std::uint64_t crc32c(std::string_view key);
+
+/**
+ * Whether crc32c gets to use the SSE4.2 instruction on this machine.
+ */
+bool hasHardwareCrc32();
+
+/**
+ * Makes a hash function with the given number of slots out of a 64-bit hash. The hash is
+ * run through a finalizer first, and the slot is then picked by multiplying its high
+ * bits rather than by taking a remainder, which is faster. The finalizer matters for
+ * weak hashes: the multiply reads only the top bits, so without it FNV-1a put
+ * "key0" through "key65535" into 1024 slots with a chi-squared of 65 times the ideal.
+ */
+using StringHasher = std::uint64_t (*)(std::string_view key);
+HashFunction<std::string> hashFunctionFrom(int numSlots, StringHasher hasher);
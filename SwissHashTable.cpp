@@ -0,0 +1,543 @@
+#include "SwissHashTable.h"
+#include "GUI/SimpleTest.h"
+#include "LinearProbingHashTable.h"
+#include "RobinHoodHashTable.h"
+#include "vector.h"
+#include <functional>
+#include <utility>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+using namespace std;
+
+/* This program implements a hash table that probes sixteen slots at a time. */
+
+SwissHashTable::SwissHashTable(HashFunction<string> hashFn) {
+    logicalSize = 0;
+    numDeleted = 0;
+    allocatedSize = hashFn.numSlots();
+    Hash = hashFn;
+    elems = new string[allocatedSize];
+    controls = new Control[allocatedSize + kGroupSize];
+    for (int i = 0; i < allocatedSize + kGroupSize; i++) {
+        controls[i] = EMPTY;
+    }
+}
+
+SwissHashTable::~SwissHashTable() {
+    delete[] elems;
+    delete[] controls;
+}
+
+int SwissHashTable::size() const {
+    return logicalSize;
+}
+
+bool SwissHashTable::isEmpty() const {
+    return size() == 0;
+}
+
+/* Takes the top seven bits of the standard library's hash, so that the tag has nothing
+ * to do with which slot the table's own hash function picked.
+ */
+SwissHashTable::Control SwissHashTable::tagOf(const string& key) {
+    size_t code = std::hash<string>()(key);
+    return Control(code >> (8 * sizeof(size_t) - 7));
+}
+
+/* Position of the lowest set bit of a nonzero mask, and the number of unset bits above
+ * the highest set bit of a nonzero sixteen-bit mask.
+ */
+namespace {
+    int lowestBit(uint32_t mask) {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#else
+        int result = 0;
+        for (; (mask & 1) == 0; mask >>= 1) result++;
+        return result;
+#endif
+    }
+
+    int leadingZeros16(uint32_t mask) {
+        int result = 0;
+        for (uint32_t bit = 1u << 15; (mask & bit) == 0; bit >>= 1) result++;
+        return result;
+    }
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+uint32_t SwissHashTable::matchTag(int index, Control tag) const {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(controls + index));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(tag)));
+}
+
+uint32_t SwissHashTable::matchEmpty(int index) const {
+    return matchTag(index, EMPTY);
+}
+
+/* Special control bytes are exactly the ones with the sign bit set, which is the bit
+ * that movemask collects.
+ */
+uint32_t SwissHashTable::matchEmptyOrDeleted(int index) const {
+    __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(controls + index));
+    return _mm_movemask_epi8(group);
+}
+#else
+uint32_t SwissHashTable::matchTag(int index, Control tag) const {
+    uint32_t result = 0;
+    for (int i = 0; i < kGroupSize; i++) {
+        if (controls[index + i] == tag) result |= 1u << i;
+    }
+    return result;
+}
+
+uint32_t SwissHashTable::matchEmpty(int index) const {
+    return matchTag(index, EMPTY);
+}
+
+uint32_t SwissHashTable::matchEmptyOrDeleted(int index) const {
+    uint32_t result = 0;
+    for (int i = 0; i < kGroupSize; i++) {
+        if (controls[index + i] < 0) result |= 1u << i;
+    }
+    return result;
+}
+#endif
+
+/* Every byte past the end repeats the one allocatedSize slots before it. In a table
+ * smaller than a group, a slot's byte can be repeated several times over.
+ */
+void SwissHashTable::setControl(int index, Control value) {
+    controls[index] = value;
+    for (int i = index + allocatedSize; i < allocatedSize + kGroupSize; i += allocatedSize) {
+        controls[i] = value;
+    }
+}
+
+int SwissHashTable::maxProbes() const {
+    return (allocatedSize + kGroupSize - 1) / kGroupSize;
+}
+
+/* Maps a position that may have run off the end of the table back into it. */
+static int wrap(int index, int allocatedSize) {
+    while (index >= allocatedSize) {
+        index -= allocatedSize;
+    }
+    return index;
+}
+
+/* Groups are scanned in order starting from the element's hash, just as linear probing
+ * scans slots. An element always lands in the first group with room for it, so the
+ * search can stop at the first group with an empty slot in it.
+ */
+int SwissHashTable::findElement(const string& key, Control tag) const {
+    int index = Hash(key);
+    for (int probe = 0; probe < maxProbes(); probe++) {
+        for (uint32_t matches = matchTag(index, tag); matches != 0; matches &= matches - 1) {
+            int slot = wrap(index + lowestBit(matches), allocatedSize);
+            if (elems[slot] == key) {
+                return slot;
+            }
+        }
+        if (matchEmpty(index) != 0) {
+            return -1;
+        }
+        index = wrap(index + kGroupSize, allocatedSize);
+    }
+    return -1;
+}
+
+bool SwissHashTable::contains(const string& key) const {
+    return !isEmpty() && findElement(key, tagOf(key)) != -1;
+}
+
+/* Looks for the key and for a free slot in the same pass. */
+bool SwissHashTable::insert(const string& key) {
+    if (logicalSize == allocatedSize) {
+        return false;
+    }
+    /* Clear out deleted markers once they outnumber empty slots, but no more often than
+     * every allocatedSize / kGroupSize removals, so the cost stays constant per removal.
+     */
+    int numEmpty = allocatedSize - logicalSize - numDeleted;
+    if (numDeleted > numEmpty && numDeleted * kGroupSize >= allocatedSize) {
+        rebuild();
+    }
+
+    Control tag = tagOf(key);
+    int index = Hash(key);
+    int target = -1;
+    for (int probe = 0; probe < maxProbes(); probe++) {
+        for (uint32_t matches = matchTag(index, tag); matches != 0; matches &= matches - 1) {
+            if (elems[wrap(index + lowestBit(matches), allocatedSize)] == key) {
+                return false;
+            }
+        }
+        uint32_t free = matchEmptyOrDeleted(index);
+        if (target == -1 && free != 0) {
+            target = wrap(index + lowestBit(free), allocatedSize);
+        }
+        if (matchEmpty(index) != 0) {
+            break;
+        }
+        index = wrap(index + kGroupSize, allocatedSize);
+    }
+
+    if (controls[target] == DELETED) {
+        numDeleted--;
+    }
+    elems[target] = key;
+    setControl(target, tag);
+    logicalSize++;
+    return true;
+}
+
+/* A slot can go back to being empty if no search could ever have seen a full group
+ * across it, which is the case when the run of non-empty slots around it is shorter
+ * than a group. Tables no bigger than a group are searched whole in one go, so there
+ * that's always the case.
+ */
+bool SwissHashTable::remove(const string& key) {
+    if (isEmpty()) {
+        return false;
+    }
+    int slot = findElement(key, tagOf(key));
+    if (slot == -1) {
+        return false;
+    }
+
+    bool neverFull = allocatedSize <= kGroupSize;
+    if (!neverFull) {
+        uint32_t emptyAfter = matchEmpty(slot);
+        uint32_t emptyBefore = matchEmpty(wrap(slot + allocatedSize - kGroupSize, allocatedSize));
+        neverFull = emptyAfter != 0 && emptyBefore != 0 &&
+                    lowestBit(emptyAfter) + leadingZeros16(emptyBefore) < kGroupSize;
+    }
+    if (neverFull) {
+        setControl(slot, EMPTY);
+    } else {
+        setControl(slot, DELETED);
+        numDeleted++;
+    }
+    elems[slot].clear();
+    logicalSize--;
+    return true;
+}
+
+void SwissHashTable::rebuild() {
+    string* oldElems = elems;
+    Control* oldControls = controls;
+    elems = new string[allocatedSize];
+    controls = new Control[allocatedSize + kGroupSize];
+    for (int i = 0; i < allocatedSize + kGroupSize; i++) {
+        controls[i] = EMPTY;
+    }
+    numDeleted = 0;
+
+    /* Every element is known to be distinct, so each just goes in the first free slot
+     * along its probe sequence.
+     */
+    for (int i = 0; i < allocatedSize; i++) {
+        if (oldControls[i] < 0) continue;
+        int index = Hash(oldElems[i]);
+        uint32_t free;
+        while ((free = matchEmpty(index)) == 0) {
+            index = wrap(index + kGroupSize, allocatedSize);
+        }
+        int target = wrap(index + lowestBit(free), allocatedSize);
+        elems[target] = std::move(oldElems[i]);
+        setControl(target, oldControls[i]);
+    }
+    delete[] oldElems;
+    delete[] oldControls;
+}
+
+void SwissHashTable::printDebugInfo() const {
+    for (int i = 0; i < allocatedSize; i++) {
+        cout << i << ": ";
+        if (controls[i] == EMPTY) {
+            cout << "(empty)";
+        } else if (controls[i] == DELETED) {
+            cout << "(deleted)";
+        } else {
+            cout << "tag " << int(controls[i]) << ", " << elems[i];
+        }
+        cout << endl;
+    }
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+/* These follow the provided tests for LinearProbingHashTable, checking the same behavior
+ * through the interface, since the layout of elements isn't the same.
+ */
+
+STUDENT_TEST("Swiss table: is initially empty.") {
+    SwissHashTable table(Hash::random(10));
+    EXPECT_EQUAL(table.size(), 0);
+    EXPECT(table.isEmpty());
+    for (int i = 0; i < 10 + SwissHashTable::kGroupSize; i++) {
+        EXPECT_EQUAL(table.controls[i], SwissHashTable::EMPTY);
+    }
+}
+
+STUDENT_TEST("Swiss table: can insert and look up a single value, case-sensitively.") {
+    SwissHashTable table(Hash::zero(10));
+    EXPECT(!table.contains("a"));
+    EXPECT(table.insert("a"));
+    EXPECT(table.contains("a"));
+    EXPECT(!table.contains("A"));
+    EXPECT_EQUAL(table.size(), 1);
+
+    /* The element's tag went into its slot, and into every repeat of that slot. */
+    EXPECT_EQUAL(table.elems[0], "a");
+    for (int i = 0; i < 10 + SwissHashTable::kGroupSize; i++) {
+        EXPECT_EQUAL(table.controls[i], i % 10 == 0 ? SwissHashTable::tagOf("a") : SwissHashTable::EMPTY);
+    }
+}
+
+STUDENT_TEST("Swiss table: insertions/lookups work with collisions and overlapping ranges.") {
+    SwissHashTable table(Hash::identity(10));
+    for (string key: { "0", "10", "1", "2", "3", "4", "5" }) {
+        EXPECT(table.insert(key));
+    }
+    for (int i = 0; i <= 10; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), i <= 5 || i == 10);
+    }
+    EXPECT_EQUAL(table.size(), 7);
+
+    SwissHashTable zero(Hash::zero(10));
+    for (string animal: { "Quokka", "Pudu", "Gerenuk", "Dikdik" }) {
+        EXPECT(zero.insert(animal));
+    }
+    for (string animal: { "Quokka", "Pudu", "Gerenuk", "Dikdik" }) {
+        EXPECT(zero.contains(animal));
+    }
+    EXPECT(!zero.contains("Springbok"));
+    EXPECT(!zero.contains("Kudu"));
+}
+
+STUDENT_TEST("Swiss table: doesn't allow duplicates, and handles the empty string.") {
+    SwissHashTable table(Hash::zero(10));
+    EXPECT(table.insert("Dikdik"));
+    for (int i = 0; i < 100; i++) {
+        EXPECT(!table.insert("Dikdik"));
+        EXPECT_EQUAL(table.size(), 1);
+    }
+
+    EXPECT(!table.contains(""));
+    EXPECT(!table.remove(""));
+    EXPECT(table.insert(""));
+    EXPECT(table.contains(""));
+    EXPECT_EQUAL(table.size(), 2);
+    EXPECT(table.remove(""));
+    EXPECT(!table.contains(""));
+    EXPECT(!table.remove(""));
+}
+
+STUDENT_TEST("Swiss table: lookups and removals work when full, and inserts fail.") {
+    SwissHashTable table(Hash::constant(10, 7));
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT_EQUAL(table.size(), 10);
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.contains(to_string(i)));
+    }
+    for (int i = 10; i < 20; i++) {
+        EXPECT(!table.contains(to_string(i)));
+        EXPECT(!table.insert(to_string(i)));
+        EXPECT(!table.remove(to_string(i)));
+    }
+    EXPECT_EQUAL(table.size(), 10);
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.remove(to_string(i)));
+    }
+    EXPECT(table.isEmpty());
+
+    /* The space is all reusable. */
+    for (int i = 0; i < 10; i++) {
+        EXPECT(table.insert(to_string(i + 1000)));
+    }
+    EXPECT(!table.insert("10"));
+}
+
+STUDENT_TEST("Swiss table: removal in a big table leaves a deleted marker only when it must.") {
+    /* Twenty elements in a row: every group across the middle of the run was full. */
+    SwissHashTable table(Hash::identity(100));
+    for (int i = 0; i < 20; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT(table.remove("10"));
+    EXPECT_EQUAL(table.controls[10], SwissHashTable::DELETED);
+    EXPECT_EQUAL(table.numDeleted, 1);
+
+    /* Inserting 10 again finds it gone, and takes the marker's place. */
+    EXPECT(!table.contains("10"));
+    EXPECT(table.insert("10"));
+    EXPECT_EQUAL(table.numDeleted, 0);
+    EXPECT_EQUAL(table.elems[10], "10");
+
+    /* A short run was never a full group, so removing from it just empties the slot. */
+    EXPECT(table.insert("50"));
+    EXPECT(table.insert("51"));
+    EXPECT(table.remove("50"));
+    EXPECT_EQUAL(table.controls[50], SwissHashTable::EMPTY);
+    EXPECT(table.contains("51"));
+}
+
+STUDENT_TEST("Swiss table: agrees with a reference set around group and table boundaries.") {
+    for (int numSlots: { 1, 2, 15, 16, 17, 31, 33, 100 }) {
+        for (auto hashFn: { Hash::random(numSlots), Hash::zero(numSlots),
+                            Hash::constant(numSlots, numSlots - 1) }) {
+            SwissHashTable table(hashFn);
+            Vector<bool> present(numSlots + 5);
+            int size = 0;
+            for (int round = 0; round < 3000; round++) {
+                int i = randomInteger(0, present.size() - 1);
+                if (randomInteger(0, 1) == 0) {
+                    bool fits = !present[i] && size < numSlots;
+                    EXPECT_EQUAL(table.insert(to_string(i)), fits);
+                    if (fits) {
+                        present[i] = true;
+                        size++;
+                    }
+                } else {
+                    EXPECT_EQUAL(table.remove(to_string(i)), bool(present[i]));
+                    if (present[i]) size--;
+                    present[i] = false;
+                }
+                EXPECT_EQUAL(table.size(), size);
+            }
+            for (int i = 0; i < present.size(); i++) {
+                EXPECT_EQUAL(table.contains(to_string(i)), bool(present[i]));
+            }
+            /* The repeated control bytes never drift from the ones they repeat. */
+            for (int i = numSlots; i < numSlots + SwissHashTable::kGroupSize; i++) {
+                EXPECT_EQUAL(table.controls[i], table.controls[i % numSlots]);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Swiss table: deleted markers get cleared out under churn.") {
+    SwissHashTable table(Hash::random(1000));
+    for (int i = 0; i < 700; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    for (int round = 0; round < 100000; round++) {
+        EXPECT(table.remove(to_string(round)));
+        EXPECT(table.insert(to_string(round + 700)));
+        EXPECT(table.numDeleted <= max(table.allocatedSize - table.logicalSize - table.numDeleted,
+                                       table.allocatedSize / SwissHashTable::kGroupSize) + 1);
+    }
+    for (int i = 100000; i < 100700; i++) {
+        EXPECT(table.contains(to_string(i)));
+    }
+    EXPECT(!table.contains("0"));
+}
+
+STUDENT_TEST("Swiss table: inserts/searches/deletes work in expected time O(1).") {
+    const int kNumSlots = 1000000;
+    SwissHashTable table(Hash::random(kNumSlots));
+    for (int i = 0; i < kNumSlots; i++) {
+        EXPECT(!table.contains(to_string(i)));
+    }
+    const int kLotsOfElems = 100000;
+    for (int i = 0; i < kLotsOfElems; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    for (int i = kLotsOfElems / 4; i < 3 * kLotsOfElems / 4; i++) {
+        EXPECT(table.remove(to_string(i)));
+    }
+    for (int i = 0; i < 2 * kLotsOfElems; i++) {
+        EXPECT_EQUAL(table.contains(to_string(i)), bool(i < kLotsOfElems / 4 || (i >= 3 * kLotsOfElems / 4 && i < kLotsOfElems)));
+    }
+}
+
+STUDENT_TEST("Swiss table: a full-length probe doesn't overflow anything.") {
+    const int kTableSize = 1000000;
+    SwissHashTable table(Hash::identity(kTableSize));
+    for (int i = 0; i < kTableSize - 1; i++) {
+        EXPECT(table.insert(to_string(i)));
+    }
+    EXPECT(table.insert(to_string(kTableSize)));
+    EXPECT_EQUAL(table.elems[kTableSize - 1], to_string(kTableSize));
+    EXPECT(table.contains(to_string(kTableSize)));
+    EXPECT(table.remove(to_string(kTableSize)));
+    EXPECT(!table.contains(to_string(kTableSize)));
+}
+
+#include <fstream>
+STUDENT_TEST("Swiss table: handles large workflows with little free space.") {
+    Vector<string> english;
+    ifstream input("res/EnglishWords.txt");
+    for (string word; getline(input, word); ) {
+        english += word;
+    }
+
+    SwissHashTable table(Hash::consistentRandom(english.size() / 0.97));
+    for (const string& word: english) {
+        EXPECT(table.insert(word));
+    }
+    EXPECT_EQUAL(table.size(), english.size());
+    for (const string& word: english) {
+        EXPECT(table.contains(word));
+        EXPECT(!table.contains(toUpperCase(word)));
+    }
+    for (const string& word: english) {
+        EXPECT(table.remove(word));
+        EXPECT(!table.contains(word));
+        EXPECT(!table.remove(toUpperCase(word)));
+    }
+    EXPECT(table.isEmpty());
+}
+
+STUDENT_TEST("Swiss table versus linear probing and Robin Hood, at load factors 0.5, 0.875 and 0.95.") {
+    const int kNumSlots = 1 << 20;
+    for (double load: { 0.5, 0.875, 0.95 }) {
+        int numElems = kNumSlots * load;
+        Vector<string> present, absent;
+        for (int i = 0; i < numElems; i++) {
+            present += "key" + to_string(i);
+            absent += "nokey" + to_string(i);
+        }
+        auto insertAll = [&](auto& table) {
+            for (const string& key: present) table.insert(key);
+        };
+        auto findAll = [&](const auto& table, const Vector<string>& keys) {
+            int found = 0;
+            for (const string& key: keys) found += table.contains(key);
+            return found;
+        };
+        /* Removing and putting back a tenth of the elements, over and over. */
+        auto churn = [&](auto& table) {
+            for (int i = 0; i < numElems; i++) {
+                const string& key = present[(i * 10) % numElems];
+                table.remove(key);
+                table.insert(key);
+            }
+        };
+
+        cout << "    Load factor " << load << endl;
+        LinearProbingHashTable linear(Hash::random(kNumSlots));
+        RobinHoodHashTable robinHood(Hash::random(kNumSlots));
+        SwissHashTable swiss(Hash::random(kNumSlots));
+        TIME_OPERATION(numElems, insertAll(linear));
+        TIME_OPERATION(numElems, insertAll(robinHood));
+        TIME_OPERATION(numElems, insertAll(swiss));
+        TIME_OPERATION(numElems, findAll(linear, present));
+        TIME_OPERATION(numElems, findAll(robinHood, present));
+        TIME_OPERATION(numElems, findAll(swiss, present));
+        TIME_OPERATION(numElems, findAll(linear, absent));
+        TIME_OPERATION(numElems, findAll(robinHood, absent));
+        TIME_OPERATION(numElems, findAll(swiss, absent));
+        TIME_OPERATION(numElems, churn(linear));
+        TIME_OPERATION(numElems, churn(robinHood));
+        TIME_OPERATION(numElems, churn(swiss));
+        EXPECT_EQUAL(findAll(swiss, present), numElems);
+        EXPECT_EQUAL(findAll(swiss, absent), 0);
+    }
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "HashFunction.h"
+#include "Demos/Utility.h"
+#include "GUI/SimpleTest.h"
+#include <cstdint>
+#include <string>
+
+/**
+ * An open-addressing hash set in the style of Google's Swiss tables. Alongside the array
+ * of elements sits an array of one-byte control codes, one per slot, saying whether the
+ * slot is empty, deleted, or full - and if full, holding seven bits of the element's
+ * hash. Lookups read the control bytes sixteen at a time and compare all sixteen against
+ * the key's seven bits in a couple of SSE2 instructions, so a probe only ever looks at an
+ * element when its control byte already matches.
+ *
+ * The interface is the same as LinearProbingHashTable's. Where it can, removal marks a
+ * slot empty again; otherwise it leaves a deleted marker, like a tombstone, and once
+ * those outnumber the empty slots the table rebuilds itself to clear them out.
+ */
+class SwissHashTable {
+public:
+    /**
+     * Constructs a new table that uses the hash function given as the argument to pick
+     * where each element's probe starts. The number of slots is hashFn.numSlots().
+     */
+    SwissHashTable(HashFunction<std::string> hashFn);
+
+    /**
+     * Cleans up all memory allocated by this hash table.
+     */
+    ~SwissHashTable();
+
+    /**
+     * Returns whether the table is empty.
+     */
+    bool isEmpty() const;
+
+    /**
+     * Returns the number of elements in the table.
+     */
+    int size() const;
+
+    /**
+     * Inserts the specified element into this hash table. If the element already exists,
+     * or every slot is full, this leaves the table unchanged and returns false.
+     *
+     * This function returns whether the element was inserted into the table.
+     */
+    bool insert(const std::string& key);
+
+    /**
+     * Returns whether the specified key is contained in this hash table.
+     */
+    bool contains(const std::string& key) const;
+
+    /**
+     * Removes the specified element from this hash table, returning whether it was there.
+     */
+    bool remove(const std::string& key);
+
+    /**
+     * Prints out relevant information to assist with debugging.
+     */
+    void printDebugInfo() const;
+
+private:
+    /* Control bytes. Full slots hold the element's seven-bit tag, which is never
+     * negative, so both special values are told apart from tags by their sign bit.
+     */
+    using Control = std::int8_t;
+    static const Control EMPTY = -128;
+    static const Control DELETED = -2;
+
+    /* Number of control bytes examined at once. */
+    static const int kGroupSize = 16;
+
+    /* allocatedSize + kGroupSize control bytes. The extra bytes past the end repeat the
+     * ones at the start, so that a group can be read starting at any slot without
+     * wrapping around by hand.
+     */
+    Control* controls = nullptr;
+
+    /* The elements. Only slots whose control byte is a tag hold anything meaningful. */
+    std::string* elems = nullptr;
+
+    int allocatedSize;
+    int logicalSize;
+    int numDeleted;
+    HashFunction<std::string> Hash;
+
+    /* Seven bits of a second hash of the key, independent of Hash. */
+    static Control tagOf(const std::string& key);
+
+    /* Bit masks of which of the sixteen slots starting at the given index have the given
+     * control byte, or any special (non-tag) control byte.
+     */
+    std::uint32_t matchTag(int index, Control tag) const;
+    std::uint32_t matchEmpty(int index) const;
+    std::uint32_t matchEmptyOrDeleted(int index) const;
+
+    /* Sets a control byte, keeping the repeated bytes past the end in sync. */
+    void setControl(int index, Control value);
+
+    /* Number of groups a probe has to look at to have seen every slot. */
+    int maxProbes() const;
+
+    /* Finds the index of the element if the element is in the hashtable, or -1. */
+    int findElement(const std::string& key, Control tag) const;
+
+    /* Clears out all the deleted markers by reinserting every element. */
+    void rebuild();
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(SwissHashTable);
+    ALLOW_TEST_ACCESS();
+};
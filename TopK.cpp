@@ -1,29 +1,508 @@
 #include "GUI/SimpleTest.h"
 #include "TopK.h"
 #include "HeapPQueue.h"
+#include <charconv>
+#include <climits>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 /*  This program returns a collection of k elements from a given data stream
  *  that have the highest weight,and sorts the elements in descending order of weight.
  */
 
+namespace {
+    /* A data point tagged with where it appeared in the stream. Ties in weight go to the
+     * earlier data point, which gives the sequential and parallel versions of topK one
+     * well-defined answer to agree on.
+     */
+    struct RankedPoint {
+        DataPoint point;
+        long long position;
+    };
+
+    /* Ranks by weight, then by earliness, so the front of the heap is the lightest and,
+     * among equal weights, the latest data point kept so far: the first one to evict.
+     */
+    struct RankOf {
+        pair<decltype(DataPoint::weight), long long> operator() (const RankedPoint& ranked) const {
+            return { ranked.point.weight, -ranked.position };
+        }
+    };
+
+    using RankedHeap = HeapPQueue<RankedPoint, less<>, 2, RankOf>;
+
+    /* Empties the heap, returning its data points from highest to lowest rank. */
+    Vector<DataPoint> inDescendingOrder(RankedHeap& pq) {
+        Vector<DataPoint> result;
+        while (!pq.isEmpty()) {
+            result += pq.dequeue().point;
+        }
+        /* Turn the result from ascending to descending order. */
+        result.reverse();
+        return result;
+    }
+}
+
 Vector<DataPoint> topK(istream& stream, int k) {
-    HeapPQueue pq;
-    Vector<DataPoint> result;
-    for (DataPoint data; stream >> data;) {
-        pq.enqueue(data);
-        if (pq.size() > k ) {
-            pq.dequeue();
+    RankedHeap pq;
+    /* Once the heap holds k elements, each new element costs one comparison against
+     * the lowest rank kept so far, plus a single sift-down if it beats it. Offering by
+     * reference means rejected data points are never copied.
+     */
+    for (RankedPoint ranked = { {}, 0 }; stream >> ranked.point; ranked.position++) {
+        pq.offer(ranked, k);
+    }
+    return inDescendingOrder(pq);
+}
+
+namespace {
+    /* Number of bytes of the stream each worker thread claims at a time. */
+    const int kChunkSize = 1 << 22;
+
+    /* Reads roughly chunkSize bytes from the stream into chunk, extended to the end of the
+     * line it stops in. Returns whether there was anything left to read.
+     */
+    bool readChunk(istream& stream, string& chunk, int chunkSize) {
+        chunk.resize(chunkSize);
+        stream.read(&chunk[0], chunkSize);
+        chunk.resize(stream.gcount());
+        string rest;
+        if (getline(stream, rest)) {
+            chunk += rest;
+            chunk += '\n';
+        }
+        return !chunk.empty();
+    }
+
+    /* How far parseChunk got through its text. */
+    struct ChunkParse {
+        bool clean;             // Every data point in the text was read.
+        bool ranOut;            // If not, whether the text ended partway through one.
+        size_t tailStart;       // Offset of the first data point that wasn't read.
+        long long tailPosition; // Position that data point would have had.
+    };
+
+    /* Offers each data point of the text to the heap, numbering them from the given
+     * position, until the text ends or a data point can't be read.
+     */
+    ChunkParse parseChunk(const string& text, long long position, int k, RankedHeap& pq) {
+        istringstream records(text);
+        RankedPoint ranked = { {}, position };
+        while (true) {
+            if ((records >> ws).eof()) {
+                return { true, false, text.size(), ranked.position };
+            }
+            size_t start = size_t(records.tellg());
+            if (!(records >> ranked.point)) {
+                return { false, bool(records.eof()), start, ranked.position };
+            }
+            pq.offer(ranked, k);
+            ranked.position++;
+        }
+    }
+
+    /* Parses the text and then the rest of the stream in order, the way sequential topK
+     * does, stopping at the first data point that can't be read. A data point the text
+     * ends partway through is read again once more of the stream is appended; at least
+     * as much is read as is already pending, so a huge data point isn't reparsed over
+     * and over.
+     */
+    void parseInOrder(string text, istream& stream, long long position, int k,
+                      int chunkSize, RankedHeap& pq) {
+        string more;
+        while (true) {
+            ChunkParse parse = parseChunk(text, position, k, pq);
+            if (!parse.clean && !parse.ranOut) return;
+            text.erase(0, parse.tailStart);
+            int wanted = int(min<size_t>(max<size_t>(chunkSize, text.size()), INT_MAX));
+            if (!readChunk(stream, more, wanted)) return;
+            text += more;
+            position = parse.tailPosition;
+        }
+    }
+
+    /* What the worker threads share. Chunks are claimed in order and split at line breaks,
+     * which are only known to fall between data points once every chunk before them has
+     * parsed cleanly. Until then, the text of each parsed chunk is kept, so that if some
+     * earlier chunk turns out not to be clean, everything from its first unread data point
+     * on can be parsed again in order.
+     */
+    struct SharedStream {
+        explicit SharedStream(istream& stream) : stream(stream) {}
+
+        istream& stream;
+        mutex lock;
+        long long nextChunk = 0;    // Index of the next chunk to claim.
+        long long settled = 0;      // Every chunk before this one parsed cleanly.
+        bool stopped = false;       // Set once any chunk fails to parse cleanly.
+        map<long long, pair<ChunkParse, string>> unsettled;
+    };
+
+    /* Body of each worker thread: repeatedly claims the next chunk of the stream, then
+     * parses it into its own bounded heap without holding the lock. Positions are the
+     * chunk number in the high bits and the index within the chunk in the low bits, which
+     * orders them exactly as the data points appear in the stream. No more chunks are
+     * claimed once one fails to parse, since the rest has to be read in order anyway.
+     */
+    void topKWorker(SharedStream& shared, int k, int chunkSize, RankedHeap& pq) {
+        string chunk;
+        while (true) {
+            long long index;
+            {
+                lock_guard<mutex> guard(shared.lock);
+                if (shared.stopped || !readChunk(shared.stream, chunk, chunkSize)) return;
+                index = shared.nextChunk++;
+            }
+            ChunkParse parse = parseChunk(chunk, index << 32, k, pq);
+
+            lock_guard<mutex> guard(shared.lock);
+            if (!parse.clean) shared.stopped = true;
+            shared.unsettled[index] = { parse, std::move(chunk) };
+            auto next = shared.unsettled.begin();
+            while (next != shared.unsettled.end() && next->first == shared.settled &&
+                   next->second.first.clean) {
+                next = shared.unsettled.erase(next);
+                shared.settled++;
+            }
+        }
+    }
+
+    /* The parallel topK with the chunk size exposed, so tests can force many chunks. */
+    Vector<DataPoint> topKInChunks(istream& stream, int k, int numThreads, int chunkSize) {
+        if (numThreads < 1) {
+            error("topK needs at least one thread.");
+        }
+        /* Standard vectors, since neither heaps nor threads can be copied into a Vector. */
+        vector<RankedHeap> heaps(numThreads);
+        SharedStream shared(stream);
+
+        vector<thread> workers;
+        for (int i = 0; i < numThreads; i++) {
+            workers.emplace_back(topKWorker, ref(shared), k, chunkSize, ref(heaps[i]));
+        }
+        for (auto& worker: workers) {
+            worker.join();
+        }
+
+        /* Every claimed chunk has been parsed, so anything left unsettled starts with a
+         * chunk that didn't parse cleanly. Whatever was read from its first unread data
+         * point on is thrown out, and that part of the stream is read again in order.
+         */
+        long long stopPosition = LLONG_MAX;
+        string rest;
+        if (!shared.unsettled.empty()) {
+            const auto& [parse, text] = shared.unsettled.begin()->second;
+            stopPosition = parse.tailPosition;
+            rest = text.substr(parse.tailStart);
+            for (auto entry = next(shared.unsettled.begin()); entry != shared.unsettled.end(); ++entry) {
+                rest += entry->second.second;
+            }
         }
+
+        /* The overall top k is the top k of the per-thread winners, since every data point
+         * that misses its own thread's cut is outranked by k others.
+         */
+        RankedHeap merged;
+        for (auto& pq: heaps) {
+            while (!pq.isEmpty()) {
+                RankedPoint ranked = pq.dequeue();
+                if (ranked.position < stopPosition) {
+                    merged.offer(std::move(ranked), k);
+                }
+            }
+        }
+        if (stopPosition != LLONG_MAX) {
+            parseInOrder(std::move(rest), stream, stopPosition, k, chunkSize, merged);
+        }
+        return inDescendingOrder(merged);
     }
+}
+
+Vector<DataPoint> topK(istream& stream, int k, int numThreads) {
+    return topKInChunks(stream, k, numThreads, kChunkSize);
+}
+
+
+
+
+
+namespace {
+    /* A data point that still lives in the text it was parsed from. The name is the raw text
+     * between the quotes, so it only needs unescaping if it contains a backslash.
+     */
+    struct PointView {
+        string_view name;
+        bool escaped;
+        decltype(DataPoint::weight) weight;
+        long long position;
+    };
+
+    struct ViewRankOf {
+        pair<decltype(DataPoint::weight), long long> operator() (const PointView& view) const {
+            return { view.weight, -view.position };
+        }
+    };
+
+    using ViewHeap = HeapPQueue<PointView, less<>, 2, ViewRankOf>;
+
+    bool isBlank(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+    }
+
+    void skipBlanks(const char*& next, const char* end) {
+        while (next != end && isBlank(*next)) next++;
+    }
+
+    /* Parses the data point starting at next, if there is one, and moves next past it.
+     * This accepts the shapes DataPoints are written in: an optional pair of braces around
+     * a name and a weight, optionally separated by a comma, where the name is either a
+     * double-quoted string with backslash escapes or a single bare word.
+     */
+    bool readPointView(const char*& next, const char* end, PointView& view) {
+        skipBlanks(next, end);
+        if (next == end) return false;
+
+        bool braced = *next == '{';
+        if (braced) {
+            next++;
+            skipBlanks(next, end);
+        }
+
+        const char* nameStart;
+        view.escaped = false;
+        if (next != end && *next == '"') {
+            nameStart = ++next;
+            while (next != end && *next != '"') {
+                if (*next == '\\') {
+                    view.escaped = true;
+                    if (++next == end) break;
+                }
+                next++;
+            }
+            if (next == end) error("Unterminated name in data point.");
+            view.name = string_view(nameStart, next - nameStart);
+            next++;
+        } else {
+            nameStart = next;
+            while (next != end && !isBlank(*next) && *next != ',') next++;
+            view.name = string_view(nameStart, next - nameStart);
+        }
+
+        skipBlanks(next, end);
+        if (next != end && *next == ',') {
+            next++;
+            skipBlanks(next, end);
+        }
+        auto [afterWeight, status] = from_chars(next, end, view.weight);
+        if (status != errc()) error("Malformed weight in data point.");
+        next = afterWeight;
+
+        if (braced) {
+            skipBlanks(next, end);
+            if (next == end || *next != '}') error("Missing close brace in data point.");
+            next++;
+        }
+        return true;
+    }
+
+    /* Value of ch as a digit in the given base, or -1 if it isn't one. */
+    int digitValue(char ch, int base) {
+        int value = -1;
+        if (ch >= '0' && ch <= '9') value = ch - '0';
+        else if (ch >= 'a' && ch <= 'f') value = ch - 'a' + 10;
+        else if (ch >= 'A' && ch <= 'F') value = ch - 'A' + 10;
+        return value < base ? value : -1;
+    }
+
+    /* Decodes the escape sequence starting at name[i], just after its backslash, and moves
+     * i to the escape's last character. These are the escapes the library's quoted strings
+     * are written with: the C letter escapes, up to three octal digits, or x and up to two
+     * hex digits. Any other character, such as a quote or backslash, stands for itself.
+     */
+    char unescape(string_view name, size_t& i) {
+        char ch = name[i];
+        switch (ch) {
+            case 'a': return '\a';
+            case 'b': return '\b';
+            case 'f': return '\f';
+            case 'n': return '\n';
+            case 'r': return '\r';
+            case 't': return '\t';
+            case 'v': return '\v';
+        }
+
+        int base = 8;
+        size_t next = i;
+        if (ch == 'x') {
+            base = 16;
+            next++;
+        } else if (digitValue(ch, 8) == -1) {
+            return ch;
+        }
+        size_t end = min(name.size(), next + (base == 16 ? 2 : 3));
+        int value = 0;
+        for (; next < end && digitValue(name[next], base) != -1; next++) {
+            value = value * base + digitValue(name[next], base);
+        }
+        i = next - 1;
+        return char(value);
+    }
+
+    /* Turns a view into a real DataPoint, undoing any backslash escapes in its name. */
+    DataPoint materialize(const PointView& view) {
+        if (!view.escaped) {
+            return { string(view.name), view.weight };
+        }
+        string name;
+        for (size_t i = 0; i < view.name.size(); i++) {
+            char ch = view.name[i];
+            if (ch == '\\' && i + 1 < view.name.size()) {
+                ch = unescape(view.name, ++i);
+            }
+            name += ch;
+        }
+        return { name, view.weight };
+    }
+}
+
+Vector<DataPoint> topKFromBuffer(string_view text, int k) {
+    ViewHeap pq;
+    const char* next = text.data();
+    const char* end = next + text.size();
+    /* Views point into text, so nothing is allocated per record; only the winners are
+     * turned into DataPoints, once the whole buffer has been read.
+     */
+    for (PointView view = { {}, false, {}, 0 }; readPointView(next, end, view); view.position++) {
+        pq.offer(view, k);
+    }
+
+    Vector<DataPoint> result;
     while (!pq.isEmpty()) {
-        result += pq.dequeue();
+        result += materialize(pq.dequeue());
     }
     /* Turn the result from ascending to descending order. */
     result.reverse();
     return result;
 }
 
+Vector<DataPoint> topKFromFile(const string& filename, int k) {
+#ifndef _WIN32
+    int file = open(filename.c_str(), O_RDONLY);
+    if (file == -1) error("Could not open file " + filename);
+    struct stat info;
+    if (fstat(file, &info) == -1) {
+        close(file);
+        error("Could not read the size of file " + filename);
+    }
+    if (info.st_size == 0) {
+        close(file);
+        return {};
+    }
+    void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (mapped == MAP_FAILED) error("Could not map file " + filename);
+    madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+
+    /* Unmap whether or not parsing succeeds, since error() throws. */
+    try {
+        auto result = topKFromBuffer(string_view(static_cast<const char*>(mapped), info.st_size), k);
+        munmap(mapped, info.st_size);
+        return result;
+    } catch (...) {
+        munmap(mapped, info.st_size);
+        throw;
+    }
+#else
+    /* No mmap here, so read the whole file into one buffer instead. */
+    ifstream input(filename, ios::binary);
+    if (!input) error("Could not open file " + filename);
+    ostringstream contents;
+    contents << input.rdbuf();
+    return topKFromBuffer(contents.str(), k);
+#endif
+}
+
+
+
+
+
+namespace {
+    /* One Space-Saving counter: a name, the total weight credited to it, and how much of
+     * that total may really belong to the names it evicted.
+     */
+    struct NameCounter {
+        string name;
+        long long estimate;
+        long long error;
+    };
+
+    struct CounterKeyOf {
+        long long operator() (const NameCounter& counter) const {
+            return counter.estimate;
+        }
+        void set(NameCounter& counter, long long estimate) const {
+            counter.estimate = estimate;
+        }
+    };
+}
+
+Vector<HeavyHitter> heavyHitters(istream& stream, int k, int capacity) {
+    if (k < 0 || capacity < k || capacity < 1) {
+        error("Heavy hitters needs 0 <= k <= capacity and at least one counter.");
+    }
+    /* Counters in a min-heap, so the smallest is always ready to be evicted, plus a map
+     * from each monitored name to its counter. Both hold at most capacity entries.
+     */
+    HeapPQueue<NameCounter, less<>, 2, CounterKeyOf> counters;
+    counters.reserve(capacity);
+    unordered_map<string, int> handles;
+    handles.reserve(capacity);
+
+    for (DataPoint data; stream >> data;) {
+        if (data.weight < 0) {
+            error("Heavy hitters can't count negative weights.");
+        }
+        auto known = handles.find(data.name);
+        if (known != handles.end()) {
+            counters.updatePriority(known->second, counters.get(known->second).estimate + data.weight);
+        } else if (counters.size() < capacity) {
+            handles[data.name] = counters.enqueue({ data.name, data.weight, 0 });
+        } else {
+            /* The new name inherits the smallest counter. Everything that counter saw
+             * might have been this name, so its old total becomes the error.
+             */
+            auto evicted = handles.find(counters.peek().name);
+            int handle = evicted->second;
+            handles.erase(evicted);
+            long long floor = counters.peek().estimate;
+            counters.replaceTop({ data.name, floor + data.weight, floor });
+            handles[data.name] = handle;
+        }
+    }
+
+    Vector<HeavyHitter> result;
+    counters.forEach([&](const NameCounter& counter) {
+        result.add({ counter.name, counter.estimate, counter.error });
+    });
+    sort(result.begin(), result.end(), [](const HeavyHitter& lhs, const HeavyHitter& rhs) {
+        return lhs.estimate != rhs.estimate ? lhs.estimate > rhs.estimate : lhs.name < rhs.name;
+    });
+    return result.subList(0, min(k, result.size()));
+}
+
 
 
 
@@ -97,6 +576,298 @@ STUDENT_TEST("Stream many identical elements") {
     EXPECT_EQUAL(topK(stream, 6), expected);
 }
 
+STUDENT_TEST("Ties in weight go to the data point that appears first.") {
+    Vector<DataPoint> vec = {
+        { "a", 3 }, { "b", 5 }, { "c", 3 }, { "d", 5 }, { "e", 3 }, { "f", 1 }
+    };
+    auto stream = asStream(vec);
+    Vector<DataPoint> expected = { vec[1], vec[3], vec[0], vec[2] };
+    EXPECT_EQUAL(topK(stream, 4), expected);
+
+    stream = asStream(vec);
+    EXPECT_EQUAL(topK(stream, 4, 3), expected);
+}
+
+STUDENT_TEST("Parallel topK matches sequential topK, ties included.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 20000; i++) {
+        /* Few distinct weights, so nearly every cut falls in the middle of a tie. */
+        points.add({ "p" + to_string(i), randomInteger(-20, 20) });
+    }
+    for (int k: { 0, 1, 7, 100, 5000, 20000, 25000 }) {
+        auto stream = asStream(points);
+        auto expected = topK(stream, k);
+        for (int numThreads: { 1, 2, 3, 8 }) {
+            /* Small chunks, so every thread sees several of them. */
+            for (int chunkSize: { 1, 100, 4096, 1 << 20 }) {
+                stream = asStream(points);
+                EXPECT_EQUAL(topKInChunks(stream, k, numThreads, chunkSize), expected);
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Parallel topK handles empty streams and rejects zero threads.") {
+    stringstream empty;
+    EXPECT(topK(empty, 10, 4).isEmpty());
+
+    stringstream stream = asStream({ { "", 1 } });
+    EXPECT_ERROR(topK(stream, 1, 0));
+}
+
+STUDENT_TEST("Parallel topK stops where sequential topK does on malformed input.") {
+    /* Some data points span two lines, so chunk boundaries can fall inside them. */
+    string good;
+    for (int i = 0; i < 5000; i++) {
+        good += "\"p" + to_string(i) + "\"" + (i % 7 == 0 ? "\n" : " ");
+        good += to_string(randomInteger(-20, 20)) + "\n";
+    }
+    /* Nothing after a data point that can't be read counts, however heavy. */
+    string heavy = "\"heavy\" 1000\n";
+    Vector<string> texts = {
+        good,
+        good + "\"bad\" oops\n" + heavy + good,
+        good.substr(0, good.size() / 2) + "\"bad\"\n\n" + heavy + good,
+        good + "\"unterminated 7\n" + heavy,
+        "oops\n" + heavy + good,
+    };
+
+    for (const string& text: texts) {
+        for (int k: { 1, 100, 10000 }) {
+            stringstream stream(text);
+            auto expected = topK(stream, k);
+            EXPECT(expected.isEmpty() || expected[0].name != "heavy");
+            for (int numThreads: { 1, 3, 8 }) {
+                for (int chunkSize: { 1, 100, 4096, 1 << 20 }) {
+                    stream = stringstream(text);
+                    EXPECT_EQUAL(topKInChunks(stream, k, numThreads, chunkSize), expected);
+                }
+            }
+        }
+    }
+}
+
+STUDENT_TEST("Parallel topK scaling benchmark, 1 through 8 threads.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 1000000; i++) {
+        points.add({ "point" + to_string(i), randomInteger(0, 1000000000) });
+    }
+    auto text = asStream(points).str();
+
+    auto stream = stringstream(text);
+    Vector<DataPoint> expected;
+    TIME_OPERATION(points.size(), expected = topK(stream, 1000));
+    for (int numThreads = 1; numThreads <= 8; numThreads *= 2) {
+        stream = stringstream(text);
+        Vector<DataPoint> result;
+        TIME_OPERATION(numThreads, result = topK(stream, 1000, numThreads));
+        EXPECT_EQUAL(result, expected);
+    }
+}
+
+STUDENT_TEST("Buffer topK matches stream topK, including awkward names.") {
+    Vector<DataPoint> points = {
+        { "", 4 }, { "two words", 9 }, { "quote\"inside", 9 }, { "back\\slash", -3 },
+        { "tab\there", 12 }, { "plain", 0 }, { "trailing ", 9 }, { "x", -2147483647 }
+    };
+    string text = asStream(points).str();
+    for (int k = 0; k <= points.size() + 1; k++) {
+        stringstream stream(text);
+        EXPECT_EQUAL(topKFromBuffer(text, k), topK(stream, k));
+    }
+}
+
+STUDENT_TEST("Buffer topK decodes every escape that quoted names are written with.") {
+    string text = R"("bell\a" 9 "\b\f\n\r\t\v" 8 "\"quoted\" \\" 7 "\101\7z\0" 6 )"
+                  R"("\1019" 5 "\x41\x7e\xg" 4 "\q" 3 "octal\377" 2)";
+    Vector<DataPoint> expected = {
+        { "bell\a", 9 }, { "\b\f\n\r\t\v", 8 }, { "\"quoted\" \\", 7 },
+        { string("A\7z") + '\0', 6 }, { "A9", 5 }, { string("A~") + '\0' + "g", 4 },
+        { "q", 3 }, { "octal\377", 2 }
+    };
+    EXPECT_EQUAL(topKFromBuffer(text, expected.size()), expected);
+}
+
+STUDENT_TEST("Buffer topK matches stream topK on random points with ties.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 20000; i++) {
+        points.add({ "p" + to_string(i), randomInteger(-50, 50) });
+    }
+    string text = asStream(points).str();
+    for (int k: { 0, 1, 10, 1000, 30000 }) {
+        stringstream stream(text);
+        EXPECT_EQUAL(topKFromBuffer(text, k), topK(stream, k));
+    }
+}
+
+STUDENT_TEST("Buffer topK accepts bare words and reports malformed weights.") {
+    Vector<DataPoint> expected = { { "b", 7 }, { "a", 3 } };
+    EXPECT_EQUAL(topKFromBuffer("a 3\nb 7\nc -1\n", 2), expected);
+    EXPECT_EQUAL(topKFromBuffer("   \n", 2).size(), 0);
+    EXPECT_ERROR(topKFromBuffer("a three\n", 2));
+    EXPECT_ERROR(topKFromBuffer("\"unterminated 3\n", 2));
+}
+
+STUDENT_TEST("File topK maps the file and matches stream topK.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 5000; i++) {
+        points.add({ "point " + to_string(i), randomInteger(0, 100) });
+    }
+    string text = asStream(points).str();
+    const string filename = "topk-file-test.txt";
+    {
+        ofstream output(filename, ios::binary);
+        output << text;
+    }
+    stringstream stream(text);
+    EXPECT_EQUAL(topKFromFile(filename, 50), topK(stream, 50));
+    remove(filename.c_str());
+
+    {
+        ofstream output(filename, ios::binary);
+    }
+    EXPECT_EQUAL(topKFromFile(filename, 50).size(), 0);
+    remove(filename.c_str());
+
+    EXPECT_ERROR(topKFromFile("no-such-file-for-topk.txt", 5));
+}
+
+STUDENT_TEST("Buffer topK versus stream topK on a million data points.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 1000000; i++) {
+        points.add({ "point" + to_string(i), randomInteger(0, 1000000000) });
+    }
+    string text = asStream(points).str();
+
+    stringstream stream(text);
+    Vector<DataPoint> fromStream, fromBuffer;
+    TIME_OPERATION(points.size(), fromStream = topK(stream, 1000));
+    TIME_OPERATION(points.size(), fromBuffer = topKFromBuffer(text, 1000));
+    EXPECT_EQUAL(fromBuffer, fromStream);
+}
+
+namespace {
+    /* Name of a random item, chosen so that item r turns up with probability roughly
+     * proportional to 1 / r, as in the skewed streams heavy hitters is meant for.
+     */
+    string skewedName(int numNames) {
+        return "item" + to_string(int(exp(randomReal(0, log(numNames)))));
+    }
+
+    /* Exact heavy hitters, for checking against: total every name, then keep the k largest
+     * with a bounded heap.
+     */
+    Vector<HeavyHitter> exactHeavyHitters(istream& stream, int k) {
+        unordered_map<string, long long> totals;
+        for (DataPoint data; stream >> data;) {
+            totals[data.name] += data.weight;
+        }
+        HeapPQueue<NameCounter, less<>, 2, CounterKeyOf> pq;
+        for (const auto& [name, total]: totals) {
+            pq.offer({ name, total, 0 }, k);
+        }
+        Vector<HeavyHitter> result;
+        while (!pq.isEmpty()) {
+            auto counter = pq.dequeue();
+            result += { counter.name, counter.estimate, 0 };
+        }
+        result.reverse();
+        return result;
+    }
+}
+
+STUDENT_TEST("Heavy hitters is exact when every name fits in a counter.") {
+    Vector<DataPoint> points = {
+        { "a", 3 }, { "b", 1 }, { "a", 4 }, { "c", 10 }, { "b", 1 }, { "d", 0 }, { "a", 1 }
+    };
+    auto stream = asStream(points);
+    auto result = heavyHitters(stream, 3, 4);
+    EXPECT_EQUAL(result.size(), 3);
+    EXPECT_EQUAL(result[0].name, "c");
+    EXPECT_EQUAL(result[0].estimate, 10);
+    EXPECT_EQUAL(result[1].name, "a");
+    EXPECT_EQUAL(result[1].estimate, 8);
+    EXPECT_EQUAL(result[2].name, "b");
+    EXPECT_EQUAL(result[2].estimate, 2);
+    for (const auto& hitter: result) {
+        EXPECT_EQUAL(hitter.error, 0);
+    }
+
+    stream = asStream(points);
+    EXPECT_EQUAL(heavyHitters(stream, 0, 1).size(), 0);
+    stringstream empty;
+    EXPECT_EQUAL(heavyHitters(empty, 5, 10).size(), 0);
+}
+
+STUDENT_TEST("Heavy hitters estimates stay within their error bounds.") {
+    Vector<DataPoint> points;
+    long long totalWeight = 0;
+    for (int i = 0; i < 50000; i++) {
+        int weight = randomInteger(0, 10);
+        points.add({ skewedName(5000), weight });
+        totalWeight += weight;
+    }
+    unordered_map<string, long long> totals;
+    for (const auto& pt: points) {
+        totals[pt.name] += pt.weight;
+    }
+
+    const int capacity = 200;
+    auto stream = asStream(points);
+    auto result = heavyHitters(stream, capacity, capacity);
+    unordered_map<string, long long> reported;
+    for (const auto& hitter: result) {
+        long long truth = totals[hitter.name];
+        EXPECT(hitter.estimate - hitter.error <= truth);
+        EXPECT(truth <= hitter.estimate);
+        EXPECT(hitter.estimate - truth <= totalWeight / capacity);
+        reported[hitter.name] = hitter.estimate;
+    }
+    for (const auto& [name, total]: totals) {
+        if (total > totalWeight / capacity) {
+            EXPECT(reported.count(name));
+        }
+    }
+}
+
+STUDENT_TEST("Heavy hitters rejects bad arguments and negative weights.") {
+    stringstream stream;
+    EXPECT_ERROR(heavyHitters(stream, -1, 5));
+    EXPECT_ERROR(heavyHitters(stream, 6, 5));
+    EXPECT_ERROR(heavyHitters(stream, 0, 0));
+
+    auto negative = asStream({ { "a", 1 }, { "b", -1 } });
+    EXPECT_ERROR(heavyHitters(negative, 1, 5));
+}
+
+STUDENT_TEST("Heavy hitters versus exact counting: accuracy and throughput.") {
+    Vector<DataPoint> points;
+    for (int i = 0; i < 1000000; i++) {
+        points.add({ skewedName(1000000), 1 });
+    }
+    string text = asStream(points).str();
+    const int k = 10;
+
+    stringstream stream(text);
+    Vector<HeavyHitter> exact;
+    TIME_OPERATION(points.size(), exact = exactHeavyHitters(stream, k));
+    for (int capacity: { 100, 1000, 10000 }) {
+        stream = stringstream(text);
+        Vector<HeavyHitter> approx;
+        TIME_OPERATION(capacity, approx = heavyHitters(stream, k, capacity));
+
+        /* Recall: how many of the true top k the sketch found. */
+        int found = 0;
+        for (const auto& hitter: exact) {
+            for (const auto& guess: approx) {
+                if (guess.name == hitter.name) found++;
+            }
+        }
+        cout << "    capacity " << capacity << ": found " << found << " of the top " << k << endl;
+        EXPECT(capacity < 1000 || found == k);
+    }
+}
+
 
 
 
@@ -3,6 +3,8 @@
 #include "Demos/DataPoint.h"
 #include "vector.h"
 #include <istream>
+#include <string>
+#include <string_view>
 
 /**
  * Given a stream containing some number of DataPoints, returns the k elements from that
@@ -29,3 +31,76 @@
  *         order of weight, where n is the number of items in the stream.
  */
 Vector<DataPoint> topK(std::istream& stream, int k);
+
+/**
+ * Parallel version of topK. The stream is claimed in chunks of whole lines by numThreads
+ * worker threads, each of which parses its chunks into its own bounded heap; the winners
+ * of each thread are then merged into the final answer.
+ *
+ * Both versions break ties in weight in favor of the data point that appears earlier in
+ * the stream, so this returns exactly what topK(stream, k) would. If a chunk doesn't
+ * parse all the way through, because a data point spans two lines or can't be read at
+ * all, the threads stop claiming chunks and the stream is read in order from that data
+ * point on. A malformed data point therefore ends the run just as it does in topK.
+ *
+ * @param stream A data stream containing a bunch of DataPoints.
+ * @param k The number of elements to read.
+ * @param numThreads How many worker threads to use. This must be at least one.
+ * @return The same data points, in the same order, as topK(stream, k).
+ */
+Vector<DataPoint> topK(std::istream& stream, int k, int numThreads);
+
+/**
+ * Fast version of topK for text that is already in memory, such as a whole file. Rather
+ * than going through iostreams, this parses each data point into a view of the buffer,
+ * so no memory is allocated per record, and only the k winners are ever turned into
+ * DataPoints. It returns exactly what topK would on a stream containing the same text.
+ *
+ * @param text The contents of a data stream containing a bunch of DataPoints.
+ * @param k The number of elements to read.
+ * @return The same data points, in the same order, as topK on a stream of the text.
+ */
+Vector<DataPoint> topKFromBuffer(std::string_view text, int k);
+
+/**
+ * Runs topKFromBuffer over the contents of the named file, which is memory-mapped rather
+ * than read so that multi-gigabyte inputs are never copied. Reports an error if the file
+ * can't be opened.
+ *
+ * @param filename The name of a file containing a bunch of DataPoints.
+ * @param k The number of elements to read.
+ * @return The same data points, in the same order, as topK on a stream of the file.
+ */
+Vector<DataPoint> topKFromFile(const std::string& filename, int k);
+
+/**
+ * One result of heavyHitters: a name, along with bounds on its total weight. The true
+ * total is somewhere in the range [estimate - error, estimate].
+ */
+struct HeavyHitter {
+    std::string name;
+    long long estimate;
+    long long error;
+};
+
+/**
+ * Approximate alternative to topK for streams with too many distinct names to count
+ * exactly. Data points are grouped by name, their weights are summed (so a stream where
+ * every weight is 1 counts how often each name occurs), and the k names with the largest
+ * estimated totals are returned, sorted in descending order of estimate.
+ *
+ * This uses the Space-Saving algorithm with the given number of counters, so memory use
+ * is fixed no matter how many distinct names appear. If W is the total weight of the
+ * stream, every estimate overshoots by at most W / capacity, and every name whose true
+ * total exceeds W / capacity is guaranteed to be among the counters. More counters
+ * means tighter bounds.
+ *
+ * If the stream contains a negative weight, or unless 0 <= k <= capacity and capacity
+ * is positive, this function calls error() to report an error.
+ *
+ * @param stream A data stream containing a bunch of DataPoints.
+ * @param k The number of names to report.
+ * @param capacity The number of counters to keep.
+ * @return The (up to) k names with the highest estimated totals, with their bounds.
+ */
+Vector<HeavyHitter> heavyHitters(std::istream& stream, int k, int capacity);
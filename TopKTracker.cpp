@@ -0,0 +1,228 @@
+#include "TopKTracker.h"
+#include "TopK.h"
+#include "error.h"
+#include <algorithm>
+#include <sstream>
+#include <vector>
+using namespace std;
+
+TopKTracker::TopKTracker(int k, Window window, long long length) {
+    if (k < 0) {
+        error("A tracker can't report a negative number of data points.");
+    }
+    if (window != Window::UNBOUNDED && length <= 0) {
+        error("A window must have a positive length.");
+    }
+    this->k = k;
+    this->window = window;
+    this->length = length;
+    firstPosition = 0;
+    nextPosition = 0;
+    latestTime = 0;
+}
+
+TopKTracker::Location& TopKTracker::locationOf(long long position) {
+    return locations[position - firstPosition];
+}
+
+void TopKTracker::add(const DataPoint& data, long long time) {
+    advanceTo(time);
+    Ranked ranked = { data, nextPosition++ };
+
+    /* Without a window nothing ever expires, so whatever misses the cut can be dropped. */
+    if (window == Window::UNBOUNDED) {
+        best.offer(ranked, k);
+        return;
+    }
+
+    locations.push_back({ true, 0, time });
+    if (best.size() < k) {
+        locations.back().handle = best.enqueue(ranked);
+    } else if (k > 0 && RankOf()(best.peek()) < RankOf()(ranked)) {
+        /* The newcomer takes over the handle of the weakest of the best, which moves
+         * down into rest.
+         */
+        Location& weakest = locationOf(best.peek().position);
+        locations.back().handle = weakest.handle;
+        Ranked demoted = best.replaceTop(ranked);
+        weakest.inBest = false;
+        weakest.handle = rest.enqueue(std::move(demoted));
+    } else {
+        locations.back() = { false, rest.enqueue(ranked), time };
+    }
+
+    if (window == Window::COUNT && size() > length) {
+        expireOldest();
+    }
+}
+
+void TopKTracker::advanceTo(long long time) {
+    if (window != Window::TIME) return;
+    if (time < latestTime) {
+        error("Time can't go backwards in a time window.");
+    }
+    latestTime = time;
+    /* The window holds the times in (time - length, time]. */
+    while (!locations.empty() && locations.front().time <= time - length) {
+        expireOldest();
+    }
+}
+
+void TopKTracker::expireOldest() {
+    Location oldest = locations.front();
+    locations.pop_front();
+    firstPosition++;
+
+    if (!oldest.inBest) {
+        rest.erase(oldest.handle);
+        return;
+    }
+    /* A spot in best opened up, and the strongest of the rest is next in line for it. */
+    best.erase(oldest.handle);
+    if (!rest.isEmpty()) {
+        Ranked promoted = rest.dequeue();
+        Location& moved = locationOf(promoted.position);
+        moved.inBest = true;
+        moved.handle = best.enqueue(std::move(promoted));
+    }
+}
+
+Vector<DataPoint> TopKTracker::current() const {
+    vector<Ranked> kept;
+    best.forEach([&](const Ranked& ranked) {
+        kept.push_back(ranked);
+    });
+    sort(kept.begin(), kept.end(), [](const Ranked& lhs, const Ranked& rhs) {
+        return RankOf()(rhs) < RankOf()(lhs);
+    });
+
+    Vector<DataPoint> result;
+    for (const auto& ranked: kept) {
+        result += ranked.point;
+    }
+    return result;
+}
+
+long long TopKTracker::size() const {
+    return nextPosition - firstPosition;
+}
+
+
+
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+namespace {
+    /* Runs the plain topK over the given data points, for checking results against. */
+    Vector<DataPoint> referenceTopK(const Vector<DataPoint>& points, int k) {
+        stringstream stream;
+        for (const auto& pt: points) {
+            stream << pt;
+        }
+        return topK(stream, k);
+    }
+}
+
+STUDENT_TEST("Unbounded tracker reports the running top k without losing state.") {
+    TopKTracker tracker(3);
+    Vector<DataPoint> seen;
+    for (int i = 0; i < 200; i++) {
+        DataPoint pt = { "p" + to_string(i), randomInteger(0, 20) };
+        tracker.add(pt);
+        seen.add(pt);
+        /* Asking twice in a row must give the same answer. */
+        EXPECT_EQUAL(tracker.current(), referenceTopK(seen, 3));
+        EXPECT_EQUAL(tracker.current(), referenceTopK(seen, 3));
+    }
+    EXPECT_EQUAL(tracker.size(), 200);
+    /* Only the k best are ever stored. */
+    EXPECT_EQUAL(tracker.best.size(), 3);
+    EXPECT(tracker.rest.isEmpty());
+}
+
+STUDENT_TEST("Count window matches topK over the last n data points.") {
+    for (int k: { 0, 1, 4, 10 }) {
+        const int windowSize = 7;
+        TopKTracker tracker(k, TopKTracker::Window::COUNT, windowSize);
+        Vector<DataPoint> seen;
+        for (int i = 0; i < 300; i++) {
+            DataPoint pt = { "p" + to_string(i), randomInteger(0, 5) };
+            tracker.add(pt);
+            seen.add(pt);
+            int first = max(0, seen.size() - windowSize);
+            EXPECT_EQUAL(tracker.current(), referenceTopK(seen.subList(first, seen.size() - first), k));
+            EXPECT_EQUAL(tracker.size(), seen.size() - first);
+        }
+    }
+}
+
+STUDENT_TEST("Time window expires old data points, even with no new arrivals.") {
+    TopKTracker tracker(2, TopKTracker::Window::TIME, 10);
+    tracker.add({ "a", 50 }, 0);
+    tracker.add({ "b", 10 }, 3);
+    tracker.add({ "c", 30 }, 5);
+    Vector<DataPoint> expected = { { "a", 50 }, { "c", 30 } };
+    EXPECT_EQUAL(tracker.current(), expected);
+
+    /* At time 10, "a" (stamped 0) has aged out, and "b" is promoted. */
+    tracker.advanceTo(10);
+    expected = { { "c", 30 }, { "b", 10 } };
+    EXPECT_EQUAL(tracker.current(), expected);
+    EXPECT_EQUAL(tracker.size(), 2);
+
+    tracker.advanceTo(15);
+    EXPECT(tracker.current().isEmpty());
+    EXPECT_EQUAL(tracker.size(), 0);
+
+    tracker.add({ "d", 1 }, 15);
+    expected = { { "d", 1 } };
+    EXPECT_EQUAL(tracker.current(), expected);
+
+    EXPECT_ERROR(tracker.advanceTo(14));
+    EXPECT_ERROR(tracker.add({ "e", 1 }, 2));
+}
+
+STUDENT_TEST("Time window matches topK over a random bursty stream.") {
+    const int windowLength = 20;
+    TopKTracker tracker(5, TopKTracker::Window::TIME, windowLength);
+    Vector<DataPoint> points;
+    Vector<long long> times;
+    long long now = 0;
+    for (int i = 0; i < 2000; i++) {
+        now += randomInteger(0, 3) == 0 ? randomInteger(0, 25) : 0;
+        DataPoint pt = { "p" + to_string(i), randomInteger(0, 8) };
+        tracker.add(pt, now);
+        points.add(pt);
+        times.add(now);
+
+        Vector<DataPoint> live;
+        for (int j = 0; j < points.size(); j++) {
+            if (times[j] > now - windowLength) live.add(points[j]);
+        }
+        EXPECT_EQUAL(tracker.current(), referenceTopK(live, 5));
+        EXPECT_EQUAL(tracker.size(), live.size());
+    }
+}
+
+STUDENT_TEST("Tracker rejects bad settings.") {
+    EXPECT_ERROR(TopKTracker(-1));
+    EXPECT_ERROR(TopKTracker(5, TopKTracker::Window::COUNT, 0));
+    EXPECT_ERROR(TopKTracker(5, TopKTracker::Window::TIME, -3));
+}
+
+STUDENT_TEST("Count window of a million data points, snapshotting as it goes.") {
+    TopKTracker tracker(10, TopKTracker::Window::COUNT, 100000);
+    Vector<DataPoint> points;
+    for (int i = 0; i < 1000000; i++) {
+        points.add({ "", randomInteger(0, 1000000) });
+    }
+    auto addAll = [&] {
+        for (int i = 0; i < points.size(); i++) {
+            tracker.add(points[i]);
+            if (i % 1000 == 0) tracker.current();
+        }
+    };
+    TIME_OPERATION(points.size(), addAll());
+    EXPECT_EQUAL(tracker.current(), referenceTopK(points.subList(900000, 100000), 10));
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Demos/DataPoint.h"
+#include "GUI/SimpleTest.h"
+#include "HeapPQueue.h"
+#include "vector.h"
+#include <deque>
+#include <functional>
+#include <utility>
+
+/**
+ * An incremental version of topK. Data points are added one at a time, and the k data
+ * points of highest weight can be read off at any moment without disturbing the tracker.
+ *
+ * Optionally, only recent data points count. A count window keeps the last n data points
+ * added; a time window keeps the data points stamped within the last n time units, where
+ * time is whatever the caller measures it in (seconds, milliseconds, sequence numbers...).
+ * Older data points expire and stop appearing in the results.
+ *
+ * As with topK, ties in weight go to the data point that was added first, so current()
+ * always equals topK over a stream of the data points still in the window.
+ */
+class TopKTracker {
+public:
+    /* The ways of deciding which data points are still current. */
+    enum class Window {
+        UNBOUNDED, // Every data point ever added counts.
+        COUNT,     // Only the last length data points added count.
+        TIME       // Only data points stamped within the last length time units count.
+    };
+
+    /**
+     * Creates a tracker for the k heaviest data points. With no window, only those k
+     * data points are ever stored; with a window, every data point in the window is.
+     *
+     * If k is negative, or a COUNT or TIME window is given a length that isn't positive,
+     * this function calls error() to report an error.
+     *
+     * @param k How many data points to report.
+     * @param window Which data points count.
+     * @param length The size of the window, in data points or in time units.
+     */
+    TopKTracker(int k, Window window = Window::UNBOUNDED, long long length = 0);
+
+    /**
+     * Adds a data point, stamped with the current time for TIME windows. Times must never
+     * go backwards; if they do, this function calls error() to report an error. Adding
+     * with a time also expires anything that has fallen out of the window by that time.
+     *
+     * This operation runs in time O(log n), where n is the number of data points in the
+     * window, plus the cost of any expirations.
+     *
+     * @param data The data point to add.
+     * @param time When the data point arrived. Only TIME windows look at this.
+     */
+    void add(const DataPoint& data, long long time = 0);
+
+    /**
+     * Moves a TIME window forward to the given time, expiring anything older, without
+     * adding anything. This is what lets results age even when no data is arriving.
+     * For other windows this does nothing.
+     *
+     * @param time The current time, which must not be earlier than any time seen so far.
+     */
+    void advanceTo(long long time);
+
+    /**
+     * Returns the (up to) k data points of highest weight currently in the window, sorted
+     * in descending order of weight. The tracker is left unchanged.
+     *
+     * This operation runs in time O(k log k).
+     */
+    Vector<DataPoint> current() const;
+
+    /**
+     * Returns how many data points are currently in the window. For UNBOUNDED trackers,
+     * this counts every data point added so far.
+     */
+    long long size() const;
+
+private:
+    /* A data point along with the order it was added in, which breaks ties in weight. */
+    struct Ranked {
+        DataPoint point;
+        long long position;
+    };
+
+    struct RankOf {
+        std::pair<decltype(DataPoint::weight), long long> operator() (const Ranked& ranked) const {
+            return { ranked.point.weight, -ranked.position };
+        }
+    };
+
+    /* The k best data points in the window, with the weakest of them at the front so it
+     * can be demoted when something better arrives.
+     */
+    HeapPQueue<Ranked, std::less<>, 2, RankOf> best;
+
+    /* Every other data point in the window, with the strongest at the front so it can be
+     * promoted when a member of best expires. Always empty for UNBOUNDED trackers.
+     */
+    HeapPQueue<Ranked, std::greater<>, 2, RankOf> rest;
+
+    /* Where a data point in the window is stored, and when it arrived. */
+    struct Location {
+        bool inBest;
+        int handle;
+        long long time;
+    };
+
+    /* Locations of the data points in the window, oldest first. The data point added at
+     * position p lives at index p - firstPosition.
+     */
+    std::deque<Location> locations;
+    long long firstPosition;
+    long long nextPosition;
+
+    int k;
+    Window window;
+    long long length;
+    long long latestTime;
+
+    /* Returns the location of the data point added at the given position. */
+    Location& locationOf(long long position);
+
+    /* Drops the oldest data point in the window, promoting a replacement if need be. */
+    void expireOldest();
+
+    /* Grants STUDENT_TEST and PROVIDED_TEST access to the private section of this class.
+     * This allows tests to check private fields to make sure they have the right values
+     * and to test specific helper functions.
+     */
+    ALLOW_TEST_ACCESS();
+};
@@ -0,0 +1,516 @@
+#include "UnrolledStrand.h"
+#include "SplicingAndDicing.h"
+#include "GUI/SimpleTest.h"
+#include "error.h"
+#include "random.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace std;
+
+/* This program implements a strand of nucleotides as an unrolled linked list. */
+
+bool UnrolledStrand::Position::operator== (const Position& rhs) const {
+    return block == rhs.block && index == rhs.index;
+}
+
+bool UnrolledStrand::Position::operator!= (const Position& rhs) const {
+    return !(*this == rhs);
+}
+
+UnrolledStrand::UnrolledStrand() {
+    // Handled in the header
+}
+
+UnrolledStrand::UnrolledStrand(const string& bases) {
+    for (size_t i = 0; i < bases.size(); i += kBasesPerBlock) {
+        Block* block = newBlock();
+        block->begin = 0;
+        block->end = min<size_t>(kBasesPerBlock, bases.size() - i);
+        memcpy(block->bases, bases.data() + i, block->end);
+        append(block);
+    }
+    numBases = bases.size();
+}
+
+UnrolledStrand::~UnrolledStrand() {
+    while (chunks != nullptr) {
+        Chunk* next = chunks->next;
+        delete chunks;
+        chunks = next;
+    }
+}
+
+int UnrolledStrand::size() const {
+    return numBases;
+}
+
+bool UnrolledStrand::isEmpty() const {
+    return size() == 0;
+}
+
+UnrolledStrand::Block* UnrolledStrand::newBlock() {
+    if (freeBlocks != nullptr) {
+        Block* result = freeBlocks;
+        freeBlocks = result->next;
+        return result;
+    }
+    if (blocksUsedInChunk == kBlocksPerChunk) {
+        Chunk* chunk = new Chunk;
+        chunk->next = chunks;
+        chunks = chunk;
+        blocksUsedInChunk = 0;
+    }
+    return &chunks->blocks[blocksUsedInChunk++];
+}
+
+void UnrolledStrand::append(Block* block) {
+    block->next = nullptr;
+    block->prev = tail;
+    if (tail != nullptr) {
+        tail->next = block;
+    } else {
+        head = block;
+    }
+    tail = block;
+}
+
+void UnrolledStrand::release(Block* block) {
+    if (block->prev != nullptr) {
+        block->prev->next = block->next;
+    } else {
+        head = block->next;
+    }
+    if (block->next != nullptr) {
+        block->next->prev = block->prev;
+    } else {
+        tail = block->prev;
+    }
+    block->next = freeBlocks;
+    freeBlocks = block;
+}
+
+/* If the bases wouldn't fit after the block's own, its own move to the front first. */
+void UnrolledStrand::mergeNext(Block* block) {
+    Block* next = block->next;
+    int size = block->end - block->begin;
+    int nextSize = next->end - next->begin;
+    if (block->end + nextSize > kBasesPerBlock) {
+        memmove(block->bases, block->bases + block->begin, size);
+        block->begin = 0;
+        block->end = size;
+    }
+    memcpy(block->bases + block->end, next->bases + next->begin, nextSize);
+    block->end += nextSize;
+    release(next);
+}
+
+string UnrolledStrand::toString() const {
+    string result;
+    result.reserve(numBases);
+    for (Block* block = head; block != nullptr; block = block->next) {
+        result.append(block->bases + block->begin, block->end - block->begin);
+    }
+    return result;
+}
+
+/* Shift-Or, as for Nucleotide chains: after each base, bit i of state is clear exactly
+ * when the last i + 1 bases read spell out the first i + 1 bases of the pattern.
+ */
+UnrolledStrand::Position UnrolledStrand::shiftOrFindEnd(string_view pattern) const {
+    uint64_t masks[256];
+    for (uint64_t& mask: masks) {
+        mask = ~uint64_t(0);
+    }
+    for (size_t i = 0; i < pattern.size(); i++) {
+        masks[(unsigned char) pattern[i]] &= ~(uint64_t(1) << i);
+    }
+
+    uint64_t done = uint64_t(1) << (pattern.size() - 1);
+    uint64_t state = ~uint64_t(0);
+    for (Block* block = head; block != nullptr; block = block->next) {
+        for (int index = block->begin; index < block->end; index++) {
+            state = (state << 1) | masks[(unsigned char) block->bases[index]];
+            if ((state & done) == 0) return { block, index };
+        }
+    }
+    return {};
+}
+
+/* Knuth-Morris-Pratt: after a mismatch with matched bases of the pattern already read,
+ * fallback[matched - 1] is the longest proper prefix of those that is also a suffix of
+ * them, so the search carries on from there without rereading any of the strand.
+ */
+UnrolledStrand::Position UnrolledStrand::kmpFindEnd(string_view pattern) const {
+    int length = pattern.size();
+    vector<int> fallback(length, 0);
+    for (int i = 1, matched = 0; i < length; i++) {
+        while (matched > 0 && pattern[i] != pattern[matched]) {
+            matched = fallback[matched - 1];
+        }
+        if (pattern[i] == pattern[matched]) matched++;
+        fallback[i] = matched;
+    }
+
+    int matched = 0;
+    for (Block* block = head; block != nullptr; block = block->next) {
+        for (int index = block->begin; index < block->end; index++) {
+            char base = block->bases[index];
+            while (matched > 0 && base != pattern[matched]) {
+                matched = fallback[matched - 1];
+            }
+            if (base == pattern[matched]) matched++;
+            if (matched == length) return { block, index };
+        }
+    }
+    return {};
+}
+
+UnrolledStrand::Position UnrolledStrand::backUp(Position position, int count) {
+    Block* block = position.block;
+    int index = position.index;
+    /* Skip whole blocks until the base is in this one. */
+    while (count > index - block->begin) {
+        count -= index - block->begin + 1;
+        block = block->prev;
+        index = block->end - 1;
+    }
+    return { block, index - count };
+}
+
+/* The same two searches as findFirst on Nucleotide chains, so this reads each base of the
+ * strand once however repetitive the strands are. Both walk each block's bases as a plain
+ * array and stop at the end of the match, and stepping back to its start takes time
+ * proportional to the number of blocks it spans.
+ */
+UnrolledStrand::Position UnrolledStrand::findFirst(const UnrolledStrand& target) const {
+    if (target.isEmpty()) return positionOf(0);
+    if (target.size() > size()) return {};
+
+    string pattern = target.toString();
+    Position end = target.size() <= kShiftOrMaxLength ? shiftOrFindEnd(pattern)
+                                                      : kmpFindEnd(pattern);
+    if (end.block == nullptr) return {};
+    return backUp(end, target.size() - 1);
+}
+
+/* Whole blocks in the middle of the run are released; the blocks at either end have
+ * their bounds moved, or, for a run inside a single block, the bases after it moved
+ * down. Only the pairs of blocks around the run can have become small enough to merge.
+ */
+void UnrolledStrand::erase(Position start, int length) {
+    if (start.block == nullptr || length < 0) {
+        error("Invalid position or length.");
+    }
+    int available = 0;
+    for (Block* block = start.block; block != nullptr && available < length; block = block->next) {
+        available += block->end - (block == start.block? start.index : block->begin);
+    }
+    if (available < length) {
+        error("Not enough bases to erase.");
+    }
+    if (length == 0) return;
+
+    numBases -= length;
+    Block* first = start.block;
+    Block* before = first->prev;
+
+    if (start.index + length <= first->end) {
+        if (start.index == first->begin) {
+            first->begin += length;
+        } else {
+            memmove(first->bases + start.index, first->bases + start.index + length,
+                    first->end - start.index - length);
+            first->end -= length;
+        }
+    } else {
+        length -= first->end - start.index;
+        first->end = start.index;
+
+        Block* block = first->next;
+        while (block != nullptr && length > 0 && length >= block->end - block->begin) {
+            length -= block->end - block->begin;
+            Block* next = block->next;
+            release(block);
+            block = next;
+        }
+        if (length > 0) block->begin += length;
+    }
+
+    /* The run's first block, the block the run ended in and the block after that are at
+     * most three pairs from before, so three steps forward see them all.
+     */
+    Block* block = (before != nullptr? before : head);
+    for (int steps = 0; block != nullptr && block->next != nullptr && steps < 3; ) {
+        if ((block->end - block->begin) + (block->next->end - block->next->begin) <= kBasesPerBlock) {
+            mergeNext(block);
+        } else {
+            block = block->next;
+            steps++;
+        }
+    }
+    if (head != nullptr && head->begin == head->end) {
+        release(head);
+    }
+}
+
+bool UnrolledStrand::spliceFirst(const UnrolledStrand& target) {
+    if (target.isEmpty()) return true;
+
+    Position start = findFirst(target);
+    if (start.block == nullptr) return false;
+
+    erase(start, target.size());
+    return true;
+}
+
+UnrolledStrand::Position UnrolledStrand::positionOf(int index) const {
+    if (index < 0) return {};
+    for (Block* block = head; block != nullptr; block = block->next) {
+        int size = block->end - block->begin;
+        if (index < size) return { block, block->begin + index };
+        index -= size;
+    }
+    return {};
+}
+
+char UnrolledStrand::valueAt(Position position) const {
+    if (position.block == nullptr) {
+        error("Invalid position.");
+    }
+    return position.block->bases[position.index];
+}
+
+size_t UnrolledStrand::bytesUsed() const {
+    size_t result = sizeof(*this);
+    for (Chunk* chunk = chunks; chunk != nullptr; chunk = chunk->next) {
+        result += sizeof(Chunk);
+    }
+    return result;
+}
+
+
+/* * * * * * Test Cases Below This Point * * * * * */
+
+/* From SplicingAndDicing.cpp, to compare against. */
+Nucleotide* toStrand(const string& str);
+string fromDNA(Nucleotide* dna);
+Nucleotide* findFirst(Nucleotide* dna, Nucleotide* target);
+bool spliceFirst(Nucleotide*& dna, Nucleotide* target);
+void deleteNucleotides(Nucleotide* dna);
+const string& eColiGenome();
+
+namespace {
+    string randomBases(int length, const string& alphabet = "ACGT") {
+        string result;
+        for (int i = 0; i < length; i++) {
+            result += alphabet[randomInteger(0, alphabet.size() - 1)];
+        }
+        return result;
+    }
+}
+
+STUDENT_TEST("UnrolledStrand holds exactly the bases it was made from.") {
+    for (int length: { 0, 1, 2, 255, 256, 257, 512, 1000, 10000 }) {
+        string bases = randomBases(length);
+        UnrolledStrand strand(bases);
+        EXPECT_EQUAL(strand.size(), length);
+        EXPECT_EQUAL(strand.isEmpty(), length == 0);
+        EXPECT_EQUAL(strand.toString(), bases);
+
+        for (int i = 0; i < length; i += 17) {
+            EXPECT_EQUAL(strand.valueAt(strand.positionOf(i)), bases[i]);
+        }
+        EXPECT(strand.positionOf(length) == UnrolledStrand::Position());
+        EXPECT(strand.positionOf(-1) == UnrolledStrand::Position());
+    }
+}
+
+STUDENT_TEST("UnrolledStrand::findFirst finds what string::find does, across block boundaries.") {
+    for (int trial = 0; trial < 200; trial++) {
+        /* A two-letter alphabet gives plenty of partial matches. */
+        string bases = randomBases(randomInteger(0, 2000), "AC");
+        UnrolledStrand strand(bases);
+
+        for (int i = 0; i < 10; i++) {
+            string pattern;
+            if (!bases.empty() && randomChance(0.5)) {
+                int start = randomInteger(0, bases.size() - 1);
+                pattern = bases.substr(start, randomInteger(1, 600));
+            } else {
+                pattern = randomBases(randomInteger(0, 12), "AC");
+            }
+            UnrolledStrand target(pattern);
+
+            size_t expected = bases.find(pattern);
+            UnrolledStrand::Position position = strand.findFirst(target);
+            if (expected == string::npos) {
+                EXPECT(position == UnrolledStrand::Position());
+            } else {
+                EXPECT(position == strand.positionOf(expected));
+            }
+        }
+    }
+
+    UnrolledStrand empty;
+    UnrolledStrand nothing;
+    EXPECT(empty.findFirst(nothing) == UnrolledStrand::Position());
+    EXPECT(empty.findFirst(UnrolledStrand("A")) == UnrolledStrand::Position());
+}
+
+STUDENT_TEST("Stress Test: UnrolledStrand::findFirst is linear on highly repetitive strands.") {
+    /* Every base starts a near miss that only fails at the target's last base. Matching
+     * base by base from each start would take time proportional to n times m.
+     */
+    const int kLength = 1000000;
+    UnrolledStrand strand(string(kLength, 'A') + "C");
+    for (int targetLength: { 40, 64, 65, 1000, 10000 }) {
+        UnrolledStrand target(string(targetLength - 1, 'A') + "C");
+        UnrolledStrand::Position position;
+        TIME_OPERATION(kLength, position = strand.findFirst(target));
+        EXPECT(position == strand.positionOf(kLength + 1 - targetLength));
+    }
+}
+
+STUDENT_TEST("UnrolledStrand::spliceFirst agrees with string::erase and keeps blocks full.") {
+    auto isConsistent = [](const UnrolledStrand& strand) {
+        int total = 0;
+        int numBlocks = 0;
+        UnrolledStrand::Block* prev = nullptr;
+        for (UnrolledStrand::Block* block = strand.head; block != nullptr; block = block->next) {
+            if (block->prev != prev) return false;
+            if (block->begin < 0 || block->begin >= block->end || block->end > UnrolledStrand::kBasesPerBlock) return false;
+            if (prev != nullptr && (prev->end - prev->begin) + (block->end - block->begin) <= UnrolledStrand::kBasesPerBlock) return false;
+            total += block->end - block->begin;
+            numBlocks++;
+            prev = block;
+        }
+        return prev == strand.tail && total == strand.numBases &&
+               numBlocks <= 2 * strand.numBases / UnrolledStrand::kBasesPerBlock + 1;
+    };
+
+    for (int trial = 0; trial < 50; trial++) {
+        string bases = randomBases(5000);
+        UnrolledStrand strand(bases);
+        while (!bases.empty()) {
+            string pattern;
+            if (randomChance(0.9)) {
+                int start = randomInteger(0, bases.size() - 1);
+                pattern = bases.substr(start, randomInteger(1, randomChance(0.5)? 10 : 700));
+            } else {
+                pattern = randomBases(randomInteger(1, 8));
+            }
+            UnrolledStrand target(pattern);
+
+            size_t match = bases.find(pattern);
+            EXPECT_EQUAL(strand.spliceFirst(target), match != string::npos);
+            if (match != string::npos) bases.erase(match, pattern.size());
+
+            EXPECT(strand.toString() == bases);
+            EXPECT(isConsistent(strand));
+        }
+        EXPECT(strand.isEmpty());
+        EXPECT(strand.head == nullptr);
+    }
+}
+
+STUDENT_TEST("UnrolledStrand::erase handles the ends and reports bad runs.") {
+    UnrolledStrand strand(string(300, 'A') + string(300, 'C') + string(300, 'G'));
+    strand.erase(strand.positionOf(0), 10);
+    strand.erase(strand.positionOf(strand.size() - 10), 10);
+    EXPECT_EQUAL(strand.toString(), string(290, 'A') + string(300, 'C') + string(290, 'G'));
+
+    strand.erase(strand.positionOf(100), 0);
+    EXPECT_EQUAL(strand.size(), 880);
+
+    EXPECT_ERROR(strand.erase(strand.positionOf(870), 11));
+    EXPECT_ERROR(strand.erase(UnrolledStrand::Position(), 1));
+    EXPECT_EQUAL(strand.size(), 880);
+
+    strand.erase(strand.positionOf(0), 880);
+    EXPECT(strand.isEmpty());
+    EXPECT_EQUAL(strand.toString(), "");
+}
+
+STUDENT_TEST("Blocks freed by splices are reused before any new chunk is made.") {
+    UnrolledStrand strand(randomBases(UnrolledStrand::kBasesPerBlock * UnrolledStrand::kBlocksPerChunk * 3));
+    size_t bytes = strand.bytesUsed();
+
+    for (int i = 0; i < 100; i++) {
+        strand.erase(strand.positionOf(0), UnrolledStrand::kBasesPerBlock);
+    }
+    UnrolledStrand::Block* freed = strand.freeBlocks;
+    EXPECT(freed != nullptr);
+    EXPECT_EQUAL(strand.newBlock(), freed);
+
+    string more = randomBases(UnrolledStrand::kBasesPerBlock * 50);
+    UnrolledStrand extra(more);
+    for (int i = 0; i < 50; i++) {
+        strand.erase(strand.positionOf(0), UnrolledStrand::kBasesPerBlock);
+    }
+    EXPECT_EQUAL(strand.bytesUsed(), bytes);
+    EXPECT_EQUAL(extra.toString(), more);
+}
+
+STUDENT_TEST("Stress Test: UnrolledStrand versus Nucleotide chains on E.Coli.") {
+    const string& genome = eColiGenome();
+    string tail = genome.substr(genome.size() - 80);
+
+    Nucleotide* dna = nullptr;
+    UnrolledStrand* strand = nullptr;
+    TIME_OPERATION(genome.size(), dna = toStrand(genome));
+    TIME_OPERATION(genome.size(), strand = new UnrolledStrand(genome));
+    cout << "    Nucleotides: " << sizeof(Nucleotide) << " bytes per base plus heap overhead; "
+         << "UnrolledStrand: " << double(strand->bytesUsed()) / genome.size() << " bytes per base" << endl;
+
+    string fromChain, fromStrand;
+    TIME_OPERATION(genome.size(), fromChain = fromDNA(dna));
+    TIME_OPERATION(genome.size(), fromStrand = strand->toString());
+    EXPECT(fromChain == genome);
+    EXPECT(fromStrand == genome);
+
+    /* Finding the tail, then the whole genome. */
+    Nucleotide* target = toStrand(tail);
+    UnrolledStrand tailStrand(tail);
+    Nucleotide* found = nullptr;
+    UnrolledStrand::Position position;
+    TIME_OPERATION(genome.size(), found = findFirst(dna, target));
+    TIME_OPERATION(genome.size(), position = strand->findFirst(tailStrand));
+    EXPECT(found != nullptr);
+    EXPECT(position == strand->positionOf(genome.size() - tail.size()));
+    deleteNucleotides(target);
+
+    target = toStrand(genome);
+    UnrolledStrand genomeStrand(genome);
+    TIME_OPERATION(genome.size(), found = findFirst(dna, target));
+    TIME_OPERATION(genome.size(), position = strand->findFirst(genomeStrand));
+    EXPECT_EQUAL(found, dna);
+    EXPECT(position == strand->positionOf(0));
+
+    /* Splicing off the tail, then the rest. */
+    Nucleotide* tailTarget = toStrand(tail);
+    bool spliced = false;
+    TIME_OPERATION(genome.size(), spliced = spliceFirst(dna, tailTarget));
+    EXPECT(spliced);
+    TIME_OPERATION(genome.size(), spliced = strand->spliceFirst(tailStrand));
+    EXPECT(spliced);
+    EXPECT(fromDNA(dna) == genome.substr(0, genome.size() - tail.size()));
+    EXPECT(strand->toString() == genome.substr(0, genome.size() - tail.size()));
+    deleteNucleotides(tailTarget);
+
+    deleteNucleotides(dna);
+    delete strand;
+    dna = toStrand(genome);
+    strand = new UnrolledStrand(genome);
+    TIME_OPERATION(genome.size(), spliced = spliceFirst(dna, target));
+    EXPECT(spliced);
+    TIME_OPERATION(genome.size(), spliced = strand->spliceFirst(genomeStrand));
+    EXPECT(spliced);
+    EXPECT_EQUAL(dna, nullptr);
+    EXPECT(strand->isEmpty());
+
+    deleteNucleotides(target);
+    TIME_OPERATION(genome.size(), delete strand);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include "Demos/Utility.h"
+#include "GUI/MemoryDiagnostics.h"
+#include "GUI/SimpleTest.h"
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/**
+ * A strand of nucleotides stored as an unrolled doubly-linked list: rather than one
+ * Nucleotide per base, each cell is a block holding a run of up to kBasesPerBlock bases
+ * side by side. Walking the strand then reads memory in order instead of chasing a
+ * pointer per base, and a strand takes about a byte per base instead of a heap cell of
+ * two pointers and a char.
+ *
+ * Blocks are carved out of larger chunks that the strand allocates as it needs them and
+ * frees all at once when it is destroyed. A block emptied by a splice goes on a free list
+ * to be reused by the strand.
+ *
+ * Each block keeps its bases in bases[begin, end), so cutting bases off the front or the
+ * back of a block is just a matter of moving one of those bounds. Removing a run of bases
+ * found by findFirst touches only the blocks the run lies in plus their neighbours, and
+ * costs time proportional to the run's length over kBasesPerBlock plus kBasesPerBlock -
+ * however long the rest of the strand is. After each removal, neighbouring blocks that
+ * fit in one are merged, so any two adjacent blocks hold more than kBasesPerBlock bases
+ * between them and blocks stay at least half full on average.
+ */
+class UnrolledStrand {
+private:
+    struct Block;
+
+public:
+    /**
+     * Where a base is in a strand. Positions are invalidated by any change to the strand.
+     */
+    struct Position {
+        Block* block = nullptr; // nullptr if this is no position at all.
+        int index = 0;          // Into the block's bases.
+
+        bool operator== (const Position& rhs) const;
+        bool operator!= (const Position& rhs) const;
+    };
+
+    /**
+     * Creates an empty strand.
+     */
+    UnrolledStrand();
+
+    /**
+     * Creates a strand holding the given bases, the counterpart of toStrand.
+     */
+    explicit UnrolledStrand(const std::string& bases);
+
+    /**
+     * Cleans up all memory allocated by this strand.
+     */
+    ~UnrolledStrand();
+
+    bool isEmpty() const;
+    int size() const;
+
+    /**
+     * Returns a string spelling out the strand, the counterpart of fromDNA.
+     */
+    std::string toString() const;
+
+    /**
+     * Returns the position of the first base of the first copy of target in this strand,
+     * or an invalid Position if there is none. As with findFirst, an empty target is
+     * found at the start of the strand.
+     */
+    Position findFirst(const UnrolledStrand& target) const;
+
+    /**
+     * Removes the first copy of target from this strand, returning whether there was one
+     * to remove. As with spliceFirst, an empty target is always removed.
+     */
+    bool spliceFirst(const UnrolledStrand& target);
+
+    /**
+     * Removes length bases starting at the given position. Reports an error if the
+     * strand has fewer than that many bases from there on.
+     */
+    void erase(Position start, int length);
+
+    /**
+     * Returns the position of the base with the given index, counting from zero, or an
+     * invalid Position if the index is out of range. This takes time proportional to the
+     * number of blocks before that base.
+     */
+    Position positionOf(int index) const;
+
+    /**
+     * Returns the base at the given position.
+     */
+    char valueAt(Position position) const;
+
+    /**
+     * Returns how many bytes the strand takes up altogether.
+     */
+    std::size_t bytesUsed() const;
+
+    static const int kBasesPerBlock = 256;
+
+private:
+    struct Block {
+        Block* next;
+        Block* prev;
+        int begin, end;  // The block's bases are bases[begin, end).
+        char bases[kBasesPerBlock];
+    };
+
+    /* Blocks are handed out kBlocksPerChunk at a time. */
+    static const int kBlocksPerChunk = 64;
+
+    struct Chunk {
+        Chunk* next;
+        Block blocks[kBlocksPerChunk];
+
+        /* For testing. */
+        TRACK_ALLOCATIONS_OF(Chunk);
+    };
+
+    Block* head = nullptr;
+    Block* tail = nullptr;
+    int numBases = 0;
+
+    Chunk* chunks = nullptr;
+    int blocksUsedInChunk = kBlocksPerChunk;  // Of the most recent chunk.
+    Block* freeBlocks = nullptr;              // Linked through their next pointers.
+
+    /* Gets an unlinked block from the free list or the current chunk. */
+    Block* newBlock();
+
+    /* Adds a block to the end of the strand. */
+    void append(Block* block);
+
+    /* Takes a block out of the strand and puts it on the free list. */
+    void release(Block* block);
+
+    /* Moves the bases of the block after this one onto the end of this one, then releases
+     * that block. The two must fit in one block.
+     */
+    void mergeNext(Block* block);
+
+    /* Targets up to this long fit in one word for shiftOrFindEnd. */
+    static const int kShiftOrMaxLength = 64;
+
+    /* Search for the first copy of pattern with Shift-Or or with Knuth-Morris-Pratt,
+     * returning the position of its last base, or an invalid Position if there is none.
+     */
+    Position shiftOrFindEnd(std::string_view pattern) const;
+    Position kmpFindEnd(std::string_view pattern) const;
+
+    /* Returns the position count bases before the given one, which must exist. */
+    static Position backUp(Position position, int count);
+
+    /* Internal shenanigans to make this play well with C++. */
+    DISALLOW_COPYING_OF(UnrolledStrand);
+    ALLOW_TEST_ACCESS();
+};